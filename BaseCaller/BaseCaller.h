@@ -32,7 +32,7 @@ template<class _prec=double>
 class BaseCaller {
 public:
 
-  BaseCaller(string source_signalid_in  ="PHASE_CORRECTED", ///< The signal ID to get intensities from
+  BaseCaller(SignalId source_signalid_in  ="PHASE_CORRECTED", ///< The signal ID to get intensities from
              string target_sequenceid_in="BASECALL",        ///< The sequence ID to write basecalls to
              ostream &err_in=std::cerr                      ///< Write debug/errors here
             ): source_signalid(source_signalid_in),
@@ -48,12 +48,14 @@ public:
       (*i).sequence(target_sequenceid).sequence().clear();
       (*i).sequence(target_sequenceid).quality() .clear();
       bool last_offedge=false;
-      for(typename Cluster<_prec>::signal_vec_type::const_iterator j=(*i).const_signal(source_signalid).begin();j != (*i).const_signal(source_signalid).end();j++) {
+      size_t cycle=0;
+      for(typename Cluster<_prec>::signal_vec_type::const_iterator j=(*i).const_signal(source_signalid).begin();j != (*i).const_signal(source_signalid).end();j++,cycle++) {
+        bool offedge = ReadIntensity<_prec>::off_edge((*i).offedge_mask(source_signalid,cycle));
 
         // More than one base off the edge calls an N otherwise call max peak.
         // Why more than one? because phasing can compensate to an extent
         // TODO: Why do I have to use this messy cast here? remove it
-        if((*j).off_edge() && last_offedge) {
+        if(offedge && last_offedge) {
           (*i).sequence(target_sequenceid).sequence().push_back(static_cast<int>(Cluster<_prec>::sequence_type::base_n)); 
           (*i).sequence(target_sequenceid).quality().push_back(1); 
         } else {
@@ -62,7 +64,7 @@ public:
           (*i).sequence(target_sequenceid).quality().push_back((*j).get_quality()); 
           last_offedge=false;
         }
-        if((*j).off_edge()) last_offedge=true;
+        if(offedge) last_offedge=true;
         
       }
     }
@@ -72,7 +74,7 @@ public:
 
 private:
 
-  string source_signalid;
+  SignalId source_signalid;
   string target_sequenceid;
 
   ostream &err;                               ///< Error output will be writen here, set to cerr in constructor default
@@ -32,7 +32,7 @@ template<class _prec=float,class _prbprec=float>
 class PrbBaseCaller {
 public:
 
-  PrbBaseCaller(string source_signalid_in  ="PHASE_CORRECTED", ///< The signal ID to get intensities from
+  PrbBaseCaller(SignalId source_signalid_in  ="PHASE_CORRECTED", ///< The signal ID to get intensities from
                 string target_sequenceid_in="BASECALL",        ///< The sequence ID to write basecalls to
                 ostream &err_in=std::cerr                      ///< Write debug/errors here
                ): source_signalid(source_signalid_in),
@@ -45,18 +45,29 @@ public:
     cluster.add_sequence(target_sequenceid);// if it doesn't exist add it
 
     cluster.sequence(target_sequenceid).sequence().clear();
+    cluster.sequence(target_sequenceid).sequence().resize(cluster.const_signal(source_signalid).size());
+    if(cluster.const_signal(source_signalid).size() > 0) call(cluster,&cluster.sequence(target_sequenceid).sequence()[0]);
+
+    if(delete_signal) {
+      cluster.delete_signal(source_signalid);
+    }
+
+    return true;
+  }
+
+  /// Calls every cycle of a cluster without storing a sequence, prb must have room for one probability per cycle
+  void call(const Cluster<_prec> &cluster,BaseProbability<_prbprec> *prb) const {
     bool last_offedge=false;
-    for(typename Cluster<_prec>::signal_vec_type::const_iterator j=cluster.const_signal(source_signalid).begin();j != cluster.const_signal(source_signalid).end();j++) {
+    size_t cycle=0;
+    for(typename Cluster<_prec>::signal_vec_type::const_iterator j=cluster.const_signal(source_signalid).begin();j != cluster.const_signal(source_signalid).end();j++,cycle++) {
+      bool offedge = ReadIntensity<_prec>::off_edge(cluster.offedge_mask(source_signalid,cycle));
 
       // More than one base off the edge calls an N otherwise call max peak.
       // Why more than one? because phasing can compensate to an extent
       // TODO: Why do I have to use this messy cast here? remove it
-      if((*j).off_edge() && last_offedge) {
+      if(offedge && last_offedge) {
         // hum....
-        BaseProbability<_prbprec> prb;
-        for(size_t n=0;n < BaseProbability<_prbprec>::base_count;n++) prb[n] = 1/static_cast<_prbprec>(ProbabilitySequence<_prbprec>::base_count);
-
-        cluster.sequence(target_sequenceid).sequence().push_back(prb);
+        for(size_t n=0;n < BaseProbability<_prbprec>::base_count;n++) prb[cycle][n] = 1/static_cast<_prbprec>(ProbabilitySequence<_prbprec>::base_count);
       } else {
         // TODO: The following line is bad, it relies of ReadIntensity and ProbabilitySequence seting base consts the same
         
@@ -65,26 +76,17 @@ public:
           if((*j).get_base(n) > 0) intensity_sum += (*j).get_base(n);
         }
 
-        BaseProbability<_prbprec> prb;
         for(size_t n=0;n < ProbabilitySequence<_prbprec>::base_count;n++) {
            if(intensity_sum > 0) {
-             if((*j).get_base(n) > 0) prb[n] = (*j).get_base(n)/intensity_sum;
-                                 else prb[n] = 0;
-           } else prb[n] = 0;
+             if((*j).get_base(n) > 0) prb[cycle][n] = (*j).get_base(n)/intensity_sum;
+                                 else prb[cycle][n] = 0;
+           } else prb[cycle][n] = 0;
         }
-       
-        cluster.sequence(target_sequenceid).sequence().push_back(prb);
 
         last_offedge=false;
       }
-      if((*j).off_edge()) last_offedge=true;
+      if(offedge) last_offedge=true;
     }
-
-    if(delete_signal) {
-      cluster.delete_signal(source_signalid);
-    }
-
-    return true;
   }
 
   // Process a set of clusters
@@ -111,9 +113,13 @@ public:
     return new_clusters;
   }
 
+  SignalId source() const {
+    return source_signalid;
+  }
+
 private:
 
-  string source_signalid;
+  SignalId source_signalid;
   string target_sequenceid;
 
   ostream &err;                               ///< Error output will be writen here, set to cerr in constructor default
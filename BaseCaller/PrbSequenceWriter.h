@@ -0,0 +1,204 @@
+/*
+    Swift (c) 2008 Genome Research Ltd.
+    Authors: Nava Whiteford and Tom Skelly (new@sgenomics.org ts6@sanger.ac.uk)
+
+    This file is part of Swift (http://swiftng.sourceforge.net).
+
+    Swift is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Swift is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with Swift.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SWIFT_PRBSEQUENCEWRITER_H
+#define SWIFT_PRBSEQUENCEWRITER_H
+
+#include <vector>
+#include <string>
+#include <iostream>
+#include "Cluster.h"
+#include "PrbBaseCaller.h"
+#include "FastqWriter.h"
+#include "Fast4Writer.h"
+#include "stringify.h"
+
+using namespace std;
+
+/// Basecalls clusters with PrbBaseCaller and writes the reads straight to FASTQ/FAST4, in one pass.
+///
+/// Each cluster's probabilities go into one scratch array which is reused for every cluster, and every
+/// writer formats its record from it: pf/nonpf, and for paired runs both ends as ranges of the same array.
+/// No ProbabilitySequence is kept unless store_sequences is called (Reporting needs them to align reads).
+/// Files and read ids are the same as writing Cluster::sequence(...) (trimmed for each end) would give.
+/// With compress_output, the files are BGZF and are deflated by a pool of threads while clusters are called.
+template<class _prec=float,class _prbprec=float>
+class PrbSequenceWriter {
+public:
+
+  PrbSequenceWriter(SignalId source_signalid_in,  ///< The signal ID to get intensities from
+                    string tag_in,                ///< Read ids are tag:x:y
+                    int pair_break_in=-1          ///< 0-based start of the second end, -1 if not paired
+                   ) : m_base_caller(source_signalid_in),
+                       m_tag(tag_in),
+                       m_pair_break(pair_break_in),
+                       m_store(false),
+                       m_compression(0) {
+  }
+
+  ~PrbSequenceWriter() {
+    close();
+    delete m_compression;
+  }
+
+  /// Write the files opened after this as BGZF, named .gz, deflated by this many threads (0 for one per core)
+  void compress_output(int threads=0) {
+    if(threads <= 0) threads = thread::hardware_concurrency();
+    if(threads <= 0) threads = 1;
+    if(m_compression == 0) m_compression = new BgzfPool(threads);
+  }
+
+  /// Write FASTQ to prefix.pf and prefix.nonpf (.end1/.end2 for paired runs)
+  void open_fastq(string prefix) {
+    for(int pf=0;pf<2;pf++) {
+      for(int end=0;end<ends();end++) {
+        FastqWriter *w = new FastqWriter(prefix + file_suffix(pf,end));
+        w->set_compressed(m_compression);
+        w->open();
+        m_fastq.push_back(w);
+      }
+    }
+  }
+
+  /// Write FAST4 to prefix.pf and prefix.nonpf (.end1/.end2 for paired runs), as text or binary
+  void open_fast4(string prefix,bool textmode,bool binarymode=false) {
+    for(int pf=0;pf<2;pf++) {
+      for(int end=0;end<ends();end++) {
+        Fast4Writer<size_t,_prbprec> *w = new Fast4Writer<size_t,_prbprec>(prefix + file_suffix(pf,end));
+        if(textmode)   w->set_textmode();
+        if(binarymode) w->set_binarymode();
+        w->set_compressed(m_compression);
+        w->open();
+        m_fast4.push_back(w);
+      }
+    }
+  }
+
+  /// Also keep each cluster's calls as sequence target_sequenceid, as PrbBaseCaller::process would
+  void store_sequences(string target_sequenceid) {
+    m_store = true;
+    m_target_sequenceid = target_sequenceid;
+  }
+
+  /// Call and write a vector of clusters, in order
+  bool process(vector<Cluster<_prec> > &clusters) {
+    for(typename vector<Cluster<_prec> >::iterator i = clusters.begin();i != clusters.end();i++) {
+      process(*i);
+    }
+
+    return true;
+  }
+
+  /// Call and write a single cluster
+  bool process(Cluster<_prec> &cluster) {
+    size_t cycles = cluster.const_signal(m_base_caller.source()).size();
+
+    BaseProbability<_prbprec> *prb;
+    if(m_store) {
+      cluster.add_sequence(m_target_sequenceid);
+      typename Cluster<_prec>::sequence_type::probability_sequence_type &seq = cluster.sequence(m_target_sequenceid).sequence();
+      seq.clear();
+      seq.resize(cycles);
+      prb = seq.data();
+    } else {
+      m_scratch.resize(cycles);
+      prb = m_scratch.data();
+    }
+    if(cycles > 0) m_base_caller.call(cluster,prb);
+
+    if(m_fastq.empty() && m_fast4.empty()) return true;
+
+    m_position.assign(":");
+    m_position += position_string(cluster.get_position().x);
+    m_position += ":";
+    m_position += position_string(cluster.get_position().y);
+
+    int pf = cluster.is_valid() ? 0 : 1;
+    for(int end=0;end<ends();end++) {
+      size_t first,last;
+      end_range(end,cycles,first,last);
+
+      m_id.assign(m_tag);
+      m_id += end_tag(end);
+      m_id += m_position;
+
+      size_t writer = (pf*ends())+end;
+      if(writer < m_fastq.size()) m_fastq[writer]->write(m_id,prb+first,last-first);
+      if(writer < m_fast4.size()) m_fast4[writer]->write(m_id,prb+first,last-first);
+    }
+
+    return true;
+  }
+
+  /// Flushes and closes all the files
+  void close() {
+    for(size_t n=0;n<m_fastq.size();n++) { m_fastq[n]->close(); delete m_fastq[n]; }
+    for(size_t n=0;n<m_fast4.size();n++) { m_fast4[n]->close(); delete m_fast4[n]; }
+    m_fastq.clear();
+    m_fast4.clear();
+  }
+
+private:
+
+  int ends() const {
+    return (m_pair_break < 0) ? 1 : 2;
+  }
+
+  string file_suffix(int pf,int end) const {
+    string s = (pf == 0) ? ".pf" : ".nonpf";
+    if(m_pair_break >= 0) s += (end == 0) ? ".end1" : ".end2";
+    if(m_compression != 0) s += ".gz";
+    return s;
+  }
+
+  const char *end_tag(int end) const {
+    if(m_pair_break < 0) return "";
+    return (end == 0) ? ":end1" : ":end2";
+  }
+
+  /// Cycles [first,last) of an end, as ProbabilitySequence::trim(0,pair_break-1) and trim(pair_break,-1)
+  void end_range(int end,size_t cycles,size_t &first,size_t &last) const {
+    first = 0;
+    last  = cycles;
+    if(m_pair_break < 0) return;
+
+    size_t pair_break = (static_cast<size_t>(m_pair_break) < cycles) ? m_pair_break : cycles;
+    if(end == 0) last  = pair_break;
+            else first = pair_break;
+  }
+
+  template<class _type>
+  static string position_string(_type v) { return stringify(v); }
+  static string position_string(int v)   { return to_string(v); }
+
+  PrbBaseCaller<_prec,_prbprec>               m_base_caller;
+  string                                      m_tag;
+  int                                         m_pair_break;
+  bool                                        m_store;             ///< Keep the calls in the clusters
+  BgzfPool                                   *m_compression;       ///< Deflates the files, 0 for plain text
+  string                                      m_target_sequenceid; ///< Sequence ID to keep them as
+  vector<FastqWriter *>                       m_fastq;             ///< [pf*ends()+end], pf is 0 and nonpf 1
+  vector<Fast4Writer<size_t,_prbprec> *>      m_fast4;             ///< As m_fastq
+  vector<BaseProbability<_prbprec> >          m_scratch;           ///< Calls for the cluster being written
+  string                                      m_position;          ///< :x:y of the cluster being written
+  string                                      m_id;                ///< Read id being written
+};
+
+#endif
@@ -0,0 +1,172 @@
+/*
+    Swift (c) 2008 Genome Research Ltd.
+    Authors: Nava Whiteford and Tom Skelly (new@sgenomics.org ts6@sanger.ac.uk)
+
+    This file is part of Swift (http://swiftng.sourceforge.net).
+
+    Swift is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Swift is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with Swift.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SWIFT_CROSSTALKBINS_H
+#define SWIFT_CROSSTALKBINS_H
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include "Quantile.h"
+
+using namespace std;
+
+/// Bins crosstalk (x,y) pairs along x, for the crosstalk estimates of CrossTalkCorrection and PureCrossTalkCorrection.
+///
+/// Nothing is sorted. The x values are bucketed once into a fine histogram (a few points per cell, cells
+/// equal in x), built on first use. Percentiles are then found within a single cell, and the number of
+/// points in any range of x from the cells it covers, scanning only the cell at each end. So counting the
+/// points in a set of bins costs O(bins) whatever the number of points, and the lowest point of each bin
+/// takes a single pass, its bin computed from its x.
+///
+/// Results match a linear scan of each bin over the points in their original order: ties on y are
+/// resolved in favour of the point which came first.
+class CrossTalkBins {
+public:
+
+  CrossTalkBins(const vector<double> &x,const vector<double> &y) : m_x(x), m_y(y), m_low(0), m_scale(0) {
+  }
+
+  inline size_t size() const {
+    return m_x.size();
+  }
+
+  /// The value of x at percentile_limit percent, what select_percentile would return. There must be some points.
+  double percentile(int percentile_limit) {
+    if(m_first.empty()) make_histogram();
+
+    size_t position = percentile_position(m_x.size(),percentile_limit);
+    if(position >= m_x.size()) position = m_x.size()-1;
+
+    size_t cell = upper_bound(m_first.begin(),m_first.end(),position) - m_first.begin() - 1;
+    vector<double> in_cell(m_cell_x.begin()+m_first[cell],m_cell_x.begin()+m_first[cell+1]);
+    return select_nth(in_cell,position-m_first[cell]);
+  }
+
+  /// Counts the points with start < x <= end in each bin, bin b running from lower+(binsize*b) to
+  /// lower+(binsize*b)+binsize (in _prec, as the callers compute them). Only the histogram is used.
+  template<class _prec>
+  void count(_prec lower,_prec binsize,int num_bins,vector<int> &counts) {
+    if(m_first.empty()) make_histogram();
+
+    vector<double> start,end;
+    bin_edges(lower,binsize,num_bins,start,end);
+
+    counts.assign(start.size(),0);
+    for(size_t b=0;b<start.size();b++) {
+      if(start[b] < end[b]) counts[b] = at_or_below(end[b])-at_or_below(start[b]);
+    }
+  }
+
+  /// As count, and if a bin has any points sets lowest[b] to the index of the one with the lowest y. One pass over the points.
+  template<class _prec>
+  void bin(_prec lower,_prec binsize,int num_bins,vector<int> &counts,vector<size_t> &lowest) const {
+    vector<double> start,end;
+    bin_edges(lower,binsize,num_bins,start,end);
+
+    counts.assign(start.size(),0);
+    lowest.assign(start.size(),0);
+    if(counts.empty()) return;
+
+    for(size_t n=0;n<m_x.size();n++) {
+      double x = m_x[n];
+
+      // Rounding in the bin edges can put x a bin either side of where it falls arithmetically,
+      // or in two bins at once, so step to the first bin it's in and take every one it's in.
+      double f = floor((x-lower)/binsize);
+      int b = !(f >= 0) ? 0 : ((f >= num_bins) ? num_bins-1 : static_cast<int>(f));
+      while((b > 0) && (x <= end[b-1])) b--;
+      while((b < num_bins) && !(x <= end[b])) b++;
+
+      for(;(b < num_bins) && (start[b] < x);b++) {
+        if((counts[b] == 0) || (m_y[n] < m_y[lowest[b]])) lowest[b] = n;
+        counts[b]++;
+      }
+    }
+  }
+
+  /// The points with x > y, those on the x arm of the crosstalk plot, appended to xo and yo in order
+  void arm(vector<double> &xo,vector<double> &yo) const {
+    for(size_t n=0;n<m_x.size();n++) {
+      if(m_x[n] > m_y[n]) {
+        xo.push_back(m_x[n]);
+        yo.push_back(m_y[n]);
+      }
+    }
+  }
+
+private:
+
+  static const size_t points_per_cell = 4;
+
+  /// Buckets the x values into equal cells from the lowest x to the highest
+  void make_histogram() {
+    size_t cells = (m_x.size()/points_per_cell)+1;
+    m_low = *min_element(m_x.begin(),m_x.end());
+    double high = *max_element(m_x.begin(),m_x.end());
+    m_scale = (high > m_low) ? cells/(high-m_low) : 0;
+
+    m_first.assign(cells+1,0);
+    for(size_t n=0;n<m_x.size();n++) m_first[cell_of(m_x[n])+1]++;
+    for(size_t c=0;c<cells;c++) m_first[c+1] += m_first[c];
+
+    vector<size_t> next(m_first.begin(),m_first.end()-1);
+    m_cell_x.resize(m_x.size());
+    for(size_t n=0;n<m_x.size();n++) m_cell_x[next[cell_of(m_x[n])]++] = m_x[n];
+  }
+
+  inline size_t cell_of(double x) const {
+    size_t cells = m_first.size()-1;
+    double offset = (x-m_low)*m_scale;
+    return (offset < cells) ? static_cast<size_t>(offset) : cells-1;
+  }
+
+  /// Number of points with x <= t. Cells are ordered in x, so only t's own cell is scanned.
+  size_t at_or_below(double t) const {
+    if(!(t >= m_low)) return 0;
+
+    size_t cell  = cell_of(t);
+    size_t count = m_first[cell];
+    for(size_t n=m_first[cell];n<m_first[cell+1];n++) if(m_cell_x[n] <= t) count++;
+    return count;
+  }
+
+  /// Edges of the bins, computed in _prec and in the same order as the callers do
+  template<class _prec>
+  static void bin_edges(_prec lower,_prec binsize,int num_bins,vector<double> &start,vector<double> &end) {
+    start.resize((num_bins > 0) ? num_bins : 0);
+    end  .resize(start.size());
+    for(int b=0;b<num_bins;b++) {
+      _prec bin_start = lower+(binsize*b);
+      _prec bin_end   = lower+(binsize*b)+binsize;
+      start[b] = bin_start;
+      end  [b] = bin_end;
+    }
+  }
+
+  const vector<double> &m_x;
+  const vector<double> &m_y;
+  vector<size_t>        m_first;  ///< Histogram of x: cell c holds m_cell_x[m_first[c] .. m_first[c+1]), empty until first used
+  vector<double>        m_cell_x; ///< x values grouped by cell
+  double                m_low;    ///< x at the start of the first cell
+  double                m_scale;  ///< Cells per unit of x
+};
+
+#endif
@@ -32,13 +32,8 @@
 #include "clusterfilter_blobs.h"
 #include "plotfunctions.h"
 #include "Timetagger.h"
+#include "CrossTalkBins.h"
 
-template<class _prec>
-_prec CrossTalkCorrection<_prec>::get_percentile(vector<double> c,int percentile_limit) {
-  sort(c.begin(),c.end());
-
-  return c[static_cast<int>((static_cast<double>(percentile_limit)/100)*static_cast<double>(c.size()))];
-}
                                                 
 
 template<class _prec>
@@ -53,8 +48,11 @@ void CrossTalkCorrection<_prec>::make_bins(vector<double> &x,             /// X
   // 1.1.3.1 Find position in count vector where we go over lower percentile limit
   // 1.1.3.2 Find position in count vector where we go over upper percentile limit
   
-  _prec percentile_lower_limit_position = get_percentile(x,crosstalk_lowerpercentile); // 65
-  _prec percentile_upper_limit_position = get_percentile(x,crosstalk_upperpercentile); // 95
+  // Each bin count tried below is counted from a histogram of x, only the one settled on is binned over the points
+  CrossTalkBins points(x,y);
+
+  _prec percentile_lower_limit_position = points.percentile(crosstalk_lowerpercentile); // 65
+  _prec percentile_upper_limit_position = points.percentile(crosstalk_upperpercentile); // 95
 
   err << "Lower percentile Limit: " << percentile_lower_limit_position << endl;
   err << "Upper percentile Limit: " << percentile_upper_limit_position << endl;
@@ -64,7 +62,7 @@ void CrossTalkCorrection<_prec>::make_bins(vector<double> &x,             /// X
   vector<double> bins;
   vector<double> bins_x;
 
-  // I'm iteratively trying bin sizes, until I find one that has ten or fewer points per bin. TODO: this is inefficient, fix it.
+  // I'm iteratively trying bin sizes, until I find one that has ten or fewer points per bin.
   
   _prec bin_size_required=crosstalk_bin_size_required;
   _prec bin_threshold = crosstalk_bin_threshold;
@@ -76,54 +74,25 @@ cout << "bin_threshold    : " << bin_threshold << endl;
   _prec last_num_bins = current_num_bins*2;
   int itteration_limit=20;
   int itterations=0;
+  int   used_num_bins = 0;
+  _prec used_binsize  = 0;
   for(;(abs(average_in_bins-bin_size_required) > bin_threshold) && (itterations < itteration_limit);itterations++) {
-    // 2.1 We are taking bins across the x-axis and finding the smallest y-value in those bins
-    vector<bool>  bins_first(current_num_bins,true);
+    // 2.1 We are taking bins across the x-axis, only those at either end count
     vector<int>  num_in_bins(current_num_bins,0);
 
-    bins.clear();
-    bins_x.clear();
-    for(int n=0;n<=current_num_bins;n++) bins  .push_back(0);
-    for(int n=0;n<=current_num_bins;n++) bins_x.push_back(0);
     _prec binsize = (percentile_upper_limit_position-percentile_lower_limit_position)/current_num_bins;
     cout << "Bin size: " << binsize << endl;
 
-    for(unsigned int n = 0;n < x.size();n++) {
-      // this is very inefficient...
-      for(int current_bin_number=0;current_bin_number<current_num_bins;current_bin_number++) {
-        if((current_bin_number<50) || (current_bin_number>(current_num_bins-50))) {
-          _prec current_bin_start = percentile_lower_limit_position+(binsize*current_bin_number);
-          _prec current_bin_end   = percentile_lower_limit_position+(binsize*current_bin_number)+binsize;
-
-         // cout << "bin start: " << current_bin_start << endl;
-         // cout << "bin   end: " << current_bin_end << endl;
-
-          if((x[n] > current_bin_start) && (x[n] <= current_bin_end)) {
-            if(bins_first[current_bin_number] || (bins[current_bin_number] > y[n])) { bins  [current_bin_number] = static_cast<double>(y[n]);
-                                                                                      bins_x[current_bin_number] = static_cast<double>(x[n]); }
-            bins_first[current_bin_number] = false;
-
-            num_in_bins[current_bin_number]++;
-          }
-        }
-      }
-    }
+    vector<int> in_bin;
+    points.count(percentile_lower_limit_position,binsize,current_num_bins,in_bin);
 
-    vector<double> bins_real;
-    vector<double> bins_x_real;
-    int real_bins=0;
-    for(size_t n=0;n<bins_first.size();n++) {
-      if((bins_first[n] == false) && (((bins[n] > 1) || (bins[n] < -1)) && ((bins_x[n] > 1) || (bins_x[n] < -1)))) {
-        bins_real  .push_back(bins[n]);
-        bins_x_real.push_back(bins_x[n]);
-        real_bins++;
-      } else {
-        err << "Removing empty or zero bin: " << n << endl;
+    for(int current_bin_number=0;current_bin_number<current_num_bins;current_bin_number++) {
+      if((current_bin_number<50) || (current_bin_number>(current_num_bins-50))) {
+        num_in_bins[current_bin_number] = in_bin[current_bin_number];
       }
     }
-    bins   = bins_real;
-    bins_x = bins_x_real;
-
+    used_num_bins = current_num_bins;
+    used_binsize  = binsize;
  
     int total=0;
     bool first=true;
@@ -152,6 +121,21 @@ cout << "bin_threshold    : " << bin_threshold << endl;
     err << m_tt.str() << "Current number of bins (new): " << current_num_bins << endl;
     if(current_num_bins < 0) current_num_bins = 1;
   }
+
+  // 2.2 Finding the smallest y-value in each bin at either end of the last bin count tried
+  vector<int>    in_bin;
+  vector<size_t> lowest;
+  points.bin(percentile_lower_limit_position,used_binsize,used_num_bins,in_bin,lowest);
+
+  for(int n=0;n<used_num_bins;n++) {
+    bool end_bin = (n<50) || (n>(used_num_bins-50));
+    if(end_bin && (in_bin[n] > 0) && ((y[lowest[n]] > 1) || (y[lowest[n]] < -1)) && ((x[lowest[n]] > 1) || (x[lowest[n]] < -1))) {
+      bins  .push_back(static_cast<double>(y[lowest[n]]));
+      bins_x.push_back(static_cast<double>(x[lowest[n]]));
+    } else {
+      err << "Removing empty or zero bin: " << n << endl;
+    }
+  }
   err << m_tt.str() << "Using " << bins.size() << " bins" << endl;
 
   xo = bins_x;
@@ -203,7 +187,7 @@ bool CrossTalkCorrection<_prec>::regression_arm(vector<double> &x,             /
 
 /// Generate crosstalk matrix
 template<class _prec>
-bool CrossTalkCorrection<_prec>::initialise(const vector<Cluster<_prec> > &clusters,int c_cycle,string signalid) {
+bool CrossTalkCorrection<_prec>::initialise(const vector<Cluster<_prec> > &clusters,int c_cycle,const SignalId &signalid) {
   // I'm going to correct G/T and C/G independently
   // I'm going to base matrix construction on the first cycle only
   A_values.clear();
@@ -279,28 +263,24 @@ bool CrossTalkCorrection<_prec>::initialise(const vector<Cluster<_prec> > &clust
 /// Applies the current matrix to these clusters
 template<class _prec>
 bool CrossTalkCorrection<_prec>::apply_correction(vector<Cluster<_prec> > &clusters, ///< Clusters to process
-                                                  string local_source_signal,        ///< Source signal id
-                                                  string local_target_signal         ///< Target signal id, can be the same as source
+                                                  SignalId local_source_signal,      ///< Source signal id
+                                                  SignalId local_target_signal       ///< Target signal id, can be the same as source
                                                  ) {
 
   for(typename vector<Cluster<_prec> >::iterator i = clusters.begin();i != clusters.end();i++) {
     
-    typename Cluster<_prec>::signal_vec_type old_signal;
-    old_signal = (*i).const_signal(local_source_signal);
-    
-    typename Cluster<_prec>::signal_vec_type new_signal;
+    (*i).add_signal(local_target_signal);
 
-    for(typename Cluster<_prec>::signal_vec_type::const_iterator j=old_signal.begin();j != old_signal.end();j++) {
-      ReadIntensity<_prec> corrected = apply_correction(*j);
-      new_signal.push_back(corrected);
-    }
+    // Written element by element, so target may be the source or a recycled buffer, no temporary is needed
+    const typename Cluster<_prec>::signal_vec_type &source = (*i).const_signal(local_source_signal);
+    typename Cluster<_prec>::signal_vec_type       &target = (*i).signal(local_target_signal);
 
-    (*i).add_signal(local_target_signal);
-    (*i).signal(local_target_signal).clear();
-    (*i).signal(local_target_signal) = new_signal;
+    target.resize(source.size());
+    for(size_t n=0;n<source.size();n++) {
+      target[n] = apply_correction(source[n]);
+    }
    
-    //TODO: inefficient
-    (*i).noise(local_target_signal)  = (*i).const_noise(local_source_signal);
+    if(local_source_signal != local_target_signal) (*i).noise(local_target_signal) = (*i).const_noise(local_source_signal);
   }
 
   return true;
@@ -310,22 +290,148 @@ bool CrossTalkCorrection<_prec>::apply_correction(vector<Cluster<_prec> > &clust
 template<class _prec>
 bool CrossTalkCorrection<_prec>::apply_correction(vector<Cluster<_prec> > &clusters, ///< Clusters to process
                                                   int a_cycle,                       ///< Cycle to apply correction to
-                                                  string local_source_signal,        ///< Source signal id
-                                                  string local_target_signal         ///< Target signal id, can be the same as source
+                                                  SignalId local_source_signal,      ///< Source signal id
+                                                  SignalId local_target_signal       ///< Target signal id, can be the same as source
                                                  ) {
 
   for(typename vector<Cluster<_prec> >::iterator i = clusters.begin();i != clusters.end();i++) {
     
-    vector<ReadIntensity<_prec> > new_signal = (*i).const_signal(local_source_signal);
+    (*i).add_signal(local_target_signal);
 
-    new_signal[a_cycle] = apply_correction(new_signal[a_cycle]);
+    if(local_source_signal != local_target_signal) {
+      (*i).signal(local_target_signal) = (*i).const_signal(local_source_signal);
+      (*i).noise(local_target_signal)  = (*i).const_noise(local_source_signal);
+    }
 
-    (*i).add_signal(local_target_signal);
-    (*i).signal(local_target_signal).clear();
-    (*i).signal(local_target_signal) = new_signal;
-   
-    //TODO: inefficient
-    (*i).noise(local_target_signal)  = (*i).const_noise(local_source_signal);
+    typename Cluster<_prec>::signal_vec_type &target = (*i).signal(local_target_signal);
+    target[a_cycle] = apply_correction(target[a_cycle]);
+  }
+
+  return true;
+}
+
+template<class _prec>
+void CrossTalkCorrection<_prec>::reset_composed_correction() {
+  for(int i=0;i<ReadIntensity<_prec>::base_count;i++) {
+    for(int j=0;j<ReadIntensity<_prec>::base_count;j++) composed_correction[i][j] = (i==j) ? 1 : 0;
+  }
+}
+
+/// The correction made by apply_correction(a,c,g,t) as a 4x4 matrix, premultiplied onto composed_correction
+template<class _prec>
+void CrossTalkCorrection<_prec>::compose_correction() {
+  const int a = ReadIntensity<_prec>::base_a;
+  const int c = ReadIntensity<_prec>::base_c;
+  const int g = ReadIntensity<_prec>::base_g;
+  const int t = ReadIntensity<_prec>::base_t;
+
+  double m[ReadIntensity<_prec>::base_count][ReadIntensity<_prec>::base_count] = {{0}};
+
+  // Correct A/C
+  double v = 1/(1-(static_cast<double>(ac_m)*ca_m));
+  m[a][a] = v;
+  m[a][c] = -1*ca_m*v;
+  m[c][a] = -1*ac_m*v;
+  m[c][c] = v;
+
+  // Correct G/T
+  v = 1/(1-(static_cast<double>(gt_m)*tg_m));
+  m[t][t] = v;
+  m[t][g] = -1*gt_m*v;
+  m[g][t] = -1*tg_m*v;
+  m[g][g] = v;
+
+  double product[ReadIntensity<_prec>::base_count][ReadIntensity<_prec>::base_count];
+  for(int i=0;i<ReadIntensity<_prec>::base_count;i++) {
+    for(int j=0;j<ReadIntensity<_prec>::base_count;j++) {
+      product[i][j] = 0;
+      for(int k=0;k<ReadIntensity<_prec>::base_count;k++) product[i][j] += m[i][k]*composed_correction[k][j];
+    }
+  }
+
+  for(int i=0;i<ReadIntensity<_prec>::base_count;i++) {
+    for(int j=0;j<ReadIntensity<_prec>::base_count;j++) composed_correction[i][j] = product[i][j];
+  }
+}
+
+/// Applies the composed correction to these clusters. One pass over the data, clusters are independent so this runs in parallel.
+template<class _prec>
+bool CrossTalkCorrection<_prec>::apply_composed_correction(vector<Cluster<_prec> > &clusters,           ///< Clusters to process
+                                                           const SignalId &local_source_signal,         ///< Source signal id
+                                                           const SignalId &local_target_signal          ///< Target signal id, can be the same as source
+                                                          ) {
+
+  const int base_count = ReadIntensity<_prec>::base_count;
+
+  _prec m[base_count][base_count];
+  for(int i=0;i<base_count;i++) {
+    for(int j=0;j<base_count;j++) m[i][j] = composed_correction[i][j];
+  }
+
+  int cluster_count = clusters.size();
+
+  #if defined(_OPENMP)
+    #pragma omp parallel for schedule(static)
+  #endif
+  for(int n=0;n<cluster_count;n++) {
+    Cluster<_prec> &cluster = clusters[n];
+
+    cluster.add_signal(local_target_signal);
+
+    const typename Cluster<_prec>::signal_vec_type &source = cluster.const_signal(local_source_signal);
+    typename Cluster<_prec>::signal_vec_type       &target = cluster.signal(local_target_signal);
+
+    target.resize(source.size());
+    const ReadIntensity<_prec> *in  = source.data();
+    ReadIntensity<_prec>       *out = target.data();
+    for(size_t cycle=0;cycle<source.size();cycle++) {
+      _prec b[base_count];
+      for(int j=0;j<base_count;j++) b[j] = in[cycle].bases[j];
+
+      for(int i=0;i<base_count;i++) {
+        out[cycle].bases[i] = (m[i][0]*b[0] + m[i][1]*b[1]) + (m[i][2]*b[2] + m[i][3]*b[3]);
+      }
+    }
+
+    if(local_source_signal != local_target_signal) cluster.noise(local_target_signal) = cluster.const_noise(local_source_signal);
+  }
+
+  return true;
+}
+
+/// Applies the composed correction to the rows of a table. Each cycle is a unit stride run of cluster_count*4
+/// values in both signals, clusters within a cycle are independent so each cycle runs in parallel.
+template<class _prec>
+bool CrossTalkCorrection<_prec>::apply_composed_correction(ClusterTable<_prec> &table,             ///< Table to process
+                                                           const string &local_source_signal,     ///< Source signal id
+                                                           const string &local_target_signal      ///< Target signal id, can be the same as source
+                                                          ) {
+
+  const int base_count = ReadIntensity<_prec>::base_count;
+
+  _prec m[base_count][base_count];
+  for(int i=0;i<base_count;i++) {
+    for(int j=0;j<base_count;j++) m[i][j] = composed_correction[i][j];
+  }
+
+  table.add_signal(local_target_signal);
+
+  int cluster_count = table.size();
+  for(size_t cycle=0;cycle<table.cycle_count();cycle++) {
+    typename ClusterTable<_prec>::CycleView in  = table.cycle(local_source_signal,cycle);
+    typename ClusterTable<_prec>::CycleView out = table.cycle(local_target_signal,cycle);
+
+    #if defined(_OPENMP)
+      #pragma omp parallel for schedule(static)
+    #endif
+    for(int n=0;n<cluster_count;n++) {
+      _prec b[base_count];
+      for(int j=0;j<base_count;j++) b[j] = in[n][j];
+
+      for(int i=0;i<base_count;i++) {
+        out[n][i] = (m[i][0]*b[0] + m[i][1]*b[1]) + (m[i][2]*b[2] + m[i][3]*b[3]);
+      }
+    }
   }
 
   return true;
@@ -22,6 +22,7 @@
 #define SWIFT_CROSSTALKCORRECTION_H
 
 #include "Cluster.h"
+#include "ClusterTable.h"
 #include <iostream>
 #include <vector>
 #include "Timetagger.h"
@@ -42,8 +43,8 @@ public:
                       int   crosstalk_bin_threshold_in,
                       int   crosstalk_erode_clusters_per_bin_in,
                       int   crosstalk_erode_num_bins_in,
-                      string source_signalid_in,                 ///< The signal ID to get intensities from
-                      string target_signalid_in, ///< The signal ID to write intensties to
+                      SignalId source_signalid_in,               ///< The signal ID to get intensities from
+                      SignalId target_signalid_in, ///< The signal ID to write intensties to
                       ostream &err_in=std::cerr                        ///< Write debug/errors here
                       ): correction_cycle(correction_cycle_in),
                          iteration_threshold(iteration_threshold_in),
@@ -56,6 +57,7 @@ public:
                          crosstalk_erode_num_bins(crosstalk_erode_num_bins_in),
                          source_signalid(source_signalid_in),
                          target_signalid(target_signalid_in),
+                         iterations(0),
                          err(err_in) {
   }
 
@@ -66,10 +68,8 @@ public:
     gt_m=slope_threshold+1;
     tg_m=slope_threshold+1;
 
-    string local_source_signalid = source_signalid;
-    string local_target_signalid = target_signalid;
-    
     initialise(clusters,correction_cycle,source_signalid);
+    reset_composed_correction();
 
     make_bins(A_values,C_values,A_AC_values,C_AC_values);
     make_bins(C_values,A_values,C_CA_values,A_CA_values);
@@ -77,6 +77,10 @@ public:
     make_bins(T_values,G_values,T_TG_values,G_TG_values);
 
     // We iteratively apply the correction until almost no correction was made.
+    // Slopes are only estimated from correction_cycle, so iterations run on the extracted values
+    // (A_values etc). Each iteration's correction is folded into composed_correction, which is
+    // applied to the whole dataset once at the end.
+    iterations=0;
     for(int n=0;(n<iteration_threshold) && 
                ((abs(ac_m) > slope_threshold) ||
                 (abs(ca_m) > slope_threshold) ||
@@ -96,7 +100,8 @@ public:
       regression_arm(T_TG_values,G_TG_values,tg_m,tg_c);
     
       apply_correction_values();
-      apply_correction(clusters,local_source_signalid,local_target_signalid);
+      compose_correction();
+      iterations++;
       
      // plotxy(A_values,C_values,"Crosstalk AC filtered corrected");
      // plotxy(G_values,T_values,"Crosstalk GT filtered corrected");
@@ -106,21 +111,48 @@ public:
       err << m_tt.str() << "ca_m: " << ca_m << endl;
       err << m_tt.str() << "gt_m: " << gt_m << endl;
       err << m_tt.str() << "tg_m: " << tg_m << endl;
-    
-      local_source_signalid = target_signalid;
-      local_target_signalid = target_signalid;
     }
 
+    if(iterations > 0) apply_composed_correction(clusters,source_signalid,target_signalid);
+
     return true;
   }
 
-  bool initialise(const vector<Cluster<_prec> > &clusters,int cycle,string signalid);
+  /// Corrects clusters process didn't see with the correction it found, as process would have
+  bool apply(vector<Cluster<_prec> > &clusters) {
+    if(iterations > 0) apply_composed_correction(clusters,source_signalid,target_signalid);
+
+    return true;
+  }
+
+  /// As above for the rows of a table
+  bool apply(ClusterTable<_prec> &table) {
+    if(iterations > 0) apply_composed_correction(table,source_signalid.name(),target_signalid.name());
+
+    return true;
+  }
+
+  /// The correction the last process made, [target base][source base] row by row
+  vector<double> correction() const {
+    vector<double> m;
+    for(int t=0;t<ReadIntensity<_prec>::base_count;t++) {
+      for(int b=0;b<ReadIntensity<_prec>::base_count;b++) m.push_back((iterations > 0) ? composed_correction[t][b] : ((t == b) ? 1 : 0));
+    }
+    return m;
+  }
+
+  bool initialise(const vector<Cluster<_prec> > &clusters,int cycle,const SignalId &signalid);
 
   void apply_correction_values();
   void apply_correction(_prec &a_val,_prec &c_val,_prec &g_val,_prec &t_val);
-  bool apply_correction(vector<Cluster<_prec> > &clusters,string local_source_signalid,string local_target_signalid); ///< Applies the current matrix to these clusters
-  bool apply_correction(vector<Cluster<_prec> > &clusters,int cycle,string local_source_signalid,string local_target_signalid); ///< Applies the current matrix to these clusters
+  bool apply_correction(vector<Cluster<_prec> > &clusters,SignalId local_source_signalid,SignalId local_target_signalid); ///< Applies the current matrix to these clusters
+  bool apply_correction(vector<Cluster<_prec> > &clusters,int cycle,SignalId local_source_signalid,SignalId local_target_signalid); ///< Applies the current matrix to these clusters
   ReadIntensity<_prec> apply_correction(const ReadIntensity<_prec> &r);                    ///< Applies a correction matrix to a single intensity set 
+
+  void reset_composed_correction();                                                        ///< Sets the composed correction to identity
+  void compose_correction();                                                               ///< Folds the current slopes into the composed correction
+  bool apply_composed_correction(vector<Cluster<_prec> > &clusters,const SignalId &local_source_signalid,const SignalId &local_target_signalid); ///< Applies the composed correction to these clusters, in one pass
+  bool apply_composed_correction(ClusterTable<_prec> &table,const string &local_source_signalid,const string &local_target_signalid);        ///< As above for a table, a cycle at a time
   
 private:
 
@@ -139,8 +171,6 @@ void make_bins(vector<double> &x,             /// X values
                       _prec         &m,
                       _prec         &c);
  
-  /// Get percentile value for a vector of _precs
-  _prec get_percentile(vector<double> c,int percentile_limit); 
 
   // Get slopes
   _prec ac_m, ac_c;                          ///< Regression values for A/C arm
@@ -159,8 +189,12 @@ void make_bins(vector<double> &x,             /// X values
   int   crosstalk_erode_clusters_per_bin;
   int   crosstalk_erode_num_bins;
 
-  string source_signalid;
-  string target_signalid;
+  SignalId source_signalid;
+  SignalId target_signalid;
+
+  int iterations;                            ///< Iterations made by the last process, none leaves the clusters alone
+
+  double composed_correction[ReadIntensity<_prec>::base_count][ReadIntensity<_prec>::base_count]; ///< Product of the corrections made so far, [target base][source base]
 
   ostream &err;                               ///< Error output will be writen here, set to cerr in constructor default
   Timetagger m_tt;
@@ -32,13 +32,8 @@
 #include "clusterfilter_blobs.h"
 #include "plotfunctions.h"
 #include "Timetagger.h"
+#include "CrossTalkBins.h"
 
-template<class _prec>
-_prec PureCrossTalkCorrection<_prec>::get_percentile(vector<double> c,int percentile_limit) {
-  sort(c.begin(),c.end());
-
-  return c[static_cast<int>((static_cast<double>(percentile_limit)/100)*static_cast<double>(c.size()))];
-}
                                                 
 
 template<class _prec>
@@ -46,12 +41,8 @@ void PureCrossTalkCorrection<_prec>::make_bins(vector<double> &x,             //
                                            vector<double> &y,             /// Y values
                                            vector<double> &xo,
                                            vector<double> &yo) { /// Bins must contain less than this many items
-  for(size_t n=0;n<x.size();n++) {
-    if(x[n] > y[n]) {
-      xo.push_back(x[n]);
-      yo.push_back(y[n]);
-    }
-  }
+  // The pure fit regresses over the whole x arm rather than the lowest point of each bin
+  CrossTalkBins(x,y).arm(xo,yo);
 
   // plotxy(xo,yo,"ctalk for regression");
 }                                           
@@ -100,7 +91,7 @@ bool PureCrossTalkCorrection<_prec>::regression_arm(vector<double> &x,
 
 /// Generate crosstalk matrix
 template<class _prec>
-bool PureCrossTalkCorrection<_prec>::initialise(const vector<Cluster<_prec> > &clusters,int c_cycle,string signalid) {
+bool PureCrossTalkCorrection<_prec>::initialise(const vector<Cluster<_prec> > &clusters,int c_cycle,const SignalId &signalid) {
   // I'm going to correct G/T and C/G independently
   // I'm going to base matrix construction on the first cycle only
   A_values.clear();
@@ -160,28 +151,24 @@ bool PureCrossTalkCorrection<_prec>::initialise(const vector<Cluster<_prec> > &c
 /// Applies the current matrix to these clusters
 template<class _prec>
 bool PureCrossTalkCorrection<_prec>::apply_correction(vector<Cluster<_prec> > &clusters, ///< Clusters to process
-                                                  string local_source_signal,        ///< Source signal id
-                                                  string local_target_signal         ///< Target signal id, can be the same as source
+                                                  SignalId local_source_signal,      ///< Source signal id
+                                                  SignalId local_target_signal       ///< Target signal id, can be the same as source
                                                  ) {
 
   for(typename vector<Cluster<_prec> >::iterator i = clusters.begin();i != clusters.end();i++) {
     
-    typename Cluster<_prec>::signal_vec_type old_signal;
-    old_signal = (*i).const_signal(local_source_signal);
-    
-    typename Cluster<_prec>::signal_vec_type new_signal;
+    (*i).add_signal(local_target_signal);
 
-    for(typename Cluster<_prec>::signal_vec_type::const_iterator j=old_signal.begin();j != old_signal.end();j++) {
-      ReadIntensity<_prec> corrected = apply_correction(*j);
-      new_signal.push_back(corrected);
-    }
+    // Written element by element, so target may be the source or a recycled buffer, no temporary is needed
+    const typename Cluster<_prec>::signal_vec_type &source = (*i).const_signal(local_source_signal);
+    typename Cluster<_prec>::signal_vec_type       &target = (*i).signal(local_target_signal);
 
-    (*i).add_signal(local_target_signal);
-    (*i).signal(local_target_signal).clear();
-    (*i).signal(local_target_signal) = new_signal;
+    target.resize(source.size());
+    for(size_t n=0;n<source.size();n++) {
+      target[n] = apply_correction(source[n]);
+    }
    
-    //TODO: inefficient
-    (*i).noise(local_target_signal)  = (*i).const_noise(local_source_signal);
+    if(local_source_signal != local_target_signal) (*i).noise(local_target_signal) = (*i).const_noise(local_source_signal);
   }
 
   return true;
@@ -191,22 +178,21 @@ bool PureCrossTalkCorrection<_prec>::apply_correction(vector<Cluster<_prec> > &c
 template<class _prec>
 bool PureCrossTalkCorrection<_prec>::apply_correction(vector<Cluster<_prec> > &clusters, ///< Clusters to process
                                                   int a_cycle,                       ///< Cycle to apply correction to
-                                                  string local_source_signal,        ///< Source signal id
-                                                  string local_target_signal         ///< Target signal id, can be the same as source
+                                                  SignalId local_source_signal,      ///< Source signal id
+                                                  SignalId local_target_signal       ///< Target signal id, can be the same as source
                                                  ) {
 
   for(typename vector<Cluster<_prec> >::iterator i = clusters.begin();i != clusters.end();i++) {
     
-    vector<ReadIntensity<_prec> > new_signal = (*i).const_signal(local_source_signal);
+    (*i).add_signal(local_target_signal);
 
-    new_signal[a_cycle] = apply_correction(new_signal[a_cycle]);
+    if(local_source_signal != local_target_signal) {
+      (*i).signal(local_target_signal) = (*i).const_signal(local_source_signal);
+      (*i).noise(local_target_signal)  = (*i).const_noise(local_source_signal);
+    }
 
-    (*i).add_signal(local_target_signal);
-    (*i).signal(local_target_signal).clear();
-    (*i).signal(local_target_signal) = new_signal;
-   
-    //TODO: inefficient
-    (*i).noise(local_target_signal)  = (*i).const_noise(local_source_signal);
+    typename Cluster<_prec>::signal_vec_type &target = (*i).signal(local_target_signal);
+    target[a_cycle] = apply_correction(target[a_cycle]);
   }
 
   return true;
@@ -38,8 +38,8 @@ public:
                       _prec slope_threshold_in,                   ///< Iteration stops when slopes are less than this
                       int purecrosstalk_erode_num_bins_in,
                       int purecrosstalk_purity_highest_how_many_in,
-                      string source_signalid_in ="RAW",                 ///< The signal ID to get intensities from
-                      string target_signalid_in ="CROSSTALK_CORRECTED", ///< The signal ID to write intensties to
+                      SignalId source_signalid_in ="RAW",               ///< The signal ID to get intensities from
+                      SignalId target_signalid_in ="CROSSTALK_CORRECTED", ///< The signal ID to write intensties to
                       ostream &err_in=std::cerr                        ///< Write debug/errors here
                       ): correction_cycle(correction_cycle_in),
                          iteration_threshold(iteration_threshold_in),
@@ -58,10 +58,11 @@ public:
     gt_m=slope_threshold+1;
     tg_m=slope_threshold+1;
 
-    string local_source_signalid = source_signalid;
-    string local_target_signalid = target_signalid;
+    SignalId local_source_signalid = source_signalid;
+    SignalId local_target_signalid = target_signalid;
     
     initialise(clusters,correction_cycle,source_signalid);
+    slopes.clear();
 
     make_bins(A_values,C_values,A_AC_values,C_AC_values);
     make_bins(C_values,A_values,C_CA_values,A_CA_values);
@@ -89,6 +90,7 @@ public:
     
       apply_correction_values();
       apply_correction(clusters,local_source_signalid,local_target_signalid);
+      slopes.push_back(iteration_slopes(ac_m,ca_m,gt_m,tg_m));
       
      // plotxy(A_values,C_values,"Crosstalk AC filtered corrected");
      // plotxy(G_values,T_values,"Crosstalk GT filtered corrected");
@@ -106,12 +108,43 @@ public:
     return true;
   }
 
-  bool initialise(const vector<Cluster<_prec> > &clusters,int cycle,string signalid);
+  /// Corrects clusters process didn't see, repeating the corrections of each of its iterations
+  bool apply(vector<Cluster<_prec> > &clusters) {
+    SignalId local_source_signalid = source_signalid;
+    SignalId local_target_signalid = target_signalid;
+
+    for(size_t n=0;n<slopes.size();n++) {
+      ac_m = slopes[n].ac_m;
+      ca_m = slopes[n].ca_m;
+      gt_m = slopes[n].gt_m;
+      tg_m = slopes[n].tg_m;
+      apply_correction(clusters,local_source_signalid,local_target_signalid);
+
+      local_source_signalid = target_signalid;
+      local_target_signalid = target_signalid;
+    }
+
+    return true;
+  }
+
+  /// The slopes corrected by each iteration of the last process, ac, ca, gt and tg in turn
+  vector<double> correction() const {
+    vector<double> v;
+    for(size_t n=0;n<slopes.size();n++) {
+      v.push_back(slopes[n].ac_m);
+      v.push_back(slopes[n].ca_m);
+      v.push_back(slopes[n].gt_m);
+      v.push_back(slopes[n].tg_m);
+    }
+    return v;
+  }
+
+  bool initialise(const vector<Cluster<_prec> > &clusters,int cycle,const SignalId &signalid);
 
   void apply_correction_values();
   void apply_correction(_prec &a_val,_prec &c_val,_prec &g_val,_prec &t_val);
-  bool apply_correction(vector<Cluster<_prec> > &clusters,string local_source_signalid,string local_target_signalid); ///< Applies the current matrix to these clusters
-  bool apply_correction(vector<Cluster<_prec> > &clusters,int cycle,string local_source_signalid,string local_target_signalid); ///< Applies the current matrix to these clusters
+  bool apply_correction(vector<Cluster<_prec> > &clusters,SignalId local_source_signalid,SignalId local_target_signalid); ///< Applies the current matrix to these clusters
+  bool apply_correction(vector<Cluster<_prec> > &clusters,int cycle,SignalId local_source_signalid,SignalId local_target_signalid); ///< Applies the current matrix to these clusters
   ReadIntensity<_prec> apply_correction(const ReadIntensity<_prec> &r);                    ///< Applies a correction matrix to a single intensity set 
 
 private:
@@ -128,8 +161,13 @@ void make_bins(vector<double> &x,             /// X values
                       _prec         &m,
                       _prec         &c);
  
-  /// Get percentile value for a vector of _precs
-  _prec get_percentile(vector<double> c,int percentile_limit); 
+
+  /// The slopes an iteration of process corrected with
+  struct iteration_slopes {
+    iteration_slopes(_prec ac,_prec ca,_prec gt,_prec tg) : ac_m(ac), ca_m(ca), gt_m(gt), tg_m(tg) {}
+    _prec ac_m, ca_m, gt_m, tg_m;
+  };
+  vector<iteration_slopes> slopes;           ///< Slopes of each iteration of the last process, replayed by apply
 
   // Get slopes
   _prec ac_m, ac_c;                          ///< Regression values for A/C arm
@@ -145,8 +183,8 @@ void make_bins(vector<double> &x,             /// X values
   int purecrosstalk_erode_num_bins;
   int purecrosstalk_purity_highest_how_many;
 
-  string source_signalid;
-  string target_signalid;
+  SignalId source_signalid;
+  SignalId target_signalid;
 
   ostream &err;                               ///< Error output will be writen here, set to cerr in constructor default
   Timetagger m_tt;
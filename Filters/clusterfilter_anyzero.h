@@ -31,7 +31,7 @@ template<class _prec=double>
 class ClusterFilter_AnyZero {
 public:
 
-  ClusterFilter_AnyZero(string signalid_in,int cycle_in=1) : signalid(signalid_in), cycle(cycle_in) {
+  ClusterFilter_AnyZero(SignalId signalid_in,int cycle_in=1) : signalid(signalid_in), cycle(cycle_in) {
   }
 
   Cluster<_prec> process(const Cluster<_prec> &c) {
@@ -50,7 +50,7 @@ public:
     } else return true;
   }
 
-  string signalid;
+  SignalId signalid;
   int cycle;
 };
 
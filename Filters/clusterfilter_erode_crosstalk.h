@@ -40,7 +40,7 @@ public:
                                int                                      threshold_in = 10,                                 ///< If this number of pairs in a bin, keep them 
                                typename ReadIntensity<_prec>::base_type base_x_in    = ReadIntensity<_prec>::base_a,       ///< First base for pair, intensity taken from first cycle of this
                                typename ReadIntensity<_prec>::base_type base_y_in    = ReadIntensity<_prec>::base_c,       ///< Second base for pair
-                               string source_signalid_in                             = "RAW",                              ///< Use this signal type
+                               SignalId source_signalid_in                             = "RAW",                            ///< Use this signal type
                                ostream                                 &err_in       = std::cerr                           ///< Write errors here
                              ) : bin_count(bin_count_in),
                                  threshold(threshold_in),
@@ -90,7 +90,7 @@ private:
   int threshold;                                   ///< Minimum number of clusters per bin
   typename ReadIntensity<_prec>::base_type base_x; ///< Base in X direction to erode
   typename ReadIntensity<_prec>::base_type base_y; ///< Base in Y direction to erode
-  string source_signalid;                          ///< Signal ID to read data from.
+  SignalId source_signalid;                        ///< Signal ID to read data from.
   ostream &err;                                    ///< Stream to write errors/debugging info to
 
 };
@@ -24,6 +24,7 @@
 #include <vector>
 #include <iostream>
 #include "Cluster.h"
+#include "ClusterTable.h"
 
 using namespace std;
 
@@ -32,7 +33,7 @@ template<class _prec=double>
 class ClusterFilter_FirstOffEdge {
 public:
 
-  ClusterFilter_FirstOffEdge(string signalid_in,int  howmany_in=1) : signalid(signalid_in), howmany(howmany_in) {
+  ClusterFilter_FirstOffEdge(SignalId signalid_in,int  howmany_in=1) : signalid(signalid_in), howmany(howmany_in) {
   }
 
   void process(vector<Cluster<_prec> > &clusters) {
@@ -41,6 +42,24 @@ public:
     }
   }
 
+  /// As above for the rows of a table, a cycle at a time
+  void process(ClusterTable<_prec> &table) {
+    const string &id = signalid.name();
+    for(size_t pos=0;(pos<static_cast<size_t>(howmany)) && (pos<table.cycle_count());pos++) {
+      typename ClusterTable<_prec>::CycleView view = table.cycle(id,pos);
+      const typename ClusterTable<_prec>::offedge_type *o = table.const_offedge_data(id)+(pos*table.size());
+
+      for(size_t n=0;n<table.size();n++) {
+        if(ReadIntensity<_prec>::off_edge(o[n])) table.set_valid(n,false);
+
+        const _prec *i = view[n];
+        for(int b=0;b<ReadIntensity<_prec>::base_count;b++) {
+          if((i[b] > -1) && (i[b] < 1)) table.set_valid(n,false);
+        }
+      }
+    }
+  }
+
   Cluster<_prec> process_create(const Cluster<_prec> &c) {
     Cluster<_prec> co = c;
 
@@ -63,7 +82,7 @@ public:
     }
   }
 
-  string signalid;
+  SignalId signalid;
   int howmany;
 };
 
@@ -37,8 +37,8 @@ template<class _prec=double>
 class ClusterFilter_HeuristicFix {
 public:
 
-  ClusterFilter_HeuristicFix(string    source_signalid_in="CROSSTALK_CORRECTED", ///< Read signals from this ID
-                             string    target_signalid_in="NORMALISE_CORRECTED", ///< Write signals to this ID
+  ClusterFilter_HeuristicFix(SignalId  source_signalid_in="CROSSTALK_CORRECTED", ///< Read signals from this ID
+                             SignalId  target_signalid_in="NORMALISE_CORRECTED", ///< Write signals to this ID
                               ostream &err_in            =std::cerr              ///< Write debug/errors here.
                              ) : source_signalid(source_signalid_in),
                                  target_signalid(target_signalid_in),
@@ -99,8 +99,8 @@ public:
   }
 
 private:
-  string source_signalid;                        ///< Signal ID to read data from.
-  string target_signalid;                        ///< Signal ID to write data to.
+  SignalId source_signalid;                      ///< Signal ID to read data from.
+  SignalId target_signalid;                      ///< Signal ID to write data to.
   ostream &err;                                  ///< Stream to write errors/debugging info to
   
 };
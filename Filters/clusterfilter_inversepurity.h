@@ -31,7 +31,7 @@ public:
 
   ClusterFilter_InversePurity(int num_bases_in             =12,           ///< Minimal purity with first num_bases_in bases
                               double purity_threshold_in   =0.9,          ///< Purity is less than this
-                              std::string source_signal_id_in="RAW"       ///< Use this signal to determine purity
+                              SignalId    source_signal_id_in="RAW"       ///< Use this signal to determine purity
                              ) : num_bases(num_bases_in),
                                  purity_threshold(purity_threshold_in),
                                  source_signal_id(source_signal_id_in) {
@@ -51,7 +51,7 @@ public:
 
   unsigned int num_bases;     ///< Number of bases over which to find minimal purity
   double purity_threshold;    ///< Threshold (purity greater than this is bad)
-  string source_signal_id;    ///< Signal on which to determine purity
+  SignalId source_signal_id;  ///< Signal on which to determine purity
 };
 
 #endif
@@ -36,8 +36,8 @@ class ClusterFilter_MakePositive {
 public:
 
   ClusterFilter_MakePositive(const vector<Cluster<_prec> > &clusters,                        ///< Process these clusters
-                             string                         source_signalid_in="RAW",        ///< Read from this signal ID
-                             string                         target_signalid_in="RAW",        ///< Write to this signal ID
+                             SignalId                       source_signalid_in="RAW",        ///< Read from this signal ID
+                             SignalId                       target_signalid_in="RAW",        ///< Write to this signal ID
                              ostream                       &err_in            =std::cerr     ///< Write errors/debug info here
                             ) : source_signalid(source_signalid_in),
                                 target_signalid(target_signalid_in),
@@ -95,8 +95,8 @@ private:
     else add_to_base_intensity = 0;
   }
   
-  string source_signalid;                          ///< Signal ID to read data from.
-  string target_signalid;                          ///< Signal ID to write data to.
+  SignalId source_signalid;                        ///< Signal ID to read data from.
+  SignalId target_signalid;                        ///< Signal ID to write data to.
   ostream &err;                                    ///< Stream to write errors/debugging info to
   
   _prec min_base_intensity;                        ///< Minimum intensity found
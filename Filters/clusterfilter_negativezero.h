@@ -36,8 +36,8 @@ template<class _prec=double>
 class ClusterFilter_NegativeZero {
 public:
 
-  ClusterFilter_NegativeZero(string source_signalid_in  ="RAW",            ///< Read signal from here
-                             string target_signalid_in  ="RAW",            ///< Write signal here
+  ClusterFilter_NegativeZero(SignalId source_signalid_in  ="RAW",          ///< Read signal from here
+                             SignalId target_signalid_in  ="RAW",          ///< Write signal here
                              ostream &err_in            =std::cerr         ///< Write errors here
                             ) : source_signalid(source_signalid_in),
                                 target_signalid(target_signalid_in),
@@ -70,8 +70,8 @@ public:
   }
 
 private:
-  string source_signalid;                          ///< Signal ID to read data from.
-  string target_signalid;                          ///< Signal ID to write data to.
+  SignalId source_signalid;                        ///< Signal ID to read data from.
+  SignalId target_signalid;                        ///< Signal ID to write data to.
   ostream &err;                                    ///< Stream to write errors/debugging info to
   
 };
@@ -26,6 +26,7 @@
 #include <iomanip>
 #include "ReadIntensity.h"
 #include "Cluster.h"
+#include "Quantile.h"
 #include "Timetagger.h"
 
 using namespace std;
@@ -36,8 +37,8 @@ class ClusterFilter_Normalise {
 public:
 
   ClusterFilter_Normalise(const vector<Cluster<_prec> > &clusters,                                  ///< Determine median from here
-                          string                         source_signalid_in="CROSSTALK_CORRECTED",  ///< Read signals from here
-                          string                         target_signalid_in="NORMALISE_CORRECTED",  ///< Write signals here
+                          SignalId                       source_signalid_in="CROSSTALK_CORRECTED",  ///< Read signals from here
+                          SignalId                       target_signalid_in="NORMALISE_CORRECTED",  ///< Write signals here
                           ostream                       &err_in            =std::cerr               ///< Write errors here
                          ) : source_signalid(source_signalid_in),
                              target_signalid(target_signalid_in),
@@ -107,10 +108,8 @@ private:
         }
 
         if(cycle < average_base_intensity.size()) {
-          sort(all_average_base_intensity.begin(),all_average_base_intensity.end());
-         
           if((all_average_base_intensity.size()/2) < all_average_base_intensity.size()) {
-            average_base_intensity[cycle][base] = all_average_base_intensity[ all_average_base_intensity.size()/2 ];
+            average_base_intensity[cycle][base] = select_median(all_average_base_intensity);
             cout << m_tt.str() << "median cycle: " << right << setw(2) << cycle+1 
               << " base " << ReadIntensity<>::base_name[base] << ": " << average_base_intensity[cycle][base] << endl;
           }
@@ -126,8 +125,8 @@ private:
     //}
   }
   
-  string source_signalid;                        ///< Signal ID to read data from.
-  string target_signalid;                        ///< Signal ID to write data to.
+  SignalId source_signalid;                      ///< Signal ID to read data from.
+  SignalId target_signalid;                      ///< Signal ID to write data to.
   ostream &err;                                  ///< Stream to write errors/debugging info to
   Timetagger m_tt;
 
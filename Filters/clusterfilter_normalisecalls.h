@@ -25,6 +25,7 @@
 #include <iostream>
 #include "ReadIntensity.h"
 #include "Cluster.h"
+#include "Quantile.h"
 #include "clusterfilter_purity.h"
 
 using namespace std;
@@ -37,8 +38,8 @@ public:
 
   ClusterFilter_NormaliseCalls(const vector<Cluster<_prec> > &clusters,
                                _prec purity_threshold_in=0.75,
-                               string source_signalid_in="CROSSTALK_CORRECTED",
-                               string target_signalid_in="NORMALISE_CORRECTED",
+                               SignalId source_signalid_in="CROSSTALK_CORRECTED",
+                               SignalId target_signalid_in="NORMALISE_CORRECTED",
                                ostream &err_in=std::cerr
                               ) : purity_threshold(purity_threshold_in),
                                   source_signalid(source_signalid_in),
@@ -74,8 +75,7 @@ public:
           //average_base_intensity[cycle][base] += c.const_signal(source_signalid)[cycle].get_base(base);
         }
 
-        sort(all_average_base_intensity.begin(),all_average_base_intensity.end());
-        average_base_intensity[cycle][base] = all_average_base_intensity[all_average_base_intensity.size()/2];
+        average_base_intensity[cycle][base] = select_median(all_average_base_intensity);
         cout << "median cycle: " << cycle << " base " << base << ": " << average_base_intensity[cycle][base] << endl;
       }
     }
@@ -114,8 +114,8 @@ public:
 
 private:
   _prec  purity_threshold;
-  string source_signalid;                        ///< Signal ID to read data from.
-  string target_signalid;                        ///< Signal ID to write data to.
+  SignalId source_signalid;                      ///< Signal ID to read data from.
+  SignalId target_signalid;                      ///< Signal ID to write data to.
   ostream &err;                                  ///< Stream to write errors/debugging info to
   
   vector<vector<_prec> > average_base_intensity; ///< Average base intensity cycle/base
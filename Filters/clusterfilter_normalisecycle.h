@@ -25,6 +25,7 @@
 #include <iostream>
 #include "ReadIntensity.h"
 #include "Cluster.h"
+#include "Quantile.h"
 
 using namespace std;
 
@@ -33,8 +34,8 @@ class ClusterFilter_NormaliseCycle {
 public:
 
   ClusterFilter_NormaliseCycle(const vector<Cluster<_prec> > &clusters,
-                               string source_signalid_in="NORMALISE_CORRECTED",
-                               string target_signalid_in="NORMALISECYCLE_CORRECTED",
+                               SignalId source_signalid_in="NORMALISE_CORRECTED",
+                               SignalId target_signalid_in="NORMALISECYCLE_CORRECTED",
                                ostream &err_in=std::cerr
                               ) : source_signalid(source_signalid_in),
                                   target_signalid(target_signalid_in),
@@ -63,8 +64,7 @@ public:
           //average_base_intensity[cycle][base] += (*i).const_signal(source_signalid)[cycle].get_base(base);
         }
 
-        sort(all_average_base_intensity.begin(),all_average_base_intensity.end());
-        average_base_intensity[cycle][base] = all_average_base_intensity[all_average_base_intensity.size()/2];
+        average_base_intensity[cycle][base] = select_median(all_average_base_intensity);
         cout << "median cycle: " << cycle << " base " << base << ": " << average_base_intensity[cycle][base] << endl;
       }
     }
@@ -103,8 +103,8 @@ public:
   }
 
 private:
-  string source_signalid;                        ///< Signal ID to read data from.
-  string target_signalid;                        ///< Signal ID to write data to.
+  SignalId source_signalid;                      ///< Signal ID to read data from.
+  SignalId target_signalid;                      ///< Signal ID to write data to.
   ostream &err;                                  ///< Stream to write errors/debugging info to
   
   vector<vector<_prec> > average_base_intensity; ///< Average base intensity cycle/base
@@ -23,6 +23,7 @@
 
 #include <vector>
 #include <iostream>
+#include "ClusterTable.h"
 
 using namespace std;
 
@@ -31,7 +32,7 @@ template<class _prec=double>
 class ClusterFilter_OffEdge {
 public:
 
-  ClusterFilter_OffEdge(string signalid_in,int threshold_in=1) : signalid(signalid_in), threshold(threshold_in) {
+  ClusterFilter_OffEdge(SignalId signalid_in,int threshold_in=1) : signalid(signalid_in), threshold(threshold_in) {
   }
 
   void process(vector<Cluster<_prec> > &clusters) {
@@ -41,17 +42,30 @@ public:
     }
   }
 
-  Cluster<_prec> process(const Cluster<_prec> c) {
+  /// As above for the rows of a table, counting each row's off edge cycles a cycle at a time
+  void process(ClusterTable<_prec> &table) {
+    vector<int> offedgecount(table.size(),0);
+    const typename ClusterTable<_prec>::offedge_type *o = table.const_offedge_data(signalid.name());
+    for(size_t cycle=0;cycle<table.cycle_count();cycle++) {
+      for(size_t n=0;n<table.size();n++,o++) if(ReadIntensity<_prec>::any_off_edge(*o)) offedgecount[n]++;
+    }
+
+    for(size_t n=0;n<table.size();n++) {
+      if(offedgecount[n] > threshold) table.set_valid(n,false);
+    }
+  }
+
+  Cluster<_prec> process(const Cluster<_prec> &c) {
     Cluster<_prec> co = c;
     if(is_valid(c) == false) co.valid = false;
     return co;
   }
 
-  inline bool is_valid (const Cluster<_prec> c) {
+  inline bool is_valid (const Cluster<_prec> &c) const {
     return ( ! c.any_off_edge(signalid,threshold));
   }
 
-  string signalid;
+  SignalId signalid;
   int threshold;
 };
 
@@ -23,7 +23,11 @@
 
 #include "clusterfunctions.h"
 #include <cstddef>
+#include <cstdlib>
+#include <stdint.h>
 #include <vector>
+#include <unordered_map>
+#include <algorithm>
 #include <iostream>
 #include "ReadIntensity.h"
 #include "Cluster.h"
@@ -37,11 +41,15 @@ using namespace std;
 ///
 /// These clusters are identified as those clusters near each other with have similar
 /// sequence.
+///
+/// Calls are packed 2 bits per cycle so the mismatches between two clusters are a popcount,
+/// and neighbours are found through a sparse grid of cells at least as wide as the window, so cost
+/// follows the number of clusters in the window rather than its area.
 template<class _prec=double>
 class ClusterFilter_OpticalDuplicates {
 public:
 
-  ClusterFilter_OpticalDuplicates(string   signalid_in            ="RAW",           ///< Detect similarity of this signal
+  ClusterFilter_OpticalDuplicates(SignalId signalid_in            ="RAW",           ///< Detect similarity of this signal
                                   int      window_size_in         =4,               ///< Look for similar sequences in this window around each cluster
                                   int      similarity_threshold_in=2,               ///< Allow this many mismatches
                                   ostream &err_in                 =std::cerr        ///< Write errors here
@@ -56,70 +64,215 @@ public:
   /// delete all invalid clusters after processing.
   /// NOTE: This method does not mark any clusters as valid, it is assumed that all clusters are correctly
   ///       marked before processing.
+  ///
+  /// Each pair of similar clusters in a window is compared from both sides: a cluster loses to a
+  /// similar neighbour unless it is strictly purer (so equally pure duplicates both go). Where clusters
+  /// share a position only the last one is seen as a neighbour. The result for each cluster depends
+  /// only on its neighbours, so clusters are decided independently and in parallel.
   bool process(vector<Cluster<_prec> > &c) {
     
     if(c.size() == 0) return false;
 
-    int min_x=c[0].get_position().x;
-    int max_x=c[0].get_position().x;
+    int cluster_count = c.size();
 
-    int min_y=c[0].get_position().y;
-    int max_y=c[0].get_position().y;
+    // 1. Sparse grid, cells are at least as wide as the window so neighbours are in the 3x3 cells around a
+    //    cluster. Small windows get larger cells, so there are fewer to look up. Clusters are sorted by cell,
+    //    cells hold a range of that order.
+    cell_size = (window_size > 16) ? window_size : 16;
 
-    // 1. Find extreme values
-    for(size_t n=0;n<c.size();n++) {
-      if(c[n].get_position().x < min_x) min_x = c[n].get_position().x;
-      if(c[n].get_position().x > max_x) max_x = c[n].get_position().x;
-      
-      if(c[n].get_position().y < min_y) min_y = c[n].get_position().y;
-      if(c[n].get_position().y > max_y) max_y = c[n].get_position().y;
+    vector<pair<uint64_t,int> > keyed(cluster_count);
+    for(int n=0;n<cluster_count;n++) keyed[n] = make_pair(cell_key(cell_of(c[n].get_position().x),cell_of(c[n].get_position().y)),n);
+    sort(keyed.begin(),keyed.end());
+
+    order.resize(cluster_count);
+    cells.clear();
+    vector<size_t> cell_starts;
+    for(int n=0;n<cluster_count;n++) {
+      order[n] = keyed[n].second;
+      if((n == 0) || (keyed[n].first != keyed[n-1].first)) {
+        cells[keyed[n].first] = make_pair(n,n);
+        cell_starts.push_back(n);
+      }
+      cells[keyed[n].first].second = n+1;
     }
 
+    // Where several clusters share a position, only the last is a neighbour (it's the one a position lookup finds)
+    vector<pair<pair<int,int>,int> > positions(cluster_count);
+    for(int n=0;n<cluster_count;n++) positions[n] = make_pair(make_pair(c[n].get_position().x,c[n].get_position().y),n);
+    sort(positions.begin(),positions.end());
 
-    // 2. Build lookup image
-    vector<vector<int> > lookup((max_x-min_x)+1,vector<int>((max_y-min_y)+1,-1));
-    
-    for(size_t n=0;n<c.size();n++) {
-      lookup[c[n].get_position().x-min_x][c[n].get_position().y-min_y] = n;
+    visible.assign(cluster_count,1);
+    for(int n=0;n+1<cluster_count;n++) {
+      if(positions[n].first == positions[n+1].first) visible[positions[n].second] = 0;
     }
 
-    // 3. Create valid/invalid vector
-    vector<bool> validity(c.size(),true);
+    // 2. Calls, packed, and minimum purity. Only needed for clusters with something in their window.
+    paired.assign(cluster_count,0);
+    #if defined(_OPENMP)
+      #pragma omp parallel for schedule(static)
+    #endif
+    for(int n=0;n<cluster_count;n++) paired[n] = for_each_neighbour(c,n,any_neighbour());
 
-    // Iterate over clusters, if there is a purer, similar, valid
-    // cluster in a X by X window, mark this cluster as invalid.
+    size_t max_cycles=0;
+    for(int n=0;n<cluster_count;n++) max_cycles = max(max_cycles,c[n].const_signal(signalid).size());
+    words = (max_cycles+cycles_per_word-1)/cycles_per_word;
 
-    for(size_t n=0;n<c.size();n++) {
-      for(int x=c[n].get_position().x-window_size;x<=c[n].get_position().x+window_size;x++) {
-        for(int y=c[n].get_position().y-window_size;y<=c[n].get_position().y+window_size;y++) {
-          if((x<=max_x) && (y<=max_y) && 
-             (x>=min_x) && (y>=min_y)) {
-          
-            int candidate = lookup[x-min_x][y-min_y];
-            if((candidate != -1) && (static_cast<int>(n) != candidate)) {
-              if(c[n].similarity(c[candidate],signalid) >= (static_cast<int>(c[n].signal(signalid).size())-similarity_threshold)) {
-                if(c[n].min_purity(0,c[n].const_signal(signalid).size()-1,signalid) > c[candidate].min_purity(0,c[candidate].const_signal(signalid).size()-1,signalid)) validity[candidate] = false;
-                                                                                       else validity[n]         = false;
-              }
-            }
-          }
-        }
+    packed.assign(words*cluster_count,0);
+    cycles.resize(cluster_count);
+    purity.resize(cluster_count);
+
+    #if defined(_OPENMP)
+      #pragma omp parallel for schedule(static)
+    #endif
+    for(int n=0;n<cluster_count;n++) {
+      if(!paired[n]) continue;
+
+      // As Cluster::min_purity over every cycle, 0 for an empty signal
+      const typename Cluster<_prec>::signal_vec_type &sig = c[n].const_signal(signalid);
+      cycles[n] = sig.size();
+      _prec min_purity = 0;
+      for(size_t cycle=0;cycle<sig.size();cycle++) {
+        typename ReadIntensity<_prec>::base_type call = sig[cycle].max_base();
+        packed[(n*words)+(cycle/cycles_per_word)] |= static_cast<uint64_t>(call & 3) << (2*(cycle%cycles_per_word));
+
+        _prec p = sig[cycle].purity(call);
+        if((cycle == 0) || (p < min_purity)) min_purity = p;
       }
+      purity[n] = min_purity;
     }
-    
+
+    // 3. Decide each cluster, a cell at a time
+    vector<char> validity(cluster_count,1);
+    int cell_count = cell_starts.size();
+
+    #if defined(_OPENMP)
+      #pragma omp parallel for schedule(dynamic,16)
+    #endif
+    for(int cell=0;cell<cell_count;cell++) {
+      size_t end = (cell+1 < cell_count) ? cell_starts[cell+1] : cluster_count;
+      for(size_t m=cell_starts[cell];m<end;m++) {
+        int n = order[m];
+        if(paired[n] && for_each_neighbour(c,n,loses(*this,n))) validity[n] = 0;
+      }
+    }
+
     // 4. Set validity based on validity vector
     for(size_t n=0;n<c.size();n++) {
-      if(validity[n] == false) c[n].valid=false;
+      if(validity[n] == 0) c[n].valid=false;
     }
 
     return true;
   }
 
 private:
-  string signalid;                                 ///< Signal ID to read data from.
+  static const size_t cycles_per_word = 32;
+
+  /// Cell of a coordinate, rounding down for negative positions
+  inline int64_t cell_of(int v) const {
+    return (v >= 0) ? (v/cell_size) : -(((-static_cast<int64_t>(v))+cell_size-1)/cell_size);
+  }
+
+  static inline uint64_t cell_key(int64_t cx,int64_t cy) {
+    return (static_cast<uint64_t>(cx) << 32) ^ (static_cast<uint64_t>(cy) & 0xFFFFFFFFULL);
+  }
+
+  static inline int popcount(uint64_t v) {
+    #if defined(__GNUC__)
+    return __builtin_popcountll(v);
+    #else
+    int count=0;
+    for(;v;v &= v-1) count++;
+    return count;
+    #endif
+  }
+
+  /// Cycles where the calls of a and b differ. A call differs if either of its two bits does.
+  int mismatches(int a,int b) const {
+    int count=0;
+    for(size_t w=0;w<words;w++) {
+      uint64_t x = packed[(a*words)+w] ^ packed[(b*words)+w];
+      count += popcount((x | (x >> 1)) & 0x5555555555555555ULL);
+    }
+    return count;
+  }
+
+  /// Cluster::similarity, from packed calls
+  int similarity(int a,int b) const {
+    if(cycles[a] != cycles[b]) return 0;
+    return cycles[a] - mismatches(a,b);
+  }
+
+  /// Calls f(other) for each other cluster in the window around n, until it returns true. Returns true if it did.
+  template<class _function>
+  bool for_each_neighbour(const vector<Cluster<_prec> > &c,int n,_function f) const {
+    int x = c[n].get_position().x;
+    int y = c[n].get_position().y;
+    int64_t cx = cell_of(x);
+    int64_t cy = cell_of(y);
+
+    for(int64_t i=cx-1;i<=cx+1;i++) {
+      for(int64_t j=cy-1;j<=cy+1;j++) {
+        typename unordered_map<uint64_t,pair<size_t,size_t> >::const_iterator cell = cells.find(cell_key(i,j));
+        if(cell == cells.end()) continue;
+
+        for(size_t m=cell->second.first;m<cell->second.second;m++) {
+          int other = order[m];
+          if(other == n) continue;
+          if(abs(c[other].get_position().x-x) > window_size) continue;
+          if(abs(c[other].get_position().y-y) > window_size) continue;
+          if(f(other)) return true;
+        }
+      }
+    }
+
+    return false;
+  }
+
+  struct any_neighbour {
+    bool operator()(int) const { return true; }
+  };
+
+  /// True if n is marked invalid by this neighbour, comparing it as the candidate (where the neighbour
+  /// is visible) and as the cluster being searched around (where n is visible).
+  struct loses {
+    loses(const ClusterFilter_OpticalDuplicates<_prec> &f_in,int n_in) : f(f_in), n(n_in) {}
+
+    bool operator()(int other) const {
+      int s = -1;
+
+      // n searching, other as candidate: n goes unless it's purer
+      if(f.visible[other]) {
+        s = f.similarity(n,other);
+        if((s >= (f.cycles[n]-f.similarity_threshold)) && !(f.purity[n] > f.purity[other])) return true;
+      }
+
+      // other searching, n as candidate: n goes if other is purer
+      if(f.visible[n]) {
+        if(s == -1) s = f.similarity(other,n);
+        if((s >= (f.cycles[other]-f.similarity_threshold)) && (f.purity[other] > f.purity[n])) return true;
+      }
+
+      return false;
+    }
+
+    const ClusterFilter_OpticalDuplicates<_prec> &f;
+    int n;
+  };
+
+  SignalId signalid;                               ///< Signal ID to read data from.
   int    window_size;                              ///< Size of window in which to look for similar clusters.
   int    similarity_threshold;                     ///< Clusters must be at least this similar
   ostream &err;                                    ///< Stream to write errors/debugging info to
+
+  int                                   cell_size; ///< Width of a grid cell
+  size_t                                words;     ///< Packed words per cluster
+  vector<uint64_t>                      packed;    ///< Calls, 2 bits per cycle, words per cluster
+  vector<int>                           cycles;    ///< Cycles per cluster
+  vector<_prec>                         purity;    ///< Minimum purity per cluster
+  vector<int>                           order;     ///< Cluster indices sorted by cell
+  vector<char>                          visible;   ///< 0 if a later cluster has the same position
+  vector<char>                          paired;    ///< 1 if there are other clusters in the window
+  unordered_map<uint64_t,pair<size_t,size_t> > cells; ///< Cell key to its range of order
   
 };
 
@@ -0,0 +1,296 @@
+/*
+    Swift (c) 2008 Genome Research Ltd.
+    Authors: Nava Whiteford and Tom Skelly (new@sgenomics.org ts6@sanger.ac.uk)
+
+    This file is part of Swift (http://swiftng.sourceforge.net).
+
+    Swift is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Swift is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with Swift.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SWIFT_CLUSTERFILTER_PIPELINE_H
+#define SWIFT_CLUSTERFILTER_PIPELINE_H
+
+#include <vector>
+#include <tuple>
+#include <iostream>
+#include <iomanip>
+#include <type_traits>
+#include "ReadIntensity.h"
+#include "Cluster.h"
+#include "Quantile.h"
+#include "Timetagger.h"
+
+using namespace std;
+
+/// A chain of per intensity transforms run as two passes over the clusters, however many stages there are.
+///
+/// The first pass is a reduction: every stage which needs statistics (the Normalise medians, the MakePositive
+/// minimum) gathers them from the source signal. It runs a cycle at a time, so a stage only has to hold what it
+/// gathers for one cycle. The second pass copies the source to the target and applies every stage to each
+/// intensity in turn while it's in cache, clusters in parallel.
+///
+/// A stage provides:
+///   bool ready() const                                       - true once its statistics are known
+///   void gather(const ReadIntensity<_prec> &in,size_t cycle) - sees every input intensity, while the stages before it are ready
+///   void end_cycle(size_t cycle)                             - every intensity of the cycle has been gathered, cycles in order
+///   void finish(const vector<ReadIntensity<_prec> > &lowest) - lowest[cycle] is the per base minimum of this stage's input
+///   void apply(ReadIntensity<_prec> &r,size_t cycle) const   - transforms one intensity
+///
+/// Stages after one that isn't ready during gathering only get the minima, which is enough because every
+/// transform here is per base and non-decreasing: the minimum of a stage's input is the transforms before it
+/// applied to the minimum of the source. Results match running the ClusterFilter_ classes one after another.
+template<class _prec,class... _stages>
+class ClusterPipeline {
+public:
+
+  ClusterPipeline(const vector<Cluster<_prec> > &clusters,       ///< Gather statistics from these clusters
+                  SignalId source_signalid_in,                   ///< Read signals from here
+                  SignalId target_signalid_in,                   ///< Write signals here, may be the source
+                  _stages... stages
+                 ) : source_signalid(source_signalid_in),
+                     target_signalid(target_signalid_in),
+                     m_stages(stages...) {
+    initialise(clusters);
+  }
+
+  ClusterPipeline(const vector<Cluster<_prec> > &clusters,       ///< Gather statistics from these clusters
+                  SignalId source_signalid_in,                   ///< Read signals from here
+                  SignalId target_signalid_in                    ///< Write signals here, may be the source
+                 ) : source_signalid(source_signalid_in),
+                     target_signalid(target_signalid_in) {
+    initialise(clusters);
+  }
+
+  /// Process a vector of clusters
+  bool process(vector<Cluster<_prec> > &c) {
+    int cluster_count = c.size();
+
+    #if defined(_OPENMP)
+      #pragma omp parallel for schedule(static)
+    #endif
+    for(int n=0;n<cluster_count;n++) process(c[n]);
+
+    return true;
+  }
+
+  /// Process a single cluster
+  bool process(Cluster<_prec> &c) {
+
+    if(source_signalid != target_signalid) {
+      c.add_signal(target_signalid);
+      c.signal(target_signalid) = c.const_signal(source_signalid);
+      c.noise(target_signalid)  = c.const_noise(source_signalid);
+    }
+
+    typename Cluster<_prec>::signal_vec_type &sig = c.signal(target_signalid);
+    for(size_t cycle=0;cycle<sig.size();cycle++) apply_from(sig[cycle],cycle,stage_index<0>());
+
+    return true;
+  }
+
+private:
+  template<size_t _n> struct stage_index : integral_constant<size_t,_n> {};
+  typedef stage_index<sizeof...(_stages)> end_index;
+
+  /// The reduction pass a cycle at a time, then each stage is finished in order
+  void initialise(const vector<Cluster<_prec> > &clusters) {
+
+    if(clusters.size() == 0) return;
+
+    // Each signal is looked up once
+    vector<const typename Cluster<_prec>::signal_vec_type *> signals;
+    signals.reserve(clusters.size());
+    size_t cycles=0;
+    for(typename vector<Cluster<_prec> >::const_iterator i = clusters.begin();i != clusters.end();i++) {
+      signals.push_back(&(*i).const_signal(source_signalid));
+      if(signals.back()->size() > cycles) cycles = signals.back()->size();
+    }
+
+    vector<ReadIntensity<_prec> > lowest;
+
+    for(size_t cycle=0;cycle<cycles;cycle++) {
+      for(size_t n=0;n<signals.size();n++) {
+        const typename Cluster<_prec>::signal_vec_type &sig = *signals[n];
+        if(cycle >= sig.size()) continue;
+
+        if(cycle == lowest.size()) lowest.push_back(sig[cycle]);
+        for(int b=0;b<ReadIntensity<_prec>::base_count;b++) {
+          if(sig[cycle].get_base(b) < lowest[cycle].get_base(b)) lowest[cycle].set_base(b,sig[cycle].get_base(b));
+        }
+
+        ReadIntensity<_prec> r = sig[cycle];
+        gather_from(r,cycle,stage_index<0>());
+      }
+      end_cycle_from(cycle,stage_index<0>());
+    }
+
+    finish_from(lowest,stage_index<0>());
+  }
+
+  template<size_t _n>
+  void gather_from(ReadIntensity<_prec> &r,size_t cycle,stage_index<_n>) {
+    get<_n>(m_stages).gather(r,cycle);
+    if(!get<_n>(m_stages).ready()) return;
+    get<_n>(m_stages).apply(r,cycle);
+    gather_from(r,cycle,stage_index<_n+1>());
+  }
+  void gather_from(ReadIntensity<_prec> &,size_t,end_index) {}
+
+  template<size_t _n>
+  void end_cycle_from(size_t cycle,stage_index<_n>) {
+    get<_n>(m_stages).end_cycle(cycle);
+    if(!get<_n>(m_stages).ready()) return;
+    end_cycle_from(cycle,stage_index<_n+1>());
+  }
+  void end_cycle_from(size_t,end_index) {}
+
+  template<size_t _n>
+  void finish_from(vector<ReadIntensity<_prec> > &lowest,stage_index<_n>) {
+    if(!get<_n>(m_stages).ready()) get<_n>(m_stages).finish(lowest);
+    for(size_t cycle=0;cycle<lowest.size();cycle++) get<_n>(m_stages).apply(lowest[cycle],cycle);
+    finish_from(lowest,stage_index<_n+1>());
+  }
+  void finish_from(vector<ReadIntensity<_prec> > &,end_index) {}
+
+  template<size_t _n>
+  void apply_from(ReadIntensity<_prec> &r,size_t cycle,stage_index<_n>) const {
+    get<_n>(m_stages).apply(r,cycle);
+    apply_from(r,cycle,stage_index<_n+1>());
+  }
+  void apply_from(ReadIntensity<_prec> &,size_t,end_index) const {}
+
+  SignalId source_signalid;                        ///< Signal ID to read data from.
+  SignalId target_signalid;                        ///< Signal ID to write data to.
+  tuple<_stages...> m_stages;
+};
+
+/// Pipeline stage for ClusterFilter_NegativeZero, negative values are set to zero
+template<class _prec=double>
+class PipelineNegativeZero {
+public:
+  bool ready() const { return true; }
+  void gather(const ReadIntensity<_prec> &,size_t) {}
+  void end_cycle(size_t) {}
+  void finish(const vector<ReadIntensity<_prec> > &) {}
+
+  void apply(ReadIntensity<_prec> &r,size_t) const {
+    for(int n=0;n<ReadIntensity<_prec>::base_count;n++) {
+      if(r.get_base(n) < 0) r.set_base(n,0);
+    }
+  }
+};
+
+/// Pipeline stage for ClusterFilter_Normalise, the per cycle median of each base (ignoring values <= 0) is subtracted.
+/// Only the values of the cycle being gathered are held, its medians are taken when it ends.
+template<class _prec=double>
+class PipelineNormalise {
+public:
+  PipelineNormalise() : m_ready(false), m_values(ReadIntensity<_prec>::base_count) {}
+
+  bool ready() const { return m_ready; }
+
+  void gather(const ReadIntensity<_prec> &in,size_t) {
+    for(int base=0;base<ReadIntensity<_prec>::base_count;base++) {
+      if(!(in.get_base(base) <= 0)) m_values[base].push_back(in.get_base(base));
+    }
+  }
+
+  /// The cycle's medians, its values are cleared keeping their storage for the next cycle
+  void end_cycle(size_t cycle) {
+    if(cycle >= average_base_intensity.size()) {
+      average_base_intensity.resize(cycle+1,vector<_prec>(ReadIntensity<_prec>::base_count,0));
+      have_median           .resize(cycle+1,vector<char> (ReadIntensity<_prec>::base_count,0));
+    }
+
+    for(int base=0;base<ReadIntensity<_prec>::base_count;base++) {
+      if(m_values[base].size() > 0) {
+        average_base_intensity[cycle][base] = select_median(m_values[base]);
+        have_median[cycle][base] = 1;
+      }
+      m_values[base].clear();
+    }
+  }
+
+  void finish(const vector<ReadIntensity<_prec> > &) {
+    for(int base=0;base<ReadIntensity<_prec>::base_count;base++) {
+      for(size_t cycle=0;cycle<average_base_intensity.size();cycle++) {
+        if(have_median[cycle][base]) {
+          cout << m_tt.str() << "median cycle: " << right << setw(2) << cycle+1
+            << " base " << ReadIntensity<>::base_name[base] << ": " << average_base_intensity[cycle][base] << endl;
+        }
+      }
+    }
+
+    vector<vector<_prec> >(ReadIntensity<_prec>::base_count).swap(m_values);
+    have_median.clear();
+    m_ready = true;
+  }
+
+  void apply(ReadIntensity<_prec> &r,size_t cycle) const {
+    if(cycle >= average_base_intensity.size()) return;
+    for(int base=0;base<ReadIntensity<_prec>::base_count;base++) {
+      r.set_base(base,r.get_base(base)-average_base_intensity[cycle][base]);
+    }
+  }
+
+private:
+  bool m_ready;
+  vector<vector<_prec> > m_values;               ///< Values gathered for the current cycle, by base
+  vector<vector<_prec> > average_base_intensity; ///< Median base intensity cycle/base
+  vector<vector<char> >  have_median;            ///< Cycle/base had values to take a median of, for the log
+  Timetagger m_tt;
+};
+
+/// Pipeline stage for ClusterFilter_MakePositive, everything is shifted up by the smallest value if it's negative
+template<class _prec=double>
+class PipelineMakePositive {
+public:
+  PipelineMakePositive(ostream &err_in=std::cerr) : err(&err_in), m_ready(false), min_base_intensity(0), add_to_base_intensity(0) {}
+
+  bool ready() const { return m_ready; }
+  void gather(const ReadIntensity<_prec> &,size_t) {}
+  void end_cycle(size_t) {}
+
+  void finish(const vector<ReadIntensity<_prec> > &lowest) {
+    bool first=true;
+    for(size_t cycle=0;cycle<lowest.size();cycle++) {
+      for(int n=0;n<ReadIntensity<_prec>::base_count;n++) {
+        _prec baseval = lowest[cycle].get_base(n);
+        if(baseval < min_base_intensity || first) { min_base_intensity=baseval; first=false; }
+      }
+    }
+
+    (*err) << "Smallest base intensity value is: " << min_base_intensity << endl;
+
+    if(min_base_intensity < 0) add_to_base_intensity = 0-min_base_intensity;
+    else add_to_base_intensity = 0;
+
+    m_ready = true;
+  }
+
+  void apply(ReadIntensity<_prec> &r,size_t) const {
+    if(add_to_base_intensity == 0) return;
+    for(int n=0;n<ReadIntensity<_prec>::base_count;n++) {
+      r.set_base(n,r.get_base(n)+add_to_base_intensity);
+    }
+  }
+
+private:
+  ostream *err;                                    ///< Stream to write errors/debugging info to
+  bool m_ready;
+  _prec min_base_intensity;                        ///< Minimum intensity found
+  _prec add_to_base_intensity;                     ///< Value to add in order to make everything positive
+};
+
+#endif
@@ -30,7 +30,7 @@ public:
 
   ClusterFilter_Purity(int         num_bases_in       =12,    ///< Min purity with this many bases
                        double      purity_threshold_in=0.6,   ///< Invalid if falls below this
-                       std::string source_signal_id_in="RAW"  ///< Determine purity based on this signal
+                       SignalId    source_signal_id_in="RAW"  ///< Determine purity based on this signal
                       ) : num_bases(num_bases_in),
                           purity_threshold(purity_threshold_in),
                           source_signal_id(source_signal_id_in) {
@@ -60,7 +60,7 @@ public:
 
   unsigned int num_bases;    ///< Min purity calculated over this many inital bases
   double purity_threshold;   ///< Invalid if min purity falls below this threshold
-  string source_signal_id;   ///< Determine purity based on this signal id
+  SignalId source_signal_id; ///< Determine purity based on this signal id
 };
 
 #endif
@@ -31,7 +31,7 @@ public:
 
   ClusterFilter_PurityAverage(double      purity_threshold_in=0.6,   ///< Invalid if falls below this
                               size_t      purity_length_in=35,
-                              std::string source_signal_id_in="RAW"  ///< Determine purity based on this signal
+                              SignalId    source_signal_id_in="RAW"  ///< Determine purity based on this signal
                              ) : purity_threshold(purity_threshold_in),
                                  purity_length(purity_length_in),
                                  source_signal_id(source_signal_id_in) {
@@ -62,7 +62,7 @@ public:
 
   double purity_threshold;   ///< Invalid if min purity falls below this threshold
   size_t purity_length;
-  string source_signal_id;   ///< Determine purity based on this signal id
+  SignalId source_signal_id; ///< Determine purity based on this signal id
 };
 
 #endif
@@ -24,16 +24,19 @@
 #include <string>
 #include <algorithm>
 #include "Timetagger.h"
+#include "Quantile.h"
 
 /// Mark the top X purest clusters as valid.
+/// The clusters may be a vector or a ClusterSubset (anything indexed, with size()).
 template<class _prec=double>
 class ClusterFilter_PurityHighest {
 public:
 
-  ClusterFilter_PurityHighest(const vector<Cluster<_prec> > &clusters,                            ///< Determine top 500 purest base on these clusters
+  template<class _clusters>
+  ClusterFilter_PurityHighest(const _clusters               &clusters,                            ///< Determine top 500 purest base on these clusters
                               int                            num_bases_in       =12,              ///< Min purity across these many initial bases
                               unsigned int                   purity_count_in    =40,              ///< How many clusters to retain after filtering
-                              std::string                    source_signal_id_in="RAW",           ///< Determine purity based on this signal id.
+                              SignalId                       source_signal_id_in="RAW",           ///< Determine purity based on this signal id.
                               ostream                       &err_in             =std::cerr        ///< Write errors here
                              ) : num_bases(num_bases_in),
                                  purity_count(purity_count_in),
@@ -64,7 +67,19 @@ public:
     }
   }
   
-  bool is_valid(const Cluster<_prec> &c) {
+  /// Indices of the clusters which are valid, in order. Cheaper than process when the top clusters are
+  /// only needed for reading: nothing is copied.
+  template<class _clusters>
+  vector<size_t> select(const _clusters &clusters) const {
+    vector<size_t> selected;
+    selected.reserve(purity_count);
+    for(size_t n=0;n<clusters.size();n++) {
+      if(is_valid(clusters[n])) selected.push_back(n);
+    }
+    return selected;
+  }
+
+  bool is_valid(const Cluster<_prec> &c) const {
     
     bool ret = false;
 
@@ -81,19 +96,17 @@ public:
   
 private:
   /// Determine threshold for top X purest bases  
-  void initialise(const vector<Cluster<_prec> > &clusters) {
+  template<class _clusters>
+  void initialise(const _clusters &clusters) {
     
     //Create a vector containing all purities
     vector<_prec> purities;
+    purities.reserve(clusters.size());
 
-    
-    for(typename vector<Cluster<_prec> >::const_iterator i=clusters.begin();i != clusters.end();i++) {
-      purities.push_back((*i).min_purity(0,num_bases-1,source_signal_id));
+    for(size_t n=0;n<clusters.size();n++) {
+      purities.push_back(clusters[n].min_purity(0,num_bases-1,source_signal_id));
     }
 
-    //Sort it
-    sort(purities.begin(),purities.end());
-
     //Find entry purity_count from the end
 
     int position=0;
@@ -102,7 +115,7 @@ private:
       position = 0;
       err << m_tt.str() << "Error not enough purities: " << purities.size() << endl;
     }
-    purity_threshold = purities[position];
+    purity_threshold = select_nth(purities,position);
 
     err << m_tt.str() << "purity_count   :  " << purity_count << endl;
     err << m_tt.str() << "purity_threshold: " << purity_threshold << endl;
@@ -111,7 +124,7 @@ private:
   unsigned int num_bases;        ///< Number of initial bases over which to determine minimum purity
   unsigned int purity_count;     ///< Number of clusters to keep?
   _prec        purity_threshold; ///< The threshold at which the above number of clusters will be kept
-  string       source_signal_id; ///< The signal from which to determine purity
+  SignalId     source_signal_id; ///< The signal from which to determine purity
   ostream    &err;               ///< Write errors here
   Timetagger m_tt;
 
@@ -28,6 +28,7 @@
 #include <iostream>
 #include <fstream>
 #include "intensity.h"
+#include "../../include/GAPipelineParser.h"
 
 using namespace std;
 
@@ -49,28 +50,31 @@ public:
 
   int total;
 
-  IntensityReader() {
+  IntensityReader() : input_file(""), current_line(0), at_eof(true) {
   }
 
-  IntensityReader(string filename) : input_filename(filename) {
-    input_file.open(filename.c_str());
+  IntensityReader(string filename) : input_filename(filename), input_file(filename), current_line(0), at_eof(false) {
+    if(!input_file.open()) at_eof = true;
   }
 
+  /// The next line. As with reading a stream, eof() only becomes true once a read has been tried past the last line.
   IntensitySequence get_next() {
     return read_sequence_intensity();
   }
 
   bool eof() {
-    return input_file.eof();
+    return at_eof;
   }
 
   void close() {
     input_file.close();
+    at_eof = true;
   }
 
   void reopen() {
     input_file.close();
-    input_file.open(input_filename.c_str());
+    current_line = 0;
+    at_eof = !input_file.open();
   }
 
   void calc_stats() {
@@ -130,26 +134,27 @@ public:
 private:
   IntensitySequence read_sequence_intensity() {
     IntensitySequence s;
-    input_file >> s.lane;
-    input_file >> s.tile;
-    input_file >> s.x;
-    input_file >> s.y;
-
-    string str;
-    getline(input_file, str);
-    istringstream iss(str);
-    
-    for(;!iss.eof();) {
-      ReadIntensity r;
-      r << iss;
-      s.intensities.push_back(r);
+    if(current_line >= input_file.size()) {
+      at_eof = true;
+      return s;
     }
 
+    GAPipelineLine line = input_file.line(current_line++);
+    line.next_int(s.lane);
+    line.next_int(s.tile);
+    line.next_int(s.x);
+    line.next_int(s.y);
+
+    double v[ReadIntensity::base_count];
+    while(line.next_cycle(v)) s.intensities.push_back(ReadIntensity(v[0],v[1],v[2],v[3]));
+
     return s;
   }
   
   string input_filename;
-  ifstream input_file;
+  GAPipelineParser input_file;   ///< Mapped file, parsed a line at a time
+  size_t current_line;
+  bool at_eof;
 };
 
 #endif
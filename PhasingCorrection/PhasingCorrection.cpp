@@ -32,8 +32,30 @@
 #include "clusterfilter_blobs.h"
 #include <cmath>
 #include "Timetagger.h"
+#include "Quantile.h"
 
 
+/// Clears the estimates, sized to the cycles in the first cluster, and picks out the top N representative
+/// clusters which phasing is estimated from. These are returned as a view, nothing is copied.
+template<class _prec>
+ClusterSubset<_prec> PhasingCorrection<_prec>::setup(vector<Cluster<_prec> > &clusters) {
+
+  forward_phasing.clear();
+  reverse_phasing.clear();
+  forward_phasing_base_count.clear();
+  reverse_phasing_base_count.clear();
+
+  forward_phasing.insert           (forward_phasing.begin()           ,(*clusters.begin()).signal(source_signalid).size(),vector<_prec>(ReadIntensity<_prec>::base_count,0));
+  reverse_phasing.insert           (reverse_phasing.begin()           ,(*clusters.begin()).signal(source_signalid).size(),vector<_prec>(ReadIntensity<_prec>::base_count,0));
+  forward_phasing_base_count.insert(forward_phasing_base_count.begin(),(*clusters.begin()).signal(source_signalid).size(),vector<int>  (ReadIntensity<_prec>::base_count,0));
+  reverse_phasing_base_count.insert(reverse_phasing_base_count.begin(),(*clusters.begin()).signal(source_signalid).size(),vector<int>  (ReadIntensity<_prec>::base_count,0));
+
+  for(typename vector<Cluster<_prec> >::iterator i=clusters.begin();i != clusters.end();i++) (*i).set_valid(true);
+
+  ClusterFilter_PurityHighest<_prec> filter_purity(clusters,12,2000,source_signalid);
+  return ClusterSubset<_prec>(clusters,filter_purity.select(clusters));
+}
+
 //! This method generates Phasing estimates for a given cycle 
 //
 ///! Phasing estimates are based on the amount of the called (maximum intensity) base that is incorporated
@@ -42,7 +64,7 @@
 ///! Purity filtering takes place to ensure we only use good, unmixed clusters. The median phasing value across
 ///! pure clusters is used so that the calculation is more robust to outliers than the mean.
 template<class _prec>
-bool PhasingCorrection<_prec>::get_phasing(const vector<Cluster<_prec> > &clusters,int cycle,string signalid) {
+bool PhasingCorrection<_prec>::get_phasing(const ClusterSubset<_prec> &clusters,int cycle,const SignalId &signalid) {
 
   err << m_tt.str() << "Getting Phasing Estimates" << endl;
   
@@ -57,11 +79,6 @@ bool PhasingCorrection<_prec>::get_phasing(const vector<Cluster<_prec> > &cluste
   // ClusterFilter_Erode_Crosstalk<_prec> filter_erode_ac(clusters,100,10,ReadIntensity<_prec>::base_a,ReadIntensity<_prec>::base_c);
   // ClusterFilter_Erode_Crosstalk<_prec> filter_erode_gt(clusters,100,10,ReadIntensity<_prec>::base_g,ReadIntensity<_prec>::base_t);
 
-  int discarded=0;
-  int used_bases=0;
-  
-  vector<vector<_prec> > all_forward_phasing(ReadIntensity<_prec>::base_count,vector<_prec>());
-  vector<vector<_prec> > all_reverse_phasing(ReadIntensity<_prec>::base_count,vector<_prec>());
   for(typename ReadIntensity<_prec>::base_type b=0;b < ReadIntensity<_prec>::base_count;b++) {
     forward_phasing           [cycle][b]=0;
     forward_phasing_base_count[cycle][b]=0;
@@ -69,98 +86,88 @@ bool PhasingCorrection<_prec>::get_phasing(const vector<Cluster<_prec> > &cluste
     reverse_phasing_base_count[cycle][b]=0;
   }
 
-  // Process all clusters, get forward/reverse phasing per cluster/base add all phasing values to a vector
-  for(typename vector<Cluster<_prec> >::const_iterator i = clusters.begin();i != clusters.end();i++) {
-    
-    // TODO: The logic below has been abandoned in the quest for speed. Only the purity and offedge
-    // filters were in use at the time of the change. Those two filters (at least) now have an 'is_valid'
-    // method which just returns a boolean, rather than making a copy of the cluster and setting its
-    // valid flag, as is done by the 'process' method.
-    
-    // Apply filters (these mostly change the valid flag of the cluster)
-    // Cluster<_prec> filtered_cluster;
-    // filtered_cluster = filter_purity      .process(*i);
-    // filtered_cluster = filter_offedge     .process(filtered_cluster);
-    // filtered_cluster = filter_negativezero.process(filtered_cluster);
-    // filtered_cluster = filter_flowcell    .process(filtered_cluster);
-    // filtered_cluster = filter_invpurity   .process(filtered_cluster);
-    // filtered_cluster = filter_blobs       .process(filtered_cluster);
-    // filtered_cluster = filter_erode_gt    .process(filtered_cluster);
-    // filtered_cluster = filter_erode_ac    .process(filtered_cluster);
-
-    if (filter_offedge.is_valid(*i) && filter_purity.is_valid(*i)) {
-      
-      ReadIntensity<_prec> last_base;
-      ReadIntensity<_prec> this_base;
-      ReadIntensity<_prec> next_base;
-
-      // Find next and last bases, if they exist. 
-      
-      bool last_base_bad = false;
-      bool next_base_bad = false;
-
-      if(cycle-1 >= 0) {
-        last_base = i->const_signal(signalid)[cycle-1]; 
-      } else {
-        last_base_bad=true;
-      }
-      this_base = i->const_signal(signalid)[cycle];
-      if(static_cast<unsigned int>(cycle+1) < i->const_signal(signalid).size()) {
-        next_base = i->const_signal(signalid)[cycle+1];
-      } else {
-        next_base_bad=true;
-      }
-
-      // Forward phasing calculations
-      if(!next_base_bad) {
-        if(this_base.max_base() != next_base.max_base()) {
-          _prec new_forwardphasing = 0;
+  // Each cycle is estimated from intensities already corrected for the cycles before it (see process),
+  // so cycles can't be estimated together. Within a cycle clusters are independent: each thread
+  // collects phasing values for its share of the clusters, and these are gathered for the medians.
+  // The filters are only used through is_valid, which doesn't copy the cluster.
+  #if defined(_OPENMP)
+  int thread_count = omp_get_max_threads();
+  #else
+  int thread_count = 1;
+  #endif
+  vector<phasing_samples> samples(thread_count);
+
+  int cluster_count = clusters.size();
+
+  #if defined(_OPENMP)
+    #pragma omp parallel for schedule(static)
+  #endif
+  for(int n=0;n<cluster_count;n++) {
+    #if defined(_OPENMP)
+    phasing_samples &s = samples[omp_get_thread_num()];
+    #else
+    phasing_samples &s = samples[0];
+    #endif
+
+    const Cluster<_prec> &c = clusters[n];
+
+    if(!(filter_offedge.is_valid(c) && filter_purity.is_valid(c))) {
+      s.discarded++;
+      continue;
+    }
 
-          if(this_base.max_intensity() > 0.0001) {
-            // err << "next_base.max_intensity(): " << next_base.get_base(this_base.max_base()) << " ";
-            // err << "this_base.max_intensity(): " << this_base.max_intensity();
-            new_forwardphasing = next_base.get_base(this_base.max_base())/this_base.max_intensity();
+    // Find next and last bases, if they exist. The signal is looked up once.
+    const typename Cluster<_prec>::signal_vec_type &sig = c.const_signal(signalid);
 
+    const ReadIntensity<_prec> &this_base = sig[cycle];
+    typename ReadIntensity<_prec>::base_type this_max = this_base.max_base();
+    _prec this_max_intensity = this_base.get_base(this_max);
 
-            all_forward_phasing[this_base.max_base()].push_back(new_forwardphasing);
-            // forward_phasing           [cycle][this_base.max_base()] += new_forwardphasing;
-            forward_phasing_base_count[cycle][this_base.max_base()]++;
-          }
-        }
+    // Forward phasing calculations
+    if(static_cast<unsigned int>(cycle+1) < sig.size()) {
+      const ReadIntensity<_prec> &next_base = sig[cycle+1];
+      if((this_max != next_base.max_base()) && (this_max_intensity > 0.0001)) {
+        s.forward[this_max].push_back(next_base.get_base(this_max)/this_max_intensity);
       }
+    }
 
-      // Reverse phasing calculations
-      if(!last_base_bad) {
-        if(this_base.max_base() != last_base.max_base()) {
-          _prec new_reversephasing = 0;
-
-          if(this_base.max_intensity() > 0.0001) {
-            new_reversephasing = last_base.get_base(this_base.max_base())/this_base.max_intensity();
-            all_reverse_phasing[this_base.max_base()].push_back(new_reversephasing);
-            reverse_phasing_base_count[cycle][this_base.max_base()]++;
-          }
-        }
+    // Reverse phasing calculations
+    if(cycle-1 >= 0) {
+      const ReadIntensity<_prec> &last_base = sig[cycle-1];
+      if((this_max != last_base.max_base()) && (this_max_intensity > 0.0001)) {
+        s.reverse[this_max].push_back(last_base.get_base(this_max)/this_max_intensity);
       }
+    }
 
-      used_bases++;
-    } else {
-      discarded++;
+    s.used++;
+  }
+
+  // Gather the per thread values, in cluster order
+  int discarded=0;
+  int used_bases=0;
+  
+  vector<vector<_prec> > all_forward_phasing(ReadIntensity<_prec>::base_count,vector<_prec>());
+  vector<vector<_prec> > all_reverse_phasing(ReadIntensity<_prec>::base_count,vector<_prec>());
+  for(int t=0;t<thread_count;t++) {
+    for(typename ReadIntensity<_prec>::base_type b=0;b < ReadIntensity<_prec>::base_count;b++) {
+      all_forward_phasing[b].insert(all_forward_phasing[b].end(),samples[t].forward[b].begin(),samples[t].forward[b].end());
+      all_reverse_phasing[b].insert(all_reverse_phasing[b].end(),samples[t].reverse[b].begin(),samples[t].reverse[b].end());
     }
+    used_bases += samples[t].used;
+    discarded  += samples[t].discarded;
+  }
 
+  for(typename ReadIntensity<_prec>::base_type b=0;b < ReadIntensity<_prec>::base_count;b++) {
+    forward_phasing_base_count[cycle][b] = all_forward_phasing[b].size();
+    reverse_phasing_base_count[cycle][b] = all_reverse_phasing[b].size();
   }
 
   // Generate median
   // TODO: Sort this mess out (top 50 purest bases per channel?)
-  err << m_tt.str() << "Sorting to generate median" << endl;
+  err << m_tt.str() << "Selecting median" << endl;
   for(typename ReadIntensity<_prec>::base_type base=0;base < ReadIntensity<_prec>::base_count;base++) {
-    if (all_forward_phasing[base].size() > 0) {
-      sort(all_forward_phasing[base].begin(),all_forward_phasing[base].end());
-      forward_phasing[cycle][base] = all_forward_phasing[base][all_forward_phasing[base].size()/2];
-    }
-    if (all_reverse_phasing[base].size() > 0) {
-      sort(all_reverse_phasing[base].begin(),all_reverse_phasing[base].end());
-      reverse_phasing[cycle][base] = all_reverse_phasing[base][all_reverse_phasing[base].size()/2];
-    }
+    if (all_forward_phasing[base].size() > 0) forward_phasing[cycle][base] = select_median(all_forward_phasing[base]);
+    if (all_reverse_phasing[base].size() > 0) reverse_phasing[cycle][base] = select_median(all_reverse_phasing[base]);
   }
 
 
@@ -189,49 +196,131 @@ bool PhasingCorrection<_prec>::get_phasing(const vector<Cluster<_prec> > &cluste
    //  reverse_phasing[cycle][n] = reverse_phasing[cycle][n]/reverse_phasing_base_count[cycle][n];
   }
 
-  all_phasing_zero = true;
-  for(typename ReadIntensity<_prec>::base_type base=0;base < ReadIntensity<_prec>::base_count;base++) {
-    if(forward_phasing[cycle][base] != 0) all_phasing_zero = false;
-    if(reverse_phasing[cycle][base] != 0) all_phasing_zero = false;
-  }
+  all_phasing_zero = phasing_zero(cycle);
   
   err << m_tt.str() << "Phasing Estimation complete" << endl;
   
   return true;
 }
 
+/// True if there's no phasing to correct in a cycle
+template<class _prec>
+bool PhasingCorrection<_prec>::phasing_zero(int cycle) const {
+  for(typename ReadIntensity<_prec>::base_type base=0;base < ReadIntensity<_prec>::base_count;base++) {
+    if(forward_phasing[cycle][base] != 0) return false;
+    if(reverse_phasing[cycle][base] != 0) return false;
+  }
+  return true;
+}
+
+/// Prepares the correction for one cycle: which phasing values are used, and their powers.
+/// The powers are computed with the same pow call the correction always used, so results are unchanged.
+template<class _prec>
+void PhasingCorrection<_prec>::make_band(int cycle,phasing_band &band) const {
+
+  band.thresholdmet = false;
+
+  for(int b=0;b<ReadIntensity<_prec>::base_count;b++) {
+    _prec use_forward=0;
+    if(forward_phasing[cycle][b] < phasing_threshold) use_forward = forward_phasing[cycle][b];
+    else {use_forward = phasing_threshold; band.thresholdmet=true;}
+
+    _prec use_reverse=0;
+    if(reverse_phasing[cycle][b] < phasing_threshold) use_reverse = reverse_phasing[cycle][b];
+    else {use_reverse = phasing_threshold; band.thresholdmet=true;}
+
+    // Forward phasing reaches window-1 cycles ahead, reverse phasing window cycles back. Empty if unused.
+    band.forward_power[b].clear();
+    band.reverse_power[b].clear();
+    if(use_forward != 0) for(int k=0;k<phasing_window;k++)  band.forward_power[b].push_back(pow(use_forward,static_cast<int>(k)));
+    if(use_reverse != 0) for(int k=0;k<=phasing_window;k++) band.reverse_power[b].push_back(pow(use_reverse,static_cast<int>(k)));
+  }
+}
+
+/// Applies one cycle's correction to a signal, in place. Only the value at cycle is read, so the
+/// other cycles can be updated as the bands are walked.
+template<class _prec>
+void PhasingCorrection<_prec>::apply_band(ReadIntensity<_prec> *signal,int size,int cycle,const phasing_band &band) const {
+
+  const int base_count = ReadIntensity<_prec>::base_count;
+
+  _prec original[base_count];
+  for(int b=0;b<base_count;b++) original[b] = signal[cycle].get_base(b);
+
+  // 1. Add forward phasing
+  for(int b=0;b<base_count;b++) {
+    if(band.forward_power[b].empty()) continue;
+    for(int na=cycle+1;(na<size) && (na<cycle+phasing_window);na++) {
+      _prec addthis = original[b]*band.forward_power[b][na-cycle];
+      signal[cycle].set_base(b,signal[cycle].get_base(b) + addthis);
+    }
+  }
+
+  // 2. Add reverse phasing
+  for(int b=0;b<base_count;b++) {
+    if(band.reverse_power[b].empty()) continue;
+    for(int na=cycle-1;(na>=0) && (na>=cycle-phasing_window);na--) {
+      _prec addthis = original[b]*band.reverse_power[b][cycle-na];
+      signal[cycle].set_base(b,signal[cycle].get_base(b) + addthis);
+    }
+  }
+
+  // 3. Subtract forward phasing
+  for(int b=0;b<base_count;b++) {
+    if(band.forward_power[b].empty()) continue;
+    for(int na=cycle+1;(na<size) && (na<cycle+phasing_window);na++) {
+      _prec subtractthis = original[b]*band.forward_power[b][na-cycle];
+      signal[na].set_base(b,signal[na].get_base(b) - subtractthis);
+    }
+  }
+
+  // 4. Subtract reverse phasing
+  for(int b=0;b<base_count;b++) {
+    if(band.reverse_power[b].empty()) continue;
+    for(int na=cycle-1;(na>=0) && (na>=cycle-phasing_window);na--) {
+      _prec subtractthis = original[b]*band.reverse_power[b][cycle-na];
+      signal[na].set_base(b,signal[na].get_base(b) - subtractthis);
+    }
+  }
+}
+
 /// Applies the current matrix to these clusters
 template<class _prec>
 bool PhasingCorrection<_prec>::apply_correction(vector<Cluster<_prec> > &clusters, ///< Clusters to process
                                                 int cycle,                          ///< To which cycle are we applying the correction
                                                 bool &thresholdmet,                 ///< Return true if we hit the threshold (and stopped)
-                                                string local_source_signal,        ///< Source signal id
-                                                string local_target_signal         ///< Target signal id, can be the same as source
+                                                SignalId local_source_signal,      ///< Source signal id
+                                                SignalId local_target_signal       ///< Target signal id, can be the same as source
                                                ) {
   
   err << m_tt.str() << "Applying correction" << endl;
-  for(typename vector<Cluster<_prec> >::iterator i = clusters.begin();i != clusters.end();i++) {
-    
-    typename Cluster<_prec>::signal_vec_type old_signal;
-    old_signal = (*i).const_signal(local_source_signal);
-    
-    typename Cluster<_prec>::signal_vec_type new_signal;
 
-    thresholdmet=false;
-    if(cycle < old_signal.size()) {
-      new_signal = apply_correction(old_signal,cycle,thresholdmet);//thresholdmet is only dependant of the current phasing values for get_phasing, it should be set elsewhere.
-    } else {
-      new_signal = old_signal;
-    }
+  phasing_band band;
+  make_band(cycle,band);
 
-    (*i).add_signal(local_target_signal);
-    (*i).signal(local_target_signal).clear();
-    (*i).signal(local_target_signal) = new_signal;
+  // Each cluster is corrected in place (after copying, if the target is a new signal), clusters are independent.
+  int cluster_count = clusters.size();
 
-    //TODO: Inefficient
-    (*i).noise(local_target_signal) = (*i).noise(local_source_signal);
-  
+  #if defined(_OPENMP)
+    #pragma omp parallel for schedule(static)
+  #endif
+  for(int n=0;n<cluster_count;n++) {
+    Cluster<_prec> &c = clusters[n];
+
+    c.add_signal(local_target_signal);
+
+    typename Cluster<_prec>::signal_vec_type &target = c.signal(local_target_signal);
+    if(local_source_signal != local_target_signal) {
+      target = c.const_signal(local_source_signal);
+      c.noise(local_target_signal) = c.const_noise(local_source_signal);
+    }
+
+    if(cycle < static_cast<int>(target.size())) apply_band(target.data(),target.size(),cycle,band);
   }
+
+  // thresholdmet is only dependant of the current phasing values for get_phasing, it should be set elsewhere.
+  // As before it reports the last cluster, which has no correction if it's too short for this cycle.
+  if(cluster_count > 0) thresholdmet = band.thresholdmet && (cycle < static_cast<int>(clusters.back().const_signal(local_target_signal).size()));
   
   err << m_tt.str() << "Correction applied" << endl;
 
@@ -246,58 +335,161 @@ typename Cluster<_prec>::signal_vec_type PhasingCorrection<_prec>::apply_correct
                                                                                     bool &thresholdmet
                                                                                    ) {
   typename Cluster<_prec>::signal_vec_type new_signal = old_signal;
+
+  phasing_band band;
+  make_band(cycle,band);
+  if(band.thresholdmet) thresholdmet = true;
+
+  apply_band(new_signal.data(),new_signal.size(),cycle,band);
   
-  // 1. Add forward phasing
-  for(int b=0;b<ReadIntensity<_prec>::base_count;b++) {
-    _prec use_phasing=0;
-    if(forward_phasing[cycle][b] < phasing_threshold) use_phasing = forward_phasing[cycle][b];
-    else  {use_phasing=phasing_threshold; thresholdmet=true;}
-
-    if(use_phasing != 0)
-    for(int na=cycle+1;(na<static_cast<int>(old_signal.size())) && (na<cycle+phasing_window);na++) {
-      _prec addthis = old_signal[cycle].get_base(b)*pow(use_phasing,static_cast<int>(na-cycle));
-      new_signal[cycle].set_base(b,new_signal[cycle].get_base(b) + addthis);
+  return new_signal;
+}
+
+/// The mixing model behind apply_band: of the signal incorporated at a cycle, a fraction phasing^k leaks k cycles
+/// ahead (forward) or back (reverse) and the cycle keeps the rest. Per base, the observed signal is then M D^-1 x
+/// where x is the true signal, M has a unit diagonal and the powers from make_band below and above it, and D
+/// holds 1 plus the powers in each column. apply_band solves this a column at a time, assuming nothing has leaked
+/// into a cycle from the cycles after it. Here M y = observed is solved exactly and x = D y.
+template<class _prec>
+bool PhasingCorrection<_prec>::process_matrix(vector<Cluster<_prec> > &clusters) {
+
+  if(clusters.size() == 0) return true;
+
+  ClusterSubset<_prec> representative_clusters = setup(clusters);
+
+  // Phasing is estimated exactly as process estimates it, each cycle from intensities corrected for the
+  // cycles before it. Only the estimates are needed from this, so only a copy of the representatives is
+  // corrected as it goes.
+  vector<Cluster<_prec> > representatives;
+  representatives.reserve(representative_clusters.size());
+  for(size_t n=0;n<representative_clusters.size();n++) representatives.push_back(representative_clusters[n]);
+  ClusterSubset<_prec> estimated(representatives);
+
+  SignalId local_source_signalid = source_signalid;
+  SignalId local_target_signalid = target_signalid;
+
+  int cycles = forward_phasing.size();
+  for(int cycle=0;cycle<cycles;cycle++) {
+    get_phasing(estimated,cycle,local_source_signalid);
+
+    if(cycle==0) {
+      ClusterFilter_NegativeZero<_prec> m_clusterfilter_negativezero(local_source_signalid,local_target_signalid);
+      m_clusterfilter_negativezero.process(representatives);
     }
-  }
-  
-  // 2. Add reverse phasing
-  for(int b=0;b<ReadIntensity<_prec>::base_count;b++) {
-    _prec use_phasing=0;
-    if(reverse_phasing[cycle][b] < phasing_threshold) use_phasing = reverse_phasing[cycle][b];
-    else {use_phasing = phasing_threshold; thresholdmet=true;}
 
-    if(use_phasing != 0)
-    for(int na=cycle-1;(na>=0) && (na>=cycle-phasing_window);na--) {
-      _prec addthis = old_signal[cycle].get_base(b)*pow(use_phasing,static_cast<int>(cycle-na));
-      new_signal[cycle].set_base(b,new_signal[cycle].get_base(b) + addthis);
+    if(!all_phasing_zero) {
+      bool threshold_passed=false;
+      apply_correction(representatives,cycle,threshold_passed,local_source_signalid,local_target_signalid);
+
+      local_source_signalid = target_signalid;
+      local_target_signalid = target_signalid;
     }
   }
-  
-  // 3. Subtract forward phasing
+  vector<Cluster<_prec> >().swap(representatives);
+
+  // Then every cluster is corrected with one solve, negative values zeroed first as process does
+  ClusterFilter_NegativeZero<_prec> m_clusterfilter_negativezero(source_signalid,target_signalid);
+  m_clusterfilter_negativezero.process(clusters);
+
+  matrix_fallback = !solve_matrix(clusters);
+  if(matrix_fallback) return process(clusters);
+
+  return true;
+}
+
+template<class _prec>
+bool PhasingCorrection<_prec>::apply_matrix(vector<Cluster<_prec> > &clusters) {
+
+  if(clusters.size() == 0) return true;
+  if(matrix_fallback) return apply(clusters);
+
+  ClusterFilter_NegativeZero<_prec> m_clusterfilter_negativezero(source_signalid,target_signalid);
+  m_clusterfilter_negativezero.process(clusters);
+
+  solve_matrix(clusters);
+  return true;
+}
+
+/// Builds the matrices from the phasing estimates and corrects target_signalid of each cluster in place.
+/// False, leaving the clusters alone, if a matrix can't be factored.
+template<class _prec>
+bool PhasingCorrection<_prec>::solve_matrix(vector<Cluster<_prec> > &clusters) {
+
+  int cycles = forward_phasing.size();
+
+  err << m_tt.str() << "Building phasing matrices" << endl;
+
+  vector<phasing_band> bands(cycles);
+  for(int cycle=0;cycle<cycles;cycle++) make_band(cycle,bands[cycle]);
+
+  // Forward phasing reaches window-1 cycles ahead (below the diagonal), reverse phasing window cycles back
+  int lower = (phasing_window > 1) ? phasing_window-1 : 0;
+  int upper = (phasing_window > 0) ? phasing_window   : 0;
+
+  vector<BandedMatrix>   matrix(ReadIntensity<_prec>::base_count,BandedMatrix(cycles,lower,upper));
+  vector<vector<double> > scale(ReadIntensity<_prec>::base_count,vector<double>(cycles,1));
   for(int b=0;b<ReadIntensity<_prec>::base_count;b++) {
-    _prec use_phasing=0;
-    if(forward_phasing[cycle][b] < phasing_threshold) use_phasing = forward_phasing[cycle][b];
-    else {use_phasing=phasing_threshold; thresholdmet=true;}
-
-    if(use_phasing != 0)
-    for(int na=cycle+1;(na<static_cast<int>(old_signal.size())) && (na<cycle+phasing_window);na++) {
-      _prec subtractthis = old_signal[cycle].get_base(b)*pow(use_phasing,static_cast<int>(na-cycle));
-      new_signal[na].set_base(b,new_signal[na].get_base(b) - subtractthis);
+    for(int cycle=0;cycle<cycles;cycle++) {
+      matrix[b].at(cycle,cycle) = 1;
+
+      const vector<double> &forward = bands[cycle].forward_power[b];
+      for(int k=1;(k<static_cast<int>(forward.size())) && (cycle+k<cycles);k++) {
+        matrix[b].at(cycle+k,cycle) = forward[k];
+        scale[b][cycle] += forward[k];
+      }
+
+      const vector<double> &reverse = bands[cycle].reverse_power[b];
+      for(int k=1;(k<static_cast<int>(reverse.size())) && (cycle-k>=0);k++) {
+        matrix[b].at(cycle-k,cycle) = reverse[k];
+        scale[b][cycle] += reverse[k];
+      }
+    }
+
+    if(!matrix[b].factor()) {
+      err << m_tt.str() << "Phasing matrix for base " << ReadIntensity<_prec>::base_name[b] << " is singular, falling back to iterative correction" << endl;
+      return false;
     }
   }
-  
-  // 4. Subtract reverse phasing
-  for(int b=0;b<ReadIntensity<_prec>::base_count;b++) {
-    _prec use_phasing=0;
-    if(reverse_phasing[cycle][b] < phasing_threshold) use_phasing = reverse_phasing[cycle][b];
-    else {use_phasing = phasing_threshold; thresholdmet=true;}
-
-    if(use_phasing != 0)
-    for(int na=cycle-1;na>=0 && (na>=cycle-phasing_window);na--) {
-      _prec subtractthis = old_signal[cycle].get_base(b)*pow(use_phasing,static_cast<int>(cycle-na));
-      new_signal[na].set_base(b,new_signal[na].get_base(b) - subtractthis);
+
+  err << m_tt.str() << "Solving phasing matrices" << endl;
+
+  // Clusters are solved matrix_lanes at a time, the lanes are the inner loop of the solve. Signals which
+  // aren't the length the matrices were built for are corrected one cycle at a time, as process would.
+  int cluster_count = clusters.size();
+  int batch_count   = (cluster_count+matrix_lanes-1)/matrix_lanes;
+
+  #if defined(_OPENMP)
+    #pragma omp parallel for schedule(static)
+  #endif
+  for(int batch=0;batch<batch_count;batch++) {
+    int first = batch*matrix_lanes;
+    int last  = (first+matrix_lanes < cluster_count) ? first+matrix_lanes : cluster_count;
+
+    typename Cluster<_prec>::signal_vec_type *signal[matrix_lanes];
+    int lanes=0;
+    for(int n=first;n<last;n++) {
+      typename Cluster<_prec>::signal_vec_type &s = clusters[n].signal(target_signalid);
+      if(static_cast<int>(s.size()) == cycles) { signal[lanes] = &s; lanes++; continue; }
+
+      for(int cycle=0;cycle<static_cast<int>(s.size()) && (cycle<cycles);cycle++) apply_band(s.data(),s.size(),cycle,bands[cycle]);
+    }
+    if(lanes == 0) continue;
+
+    vector<double> rhs(static_cast<size_t>(cycles)*matrix_lanes,0);
+    for(int b=0;b<ReadIntensity<_prec>::base_count;b++) {
+      for(int cycle=0;cycle<cycles;cycle++) {
+        for(int l=0;l<lanes;l++) rhs[(cycle*matrix_lanes)+l] = (*signal[l])[cycle].get_base(b);
+      }
+
+      matrix[b].solve(rhs.data(),matrix_lanes);
+
+      for(int cycle=0;cycle<cycles;cycle++) {
+        for(int l=0;l<lanes;l++) (*signal[l])[cycle].set_base(b,rhs[(cycle*matrix_lanes)+l]*scale[b][cycle]);
+      }
     }
   }
-  
-  return new_signal;
+
+  err << m_tt.str() << "Phasing matrices solved" << endl;
+
+  return true;
 }
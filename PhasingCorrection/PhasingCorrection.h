@@ -29,6 +29,11 @@
 #include "Timetagger.h"
 #include "clusterfunctions.h"
 #include "clusterfilter_makepositive.h"
+#include "BandedMatrix.h"
+#include "ClusterSubset.h"
+#if defined(_OPENMP)
+#include <omp.h>
+#endif
 
 using namespace std;
 
@@ -38,41 +43,24 @@ public:
 
   PhasingCorrection(_prec phasing_threshold_in=0.8,                  ///< Don't apply phasing greater than this (it's some kind of artifact)
                     int phasing_window_in=10,
-                    string source_signalid_in="CROSSTALK_CORRECTED", ///< The signal ID to get intensities from
-                    string target_signalid_in="PHASE_CORRECTED",     ///< The signal ID to write intensties to
+                    SignalId source_signalid_in="CROSSTALK_CORRECTED", ///< The signal ID to get intensities from
+                    SignalId target_signalid_in="PHASE_CORRECTED",   ///< The signal ID to write intensties to
                     ostream &err_in=std::cerr                        ///< Write debug/errors here
                    ): phasing_threshold(phasing_threshold_in),
                       source_signalid(source_signalid_in),
                       target_signalid(target_signalid_in),
                       phasing_window(phasing_window_in),
+                      all_phasing_zero(true),
+                      matrix_fallback(false),
                       err(err_in) {
   }
 
   bool process(vector<Cluster<_prec> > &clusters) {
    
-    string local_source_signalid = source_signalid;
-    string local_target_signalid = target_signalid;
+    SignalId local_source_signalid = source_signalid;
+    SignalId local_target_signalid = target_signalid;
    
-    forward_phasing.clear();
-    reverse_phasing.clear();
-    forward_phasing_base_count.clear();
-    reverse_phasing_base_count.clear();
-
-    forward_phasing.insert           (forward_phasing.begin()           ,(*clusters.begin()).signal(source_signalid).size(),vector<_prec>(ReadIntensity<_prec>::base_count,0));
-    reverse_phasing.insert           (reverse_phasing.begin()           ,(*clusters.begin()).signal(source_signalid).size(),vector<_prec>(ReadIntensity<_prec>::base_count,0));
-    forward_phasing_base_count.insert(forward_phasing_base_count.begin(),(*clusters.begin()).signal(source_signalid).size(),vector<int>  (ReadIntensity<_prec>::base_count,0));
-    reverse_phasing_base_count.insert(reverse_phasing_base_count.begin(),(*clusters.begin()).signal(source_signalid).size(),vector<int>  (ReadIntensity<_prec>::base_count,0));
-
-    // Pull out top N representative clusters
-    ClusterFilter_PurityHighest<_prec> filter_purity(clusters,12,2000,source_signalid);
-
-    vector<Cluster<_prec> > representative_clusters;
-    for(typename vector<Cluster<_prec> >::iterator i=clusters.begin();i != clusters.end();i++) {
-      (*i).set_valid(true);
-
-      Cluster<_prec> c = filter_purity.process(*i);
-      if(c.is_valid()) representative_clusters.push_back(c);
-    }
+    ClusterSubset<_prec> representative_clusters = setup(clusters);
 
     // We iteratively apply the correction until almost no correction was made.
     for(size_t cycle=0;cycle<(*clusters.begin()).signal(source_signalid).size();cycle++) {
@@ -85,12 +73,11 @@ public:
       if(cycle==0) {
         ClusterFilter_NegativeZero<_prec> m_clusterfilter_negativezero(local_source_signalid,local_target_signalid);
         m_clusterfilter_negativezero.process(clusters);
-        m_clusterfilter_negativezero.process(representative_clusters);
       }
 
+      // The representative clusters are a view of clusters, so they are corrected along with them
       if(!all_phasing_zero) {
-        apply_correction(representative_clusters,cycle,threshold_passed,local_source_signalid,local_target_signalid);
-        apply_correction(clusters               ,cycle,threshold_passed,local_source_signalid,local_target_signalid);
+        apply_correction(clusters,cycle,threshold_passed,local_source_signalid,local_target_signalid);
         
         local_source_signalid = target_signalid;
         local_target_signalid = target_signalid;
@@ -110,16 +97,87 @@ public:
     return true;
   }
 
-  bool get_phasing(const vector<Cluster<_prec> > &clusters,int base,string signalid);
+  /// Corrects clusters process didn't see with the phasing it estimated, cycle by cycle as process would
+  bool apply(vector<Cluster<_prec> > &clusters) {
+
+    if(clusters.size() == 0) return true;
+
+    SignalId local_source_signalid = source_signalid;
+    SignalId local_target_signalid = target_signalid;
+
+    for(size_t cycle=0;cycle<forward_phasing.size();cycle++) {
+      if(cycle==0) {
+        ClusterFilter_NegativeZero<_prec> m_clusterfilter_negativezero(local_source_signalid,local_target_signalid);
+        m_clusterfilter_negativezero.process(clusters);
+      }
+
+      if(!phasing_zero(cycle)) {
+        bool threshold_passed=false;
+        apply_correction(clusters,cycle,threshold_passed,local_source_signalid,local_target_signalid);
+
+        local_source_signalid = target_signalid;
+        local_target_signalid = target_signalid;
+      }
+    }
+
+    return true;
+  }
+
+  /// The phasing estimated, forward or reverse, [cycle][base] row by row
+  vector<double> estimates(bool forward) const {
+    const vector<vector<_prec> > &phasing = forward ? forward_phasing : reverse_phasing;
+    vector<double> v;
+    for(size_t cycle=0;cycle<phasing.size();cycle++) v.insert(v.end(),phasing[cycle].begin(),phasing[cycle].end());
+    return v;
+  }
+
+  /// Alternative to process: phasing is estimated for every cycle as process estimates it, correcting only the
+  /// representative clusters as it goes. A banded cycles x cycles mixing matrix is then built per base from the
+  /// estimates and each cluster is corrected by solving it directly.
+  /// This is the exact solution of the model process approximates one cycle at a time, so it replaces
+  /// repeated runs of process. Falls back to process if a matrix can't be factored.
+  bool process_matrix(vector<Cluster<_prec> > &clusters);
+
+  /// Corrects clusters process_matrix didn't see with the matrices it built
+  bool apply_matrix(vector<Cluster<_prec> > &clusters);
 
-  bool apply_correction(vector<Cluster<_prec> > &clusters,int base,bool &thresholdmet,string local_source_signalid,string local_target_signalid); ///< Applies the current matrix to these clusters
+  bool get_phasing(const ClusterSubset<_prec> &clusters,int base,const SignalId &signalid);
+
+  bool apply_correction(vector<Cluster<_prec> > &clusters,int base,bool &thresholdmet,SignalId local_source_signalid,SignalId local_target_signalid); ///< Applies the current matrix to these clusters
   typename Cluster<_prec>::signal_vec_type apply_correction(const typename Cluster<_prec>::signal_vec_type &r,int base,bool &thresholdmet);                            ///< Applies a correction matrix to a single intensity sequence
 
 private:
+  /// The correction for one cycle, shared by every cluster. Powers are indexed by distance from the cycle.
+  struct phasing_band {
+    vector<double> forward_power[ReadIntensity<_prec>::base_count]; ///< Empty if this base has no forward phasing
+    vector<double> reverse_power[ReadIntensity<_prec>::base_count]; ///< Empty if this base has no reverse phasing
+    bool thresholdmet;                                              ///< A phasing value was clamped to phasing_threshold
+  };
+
+  static const int matrix_lanes = 8;      ///< Clusters solved together by process_matrix
+
+  ClusterSubset<_prec> setup(vector<Cluster<_prec> > &clusters);
+
+  bool phasing_zero(int cycle) const;
+  bool solve_matrix(vector<Cluster<_prec> > &clusters);
+
+  void make_band(int cycle,phasing_band &band) const;
+  void apply_band(ReadIntensity<_prec> *signal,int size,int cycle,const phasing_band &band) const;
+
+  /// Phasing values collected by one thread in get_phasing, per called base
+  struct phasing_samples {
+    vector<_prec> forward[ReadIntensity<_prec>::base_count];
+    vector<_prec> reverse[ReadIntensity<_prec>::base_count];
+    int used;
+    int discarded;
+
+    phasing_samples() : used(0), discarded(0) {}
+  };
+
   _prec phasing_threshold;                  ///< Don't apply phasing greater than this (artifact of some kind)
 
-  string source_signalid;
-  string target_signalid;
+  SignalId source_signalid;
+  SignalId target_signalid;
 
   vector<vector<_prec> > reverse_phasing;
   vector<vector<_prec> > forward_phasing;
@@ -130,6 +188,7 @@ private:
   int phasing_window;
 
   bool all_phasing_zero;
+  bool matrix_fallback;                       ///< process_matrix fell back to process, so apply_matrix does too
 
   ostream &err;                               ///< Error output will be writen here, set to cerr in constructor default
   Timetagger m_tt;
@@ -47,75 +47,126 @@ public:
             string tiletag_in="",                 ///< Tag to write at top of output
             string contams_filename="",           ///< Contaminants reference for this tile
             ostream &err_in=std::cerr             ///< Write debug/errors here
-           ) : m_clusters(clusters),
-               m_reference_genome_filename(reference_genome_filename),
+           ) : m_reference_genome_filename(reference_genome_filename),
                m_is_paired(is_paired),
                m_pair_break_pos(pair_break_pos),
                m_align_every(align_every),
                m_tiletag(tiletag_in),
                m_contams_filename(contams_filename),
                m_do_alignment(do_alignment),
-               err(err_in) {
-    generate_stats();
+               err(err_in),
+               aligner(true) {
+    generate_stats(clusters);
   }
 
-  bool generate_stats() {
+  /// A report on clusters seen a chunk at a time, call add with each chunk and then finish. Stats are those
+  /// the report on all the clusters together would have, though sums may round differently.
+  Reporting(bool   do_alignment,                  ///< True if you want an a alignment
+            string reference_genome_filename="",  ///< Reference genome for this tile
+            bool   is_paired=false,               ///< Is this a paired end run?
+            int    pair_break_pos=0,              ///< The pair break position
+            size_t align_every=100,               ///< Align every Nth read
+            string tiletag_in="",                 ///< Tag to write at top of output
+            string contams_filename="",           ///< Contaminants reference for this tile
+            ostream &err_in=std::cerr             ///< Write debug/errors here
+           ) : m_reference_genome_filename(reference_genome_filename),
+               m_is_paired(is_paired),
+               m_pair_break_pos(pair_break_pos),
+               m_align_every(align_every),
+               m_tiletag(tiletag_in),
+               m_contams_filename(contams_filename),
+               m_do_alignment(do_alignment),
+               err(err_in),
+               aligner(true) {
+    begin_average_intensities();
+    begin_error_rates();
+  }
+
+  /// Adds a chunk of clusters to the report
+  void add(const vector<Cluster<_prec> > &clusters) {
+    add_average_intensities(clusters,"FINAL");
+    add_error_rates(clusters);
+  }
+
+  /// Completes the report once every chunk has been added
+  void finish() {
+    finish_average_intensities();
+  }
+
+  bool generate_stats(const vector<Cluster<_prec> > &clusters) {
     
     // Crosstalk plots 1st cycle, last cycle
 
     // Average intensities, all and called
     Memstats mem ("calc_average_intensities");
-    calc_average_intensities("FINAL");
+    begin_average_intensities();
+    add_average_intensities(clusters,"FINAL");
+    finish_average_intensities();
 
     // Error rates, PF/Non-PF/Cycle, actually also calculate number of pf/non-pf bases
     mem.start ("calc_error_rates");
-    calc_error_rates();
+    begin_error_rates();
+    add_error_rates(clusters);
     mem.stop();
   
     return true;
   }
 
-  bool calc_average_intensities(string signal_id) {
+  void begin_average_intensities() {
+    total_all_signal.clear();
+    total_all_count.clear();
+    total_called_signal.clear();
+    total_called_count.clear();
+  }
 
-    average_all_intensities.clear();
-    average_all_intensities.insert(average_all_intensities.begin(),m_clusters[0].const_signal(signal_id).size(),vector<_prec>(ReadIntensity<_prec>::base_count,0));
-    
-    average_called_intensities.clear();
-    average_called_intensities.insert(average_called_intensities.begin(),m_clusters[0].const_signal(signal_id).size(),vector<_prec>(ReadIntensity<_prec>::base_count,0));
+  /// Sums for the average intensities, cycles are taken from the first cluster seen
+  bool add_average_intensities(const vector<Cluster<_prec> > &clusters,const SignalId &signal_id) {
+
+    if(clusters.size() == 0) return true;
 
     //TODO: really don't like calculating number of clusters like this
-    for(size_t cycle=0;cycle < m_clusters[0].const_signal("FINAL").size();cycle++) {
-      
-      vector<_prec> total_all_signal(ReadIntensity<_prec>::base_count,0);
-      vector<int>   total_all_count(ReadIntensity<_prec>::base_count,0);
-      vector<_prec> total_called_signal(ReadIntensity<_prec>::base_count,0);
-      vector<int> total_called_count(ReadIntensity<_prec>::base_count,0);
+    if(total_all_signal.size() == 0) {
+      size_t cycles = clusters[0].const_signal(signal_id).size();
+      total_all_signal   .assign(cycles,vector<_prec>(ReadIntensity<_prec>::base_count,0));
+      total_all_count    .assign(cycles,vector<int>  (ReadIntensity<_prec>::base_count,0));
+      total_called_signal.assign(cycles,vector<_prec>(ReadIntensity<_prec>::base_count,0));
+      total_called_count .assign(cycles,vector<int>  (ReadIntensity<_prec>::base_count,0));
+    }
+
+    for(size_t cycle=0;cycle < total_all_signal.size();cycle++) {
       
-      for(typename vector<Cluster<_prec> >::const_iterator i=m_clusters.begin();i != m_clusters.end();i++) {
+      for(typename vector<Cluster<_prec> >::const_iterator i=clusters.begin();i != clusters.end();i++) {
         for(int base=0;base < ReadIntensity<_prec>::base_count;base++) {
-          total_all_signal[base] += (*i).const_signal(signal_id)[cycle].get_base(base);
-          total_all_count[base]++;
+          total_all_signal[cycle][base] += (*i).const_signal(signal_id)[cycle].get_base(base);
+          total_all_count[cycle][base]++;
 
           typename ReadIntensity<_prec>::base_type maxb = (*i).const_signal(signal_id)[cycle].max_base();
           _prec maxb_val = (*i).const_signal(signal_id)[cycle].get_base((*i).const_signal(signal_id)[cycle].max_base());
 
-          total_called_signal[maxb] += maxb_val;
-          total_called_count[maxb]++;
+          total_called_signal[cycle][maxb] += maxb_val;
+          total_called_count[cycle][maxb]++;
         }
       }
+    }
+  
+    return true;
+  }
+
+  void finish_average_intensities() {
+    average_all_intensities.assign(total_all_signal.size(),vector<_prec>(ReadIntensity<_prec>::base_count,0));
+    average_called_intensities.assign(total_all_signal.size(),vector<_prec>(ReadIntensity<_prec>::base_count,0));
 
+    for(size_t cycle=0;cycle < total_all_signal.size();cycle++) {
       for(int base=0;base < ReadIntensity<_prec>::base_count;base++) {
-        average_all_intensities   [cycle][base] = total_all_signal[base]/total_all_count[base];
-        average_called_intensities[cycle][base] = total_called_signal[base]/total_called_count[base];
+        average_all_intensities   [cycle][base] = total_all_signal[cycle][base]/total_all_count[cycle][base];
+        average_called_intensities[cycle][base] = total_called_signal[cycle][base]/total_called_count[cycle][base];
       }
-     }
-  
-    return true;
+    }
   }
 
+  /// Zeroes the counts and loads the reference
   ///TODO: Currently not using contams file
-  bool calc_error_rates() {
-    SmallAlign<> aligner(true);
+  bool begin_error_rates() {
 
     pf_total_bases=0;
     nonpf_total_bases=0;
@@ -138,9 +189,7 @@ public:
     pf_score_by_cycle.clear();
     nonpf_score_by_cycle.clear();
 
-    //TODO: again getting cycle number from first cluster and assuming they are all the same is bad
-    pf_score_by_cycle.insert(pf_score_by_cycle.begin(),m_clusters[0].const_sequence("FINAL").size(),0);
-    nonpf_score_by_cycle.insert(nonpf_score_by_cycle.begin(),m_clusters[0].const_sequence("FINAL").size(),0);
+    align_count=0;
 
     if(m_do_alignment) {
       // Load reference sequence
@@ -168,9 +217,21 @@ public:
       if(aligner.all_reference_size() <= 0) m_do_alignment = false;
     }
 
+    return true;
+  }
+
+  bool add_error_rates(const vector<Cluster<_prec> > &clusters) {
+
+    if(clusters.size() == 0) return true;
+
+    //TODO: again getting cycle number from first cluster and assuming they are all the same is bad
+    if(pf_score_by_cycle.size() == 0) {
+      pf_score_by_cycle.insert(pf_score_by_cycle.begin(),clusters[0].const_signal("FINAL").size(),0);
+      nonpf_score_by_cycle.insert(nonpf_score_by_cycle.begin(),clusters[0].const_signal("FINAL").size(),0);
+    }
+
     Memstats mem ("Alignments");
-    size_t align_count = 0;
-    for(typename vector<Cluster<_prec> >::const_iterator i = m_clusters.begin();i != m_clusters.end();i++) {
+    for(typename vector<Cluster<_prec> >::const_iterator i = clusters.begin();i != clusters.end();i++) {
 
       string seq;
        
@@ -179,27 +240,32 @@ public:
 
       for(int end=0;end<ends;end++) {
 
+        // Read lengths come from the signal, the called sequences are only needed (and only kept) for alignment
+        int length = (*i).const_signal("FINAL").size();
         int offset=0;
         if(m_is_paired) {
+          int pair_break = (m_pair_break_pos < length) ? m_pair_break_pos : length;
           if(end == 0) {
-            seq = (*i).const_sequence("FINAL").trim(0,m_pair_break_pos-1).get_sequence_string();
+            if(m_do_alignment) seq = (*i).const_sequence("FINAL").trim(0,m_pair_break_pos-1).get_sequence_string();
+            length = pair_break;
             offset=0;
           }
 
           if(end == 1) {
-            seq = (*i).const_sequence("FINAL").trim(m_pair_break_pos,-1 ).get_sequence_string();
+            if(m_do_alignment) seq = (*i).const_sequence("FINAL").trim(m_pair_break_pos,-1 ).get_sequence_string();
+            length = length-pair_break;
             offset = m_pair_break_pos;
           }
         } else {
-          seq = (*i).const_sequence("FINAL").get_sequence_string();
+          if(m_do_alignment) seq = (*i).const_sequence("FINAL").get_sequence_string();
           offset=0;
         }
       
         if((*i).is_valid()) {
-          pf_total_bases += seq.length();
+          pf_total_bases += length;
           pf_total_reads++;
         } else {
-          nonpf_total_bases += seq.length();
+          nonpf_total_bases += length;
           nonpf_total_reads++;
         }
       
@@ -340,7 +406,6 @@ public:
   }
 
 private:
-  const vector<Cluster<_prec> > &m_clusters;
   string      m_reference_genome_filename;
   bool        m_is_paired;
   int         m_pair_break_pos;
@@ -361,6 +426,11 @@ private:
   vector<vector<_prec> > average_all_intensities;
   vector<vector<_prec> > average_called_intensities;
 
+  vector<vector<_prec> > total_all_signal;     ///< Sums for the averages, cycle/base
+  vector<vector<int>   > total_all_count;
+  vector<vector<_prec> > total_called_signal;
+  vector<vector<int>   > total_called_count;
+
   vector<int> nonpf_score_by_cycle;
   int         nonpf_total_bases;
   int         nonpf_total_bases_aligned;
@@ -379,6 +449,8 @@ private:
 
 
   ostream &err;                               ///< Error output will be writen here, set to cerr in constructor default
+  SmallAlign<> aligner;                       ///< Holds the reference, loaded by begin_error_rates
+  size_t      align_count;                    ///< Reads seen, every m_align_every-th is aligned
 };
 
 // This needs to be included here because this is a template class
@@ -19,6 +19,8 @@
 */
 
 #include <iomanip>
+#include <stdexcept>
+#include <cstdio>
 #include "EuclideanDistanceMap.h"
 #include "Watershed.h"
 #include "Invert.h"
@@ -33,6 +35,7 @@
 #include "SimpleThreshold.h"
 #include "MeanThreshold.h"
 #include "MedianThreshold.h"
+#include "stringify.h"
 #include "Memstats.h"
 #include "CommandLine.h"
 #include "DuplicateFilter.h"
@@ -79,6 +82,15 @@ inline void ImageAnalysis<_prec,_threshold_prec>::initialise() {
 
   channel_offsets_standard = NULL;
   channel_offsets_thresholded = NULL;
+
+  m_spill_always = false;
+  m_spilling     = false;
+}
+
+template<class _prec,class _threshold_prec>
+void ImageAnalysis<_prec,_threshold_prec>::set_spill(const string &prefix,bool always) {
+  m_spill_prefix = prefix;
+  m_spill_always = always;
 }
 
 template<class _prec,class _threshold_prec>
@@ -212,7 +224,13 @@ vector<SwiftImageCluster<_prec> > ImageAnalysis<_prec,_threshold_prec>::segmenta
   }
 
 
-  if(image_clusters.size() > static_cast<unsigned int>(params_cluster_limit)) {
+  m_spilling = (m_spill_prefix.size() > 0) &&
+               (m_spill_always || (image_clusters.size() > static_cast<unsigned int>(params_cluster_limit)));
+  if(m_spilling) {
+    err << "Writing intensities to spill files: " << m_spill_prefix << ".N" << endl;
+  }
+
+  if((!m_spilling) && (image_clusters.size() > static_cast<unsigned int>(params_cluster_limit))) {
   
     // We've gone over the cluster limit, we can process this data so throw an exception
 
@@ -355,6 +373,11 @@ void ImageAnalysis<_prec,_threshold_prec>::build_clusters(vector<Cluster<_prec>
                                                           vector<SwiftImageCluster<_prec> > &image_clusters
                                                          ) {
   err << m_tt.str() << "Total Clusters: " << image_clusters.size() << endl;
+  if(m_spilling) {
+    spill_clusters(image_clusters);
+    return;
+  }
+
   // 9. Save intensities and noise estimates to cluster objects
   
   for(typename vector<SwiftImageCluster<_prec> >::iterator i=image_clusters.begin();i != image_clusters.end();i++) {
@@ -365,9 +388,11 @@ void ImageAnalysis<_prec,_threshold_prec>::build_clusters(vector<Cluster<_prec>
     c.set_position(p);
     
     // Intensity
-    typename Cluster<_prec>::signal_vec_type ints = (*i).get_intensity_sequence(images);
+    typename Cluster<_prec>::offedge_vec_type offedge;
+    typename Cluster<_prec>::signal_vec_type ints = (*i).get_intensity_sequence(images,offedge);
     typename Cluster<_prec>::signal_vec_type &intsig = c.signal("RAW");
     intsig.insert(intsig.begin(),ints.begin(),ints.end());
+    c.offedge("RAW").insert(c.offedge("RAW").begin(),offedge.begin(),offedge.end());
    
     // Noise
     if(params_calculate_noise) { 
@@ -385,13 +410,20 @@ void ImageAnalysis<_prec,_threshold_prec>::extend_clusters(vector<Cluster<_prec>
                                                            vector<SwiftImageCluster<_prec> > &image_clusters
                                                           ) {
   
+  if(m_spilling) {
+    spill_clusters(image_clusters);
+    return;
+  }
+
   int c=0;
   for(typename vector<SwiftImageCluster<_prec> >::iterator i=image_clusters.begin();i != image_clusters.end();i++) {
     
     // Intensity
-    typename Cluster<_prec>::signal_vec_type ints = (*i).get_intensity_sequence(images);
+    typename Cluster<_prec>::offedge_vec_type offedge;
+    typename Cluster<_prec>::signal_vec_type ints = (*i).get_intensity_sequence(images,offedge);
     typename Cluster<_prec>::signal_vec_type &intsig = clusters[c].signal("RAW");
     intsig.insert(intsig.end(),ints.begin(),ints.end());
+    clusters[c].offedge("RAW").insert(clusters[c].offedge("RAW").end(),offedge.begin(),offedge.end());
    
     // Noise
     if(params_calculate_noise) { 
@@ -404,11 +436,54 @@ void ImageAnalysis<_prec,_threshold_prec>::extend_clusters(vector<Cluster<_prec>
   }
 }
 
+/// Writes the intensities of the loaded cycles of every cluster to the next spill file
+template<class _prec,class _threshold_prec>
+void ImageAnalysis<_prec,_threshold_prec>::spill_clusters(vector<SwiftImageCluster<_prec> > &image_clusters) {
+
+  // Intensity sequences built here are per cluster temporaries, keep them on the heap where each is freed
+  // as soon as it's copied into the table, rather than in any arena
+  ArenaScope<arena_tile> heap_scope;
+
+  int cluster_count = image_clusters.size();
+  ClusterTable<_prec> table;
+  table.resize(cluster_count,images[0].size());
+  table.add_signal("RAW");
+
+  #if defined(_OPENMP)
+    #pragma omp parallel for schedule(static)
+  #endif
+  for(int n=0;n<cluster_count;n++) {
+    SwiftImagePosition<> pos = image_clusters[n].get_position();
+    table.set_position(n,ClusterPosition<>(pos.x,pos.y));
+
+    typename Cluster<_prec>::offedge_vec_type offedge;
+    typename Cluster<_prec>::signal_vec_type ints = image_clusters[n].get_intensity_sequence(images,offedge);
+    for(size_t cycle=0;cycle<ints.size();cycle++) {
+      table.set_intensity("RAW",cycle,n,ints[cycle]);
+      table.set_offedge("RAW",cycle,n,offedge[cycle]);
+    }
+  }
+
+  string filename = m_spill_prefix + "." + stringify(m_spill_files.size());
+  if(!IntensityFile<_prec>::write(filename,table,"RAW")) {
+    // The tile is abandoned (in a batch the others carry on), so nothing would read the earlier files
+    remove(filename.c_str());
+    for(size_t n=0;n<m_spill_files.size();n++) remove(m_spill_files[n].c_str());
+    m_spill_files.clear();
+    throw runtime_error("Could not write spill file: " + filename);
+  }
+  m_spill_files.push_back(filename);
+}
+
 template<class _prec,class _threshold_prec>
 void ImageAnalysis<_prec,_threshold_prec>::generate(vector<Cluster<_prec> > &clusters) {
   
   load_images(params_load_cycle,true);
 
+  // Image objects only live for the duration of this call, their pixel runs are drawn from a scratch arena
+  MonotonicArena            scratch_arena;
+  ArenaScope<arena_scratch> scratch_scope(scratch_arena);
+
   vector<SwiftImageCluster<_prec> > image_clusters;
   
   generate_initial(clusters,image_clusters);
@@ -28,6 +28,8 @@
 #include "Timetagger.h"
 #include "ChannelOffsets.h"
 #include "SwiftImageCluster.h"
+#include "ClusterTable.h"
+#include "IntensityFile.h"
 #include <math.h>
 #include <string>
 #include <algorithm>
@@ -96,6 +98,13 @@ public:
 
   void generate(vector<Cluster<_prec> > &clusters);              ///< Runs image analysis and returns a vector of clusters single pass analysis
 
+  /// Allows the RAW intensities to be written to files instead of clusters, one file (prefix.N) per block of
+  /// cycles loaded, when there are more clusters than the limit or always if always is set. Noise isn't kept.
+  void set_spill(const string &prefix,bool always=false);
+
+  bool                   spilled()     const { return m_spilling;    } ///< True if generate wrote spill files, clusters is then empty
+  const vector<string> &spill_files() const { return m_spill_files; } ///< Spill files in cycle order, read them one after another
+
 public:
   
   int     params_threshold_window;            ///< Window size for thresholding, used to identify clusters
@@ -147,6 +156,7 @@ private:
   void                         extend_clusters    (vector<Cluster<_prec> > &clusters, vector<SwiftImageCluster<_prec> > &image_clusters);
   void                         generate_initial   (vector<Cluster<_prec> > &clusters, vector<SwiftImageCluster<_prec> > &image_clusters);
   void                         generate_additional(vector<Cluster<_prec> > &clusters, vector<SwiftImageCluster<_prec> > &image_clusters);
+  void                         spill_clusters     (vector<SwiftImageCluster<_prec> > &image_clusters);
 
 
   bool load_images(int load_first=10,bool grab_reference=false);                                             ///< Loads images into the images vector
@@ -158,6 +168,11 @@ private:
   vector<vector<SwiftImage<uint16> > > images;///< this vector holds the actual image data, it is populated by load_images
 
   vector<SwiftImage<uint16> >          reference_images;
+
+  string         m_spill_prefix;              ///< Spill files are written here, spilling isn't allowed if empty
+  bool           m_spill_always;              ///< Spill whatever the number of clusters
+  bool           m_spilling;                  ///< Set by segmentation if this run is spilling
+  vector<string> m_spill_files;               ///< Files written so far
   
   ostream &err;                               ///< Error output will be writen here, set to cerr in constructor default
   Timetagger m_tt;                            ///< Timetag-generating object
@@ -25,6 +25,7 @@
 #include <fftw3.h>
 #include <cmath>
 #include <algorithm>
+#include <mutex>
 #include "SwiftImage.h"
 #include "SwiftImagePosition.h"
 #include "Timetagger.h"
@@ -93,7 +94,11 @@ public:
     // just guesses. Given our approach of sticking to simple batch sizes, it doesn't 
     // seem to matter much. For more complex batch sizes, it does -- see the comments
     // pertaining to the pick_size method.
+    //
+    // The planner isn't thread safe, so tiles running on several threads plan one at a time. What it
+    // measures is kept (as FFTW wisdom) for the process, so planning a size again is quick.
 
+    lock_guard<mutex> lock(planner_mutex());
     m_plan_forward = fftw_plan_dft_r2c_2d(m_x_dim, m_y_dim, m_image_in, m_fft_out, FFTW_MEASURE); 
     m_plan_reverse = fftw_plan_dft_c2r_2d(m_x_dim, m_y_dim, m_cross, m_correl_out, FFTW_MEASURE); 
     // m_err << m_tt.str() << "Forward and reverse FFT plans created" << endl;
@@ -102,8 +107,11 @@ public:
     
   ~SwiftFFT () {
         
-    fftw_destroy_plan(m_plan_forward);
-    fftw_destroy_plan(m_plan_reverse);
+    {
+      lock_guard<mutex> lock(planner_mutex());
+      fftw_destroy_plan(m_plan_forward);
+      fftw_destroy_plan(m_plan_reverse);
+    }
     fftw_free(m_image_in);
     fftw_free(m_magnitudes);
     fftw_free(m_correl_out);
@@ -112,6 +120,12 @@ public:
 
   }
 
+  /// Held while plans are made or destroyed
+  static mutex &planner_mutex() {
+    static mutex m;
+    return m;
+  }
+
   int get_image_width ()  const {return m_image_width;}    
   int get_image_height () const {return m_image_height;}    
 
@@ -63,18 +63,27 @@ public:
 
   template<class _iprec>
   typename Cluster<_prec>::signal_vec_type get_intensity_sequence(const vector<vector<SwiftImage<_iprec> > > &images) const {
+    typename Cluster<_prec>::offedge_vec_type offedge;
+    return get_intensity_sequence(images,offedge);
+  }
+
+  /// As above, also returns the off edge flags for each cycle
+  template<class _iprec>
+  typename Cluster<_prec>::signal_vec_type get_intensity_sequence(const vector<vector<SwiftImage<_iprec> > > &images,
+                                                                  typename Cluster<_prec>::offedge_vec_type &offedge) const {
     
     typename Cluster<_prec>::signal_vec_type intensity_sequence;
+    offedge.clear();
 
     for(size_t cycle=0;cycle < images[0].size();cycle++) {
 
       ReadIntensity<_prec> r(0,0,0,0);
+      typename Cluster<_prec>::offedge_mask_type mask=0;
       for(int base=0;base<ReadIntensity<_prec>::base_count;base++) {
         
         _prec intensity=0;
         _prec maxintensity=0;
         bool first=true;
-        r.bases_offedge[base] = true;
         
         bool onimage=false;
         intensity = reference_position.get_intensity(images[base][cycle],onimage);
@@ -84,13 +93,14 @@ public:
           first=false;
         }
           
-        if(onimage) {
-          r.bases_offedge[base] = false;
+        if(!onimage) {
+          mask |= (1 << base);
         }
         r.set_base(base,intensity);
       }
 
       intensity_sequence.push_back(r);
+      offedge.push_back(mask);
     }
 
     return intensity_sequence;
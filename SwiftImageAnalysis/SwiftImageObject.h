@@ -26,6 +26,7 @@
 #include <vector>
 #include "RLERun.h"
 #include "SwiftImage.h"
+#include "Arena.h"
 
 using namespace std;
 
@@ -127,7 +128,7 @@ public:
 
   bool real;
   _prec intensity;
-  vector<RLERun<> > pixels;
+  vector<RLERun<>,ArenaAllocator<RLERun<>,arena_scratch> > pixels; ///< Drawn from the scratch arena during segmentation, see ImageAnalysis::generate
 };
 
 #endif
@@ -0,0 +1,235 @@
+/*
+    Swift (c) 2008 Genome Research Ltd.
+    Authors: Nava Whiteford and Tom Skelly (new@sgenomics.org ts6@sanger.ac.uk)
+
+    This file is part of Swift (http://swiftng.sourceforge.net).
+
+    Swift is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Swift is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with Swift.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SWIFT_ARENA_H
+#define SWIFT_ARENA_H
+
+#include <cstddef>
+#include <new>
+#include <vector>
+#include <type_traits>
+
+using namespace std;
+
+/// Tags selecting which arena an ArenaAllocator draws from.
+struct arena_tile    {}; ///< Lives as long as a tile: cluster signals and called sequences
+struct arena_scratch {}; ///< Lives as long as a stage: image objects during segmentation
+
+/// Monotonic (bump pointer) arena. Allocation is a pointer increment, deallocation is a no-op
+/// except for the most recent allocation, which is rolled back so a growing vector can reuse its space.
+/// Everything is freed at once by reset() or release(). Not thread safe, see ArenaScope.
+class MonotonicArena {
+public:
+  MonotonicArena(size_t block_size=1024*1024) : m_block_size(block_size), m_ptr(NULL), m_end(NULL), m_last(NULL), m_used(0) {
+  }
+
+  ~MonotonicArena() {
+    release();
+  }
+
+  void *allocate(size_t bytes,size_t align) {
+    char *p = align_up(m_ptr,align);
+    if((m_ptr == NULL) || (p+bytes > m_end)) {
+      new_block(bytes+align);
+      p = align_up(m_ptr,align);
+    }
+
+    m_last = p;
+    m_ptr  = p+bytes;
+    m_used += bytes;
+    return p;
+  }
+
+  void deallocate(void *p,size_t bytes) {
+    if((p == m_last) && (static_cast<char *>(p)+bytes == m_ptr)) {
+      m_ptr  = m_last;
+      m_last = NULL;
+      m_used -= bytes;
+    }
+  }
+
+  /// Frees everything but the current block, which is kept for reuse. All allocations are invalidated.
+  void reset() {
+    if(m_blocks.empty()) return;
+
+    block b = m_blocks.back();
+    m_blocks.pop_back();
+    release();
+
+    m_blocks.push_back(b);
+    m_ptr  = b.data;
+    m_end  = b.data+b.size;
+  }
+
+  /// Frees all blocks. All allocations are invalidated.
+  void release() {
+    for(size_t n=0;n<m_blocks.size();n++) ::operator delete(m_blocks[n].data);
+    m_blocks.clear();
+    m_ptr  = NULL;
+    m_end  = NULL;
+    m_last = NULL;
+    m_used = 0;
+  }
+
+  /// Bytes handed out (less rolled back allocations)
+  size_t bytes_used() const {
+    return m_used;
+  }
+
+  /// Bytes held in blocks
+  size_t bytes_reserved() const {
+    size_t total=0;
+    for(size_t n=0;n<m_blocks.size();n++) total += m_blocks[n].size;
+    return total;
+  }
+
+private:
+  struct block {
+    char  *data;
+    size_t size;
+  };
+
+  MonotonicArena(const MonotonicArena &);
+  MonotonicArena &operator=(const MonotonicArena &);
+
+  static inline char *align_up(char *p,size_t align) {
+    size_t a = reinterpret_cast<size_t>(p);
+    return reinterpret_cast<char *>((a + align - 1) & ~(align - 1));
+  }
+
+  /// Starts a new block, oversized requests get a block of their own
+  void new_block(size_t min_size) {
+    block b;
+    b.size = (min_size > m_block_size) ? min_size : m_block_size;
+    b.data = static_cast<char *>(::operator new(b.size));
+    m_blocks.push_back(b);
+
+    m_ptr  = b.data;
+    m_end  = b.data+b.size;
+    m_last = NULL;
+  }
+
+  size_t        m_block_size;
+  vector<block> m_blocks;
+  char         *m_ptr;   ///< Next free byte in the current block
+  char         *m_end;   ///< End of the current block
+  char         *m_last;  ///< Start of the most recent allocation, for rollback
+  size_t        m_used;
+};
+
+/// Installs an arena as the current one for a tag, on this thread, until the scope ends.
+/// Containers using ArenaAllocator pick up the current arena when they are constructed, and keep it.
+/// Containers built on other threads (OpenMP workers) have no current arena and use the heap.
+/// The arena must outlive every container allocated from it.
+template<class _tag>
+class ArenaScope {
+public:
+  ArenaScope(MonotonicArena &arena) : m_previous(slot()) {
+    slot() = &arena;
+  }
+
+  /// Installs no arena, so containers constructed in the scope use the heap whatever scope encloses it
+  ArenaScope() : m_previous(slot()) {
+    slot() = NULL;
+  }
+
+  ~ArenaScope() {
+    slot() = m_previous;
+  }
+
+  static MonotonicArena *current() {
+    return slot();
+  }
+
+private:
+  ArenaScope(const ArenaScope &);
+  ArenaScope &operator=(const ArenaScope &);
+
+  static MonotonicArena *&slot() {
+    static thread_local MonotonicArena *arena = NULL;
+    return arena;
+  }
+
+  MonotonicArena *m_previous;
+};
+
+/// Stateful allocator drawing from the current arena for _tag, or the heap when there is none.
+/// Copies of a container are placed in the arena current at the time of the copy, moves and swaps
+/// carry the arena with the storage.
+template<class T,class _tag=arena_tile>
+class ArenaAllocator {
+public:
+  typedef T         value_type;
+  typedef T        *pointer;
+  typedef const T  *const_pointer;
+  typedef T        &reference;
+  typedef const T  &const_reference;
+  typedef size_t    size_type;
+  typedef ptrdiff_t difference_type;
+
+  typedef false_type propagate_on_container_copy_assignment;
+  typedef true_type  propagate_on_container_move_assignment;
+  typedef true_type  propagate_on_container_swap;
+
+  template<class U>
+  struct rebind {
+    typedef ArenaAllocator<U,_tag> other;
+  };
+
+  ArenaAllocator() : m_arena(ArenaScope<_tag>::current()) {
+  }
+
+  template<class U>
+  ArenaAllocator(const ArenaAllocator<U,_tag> &other) : m_arena(other.arena()) {
+  }
+
+  T *allocate(size_t n) {
+    if(m_arena != NULL) return static_cast<T *>(m_arena->allocate(n*sizeof(T),alignof(T)));
+    return static_cast<T *>(::operator new(n*sizeof(T)));
+  }
+
+  void deallocate(T *p,size_t n) {
+    if(m_arena != NULL) m_arena->deallocate(p,n*sizeof(T));
+    else                ::operator delete(p);
+  }
+
+  ArenaAllocator select_on_container_copy_construction() const {
+    return ArenaAllocator();
+  }
+
+  MonotonicArena *arena() const {
+    return m_arena;
+  }
+
+private:
+  MonotonicArena *m_arena;
+};
+
+template<class T,class U,class _tag>
+inline bool operator==(const ArenaAllocator<T,_tag> &a,const ArenaAllocator<U,_tag> &b) {
+  return a.arena() == b.arena();
+}
+
+template<class T,class U,class _tag>
+inline bool operator!=(const ArenaAllocator<T,_tag> &a,const ArenaAllocator<U,_tag> &b) {
+  return a.arena() != b.arena();
+}
+
+#endif
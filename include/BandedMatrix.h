@@ -0,0 +1,126 @@
+/*
+    Swift (c) 2008 Genome Research Ltd.
+    Authors: Nava Whiteford and Tom Skelly (new@sgenomics.org ts6@sanger.ac.uk)
+
+    This file is part of Swift (http://swiftng.sourceforge.net).
+
+    Swift is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Swift is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with Swift.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SWIFT_BANDEDMATRIX_H
+#define SWIFT_BANDEDMATRIX_H
+
+#include <vector>
+#include <cmath>
+
+using namespace std;
+
+/// Square matrix with non-zero values only within lower diagonals below and upper diagonals above
+/// the main diagonal. Factored in place into LU (without pivoting, so the matrix should be
+/// diagonally dominant or close to it), after which any number of right hand sides can be solved
+/// in O(size*(lower+upper)). The band is preserved by the factorisation, nothing is filled in.
+class BandedMatrix {
+public:
+
+  BandedMatrix(int size=0,int lower=0,int upper=0) : m_size(size),
+                                                     m_lower(lower),
+                                                     m_upper(upper),
+                                                     m_width(lower+upper+1),
+                                                     m_factored(false),
+                                                     m_band(static_cast<size_t>(size)*(lower+upper+1),0) {
+  }
+
+  int size()  const { return m_size;  }
+  int lower() const { return m_lower; }
+  int upper() const { return m_upper; }
+
+  bool in_band(int row,int col) const {
+    return (col-row >= -m_lower) && (col-row <= m_upper);
+  }
+
+  /// An element within the band
+  double &at(int row,int col) {
+    return m_band[(static_cast<size_t>(row)*m_width)+(col-row+m_lower)];
+  }
+
+  /// Any element, zero outside the band
+  double get(int row,int col) const {
+    if(!in_band(row,col)) return 0;
+    return m_band[(static_cast<size_t>(row)*m_width)+(col-row+m_lower)];
+  }
+
+  /// Factors the matrix into L (unit diagonal, below) and U (on and above the diagonal), in place.
+  /// Returns false, leaving the matrix unusable, if a pivot is smaller than min_pivot.
+  bool factor(double min_pivot=1e-12) {
+    for(int k=0;k<m_size;k++) {
+      double pivot = at(k,k);
+      if(fabs(pivot) < min_pivot) return false;
+
+      int last_row = (k+m_lower < m_size) ? k+m_lower : m_size-1;
+      int last_col = (k+m_upper < m_size) ? k+m_upper : m_size-1;
+      for(int i=k+1;i<=last_row;i++) {
+        double l = at(i,k)/pivot;
+        at(i,k) = l;
+        if(l == 0) continue;
+        for(int j=k+1;j<=last_col;j++) at(i,j) -= l*at(k,j);
+      }
+    }
+
+    m_factored = true;
+    return true;
+  }
+
+  bool factored() const {
+    return m_factored;
+  }
+
+  /// Solves for lanes right hand sides at once, b[(row*lanes)+lane], replacing them with the solutions.
+  /// The lanes are the inner loop so that they can be vectorised. The matrix must have been factored.
+  void solve(double *b,int lanes=1) const {
+
+    // Forward substitution, L has a unit diagonal
+    for(int i=0;i<m_size;i++) {
+      double *bi = b+(static_cast<size_t>(i)*lanes);
+      int first = (i-m_lower > 0) ? i-m_lower : 0;
+      for(int j=first;j<i;j++) {
+        double l = get(i,j);
+        const double *bj = b+(static_cast<size_t>(j)*lanes);
+        for(int n=0;n<lanes;n++) bi[n] -= l*bj[n];
+      }
+    }
+
+    // Back substitution
+    for(int i=m_size-1;i>=0;i--) {
+      double *bi = b+(static_cast<size_t>(i)*lanes);
+      int last = (i+m_upper < m_size) ? i+m_upper : m_size-1;
+      for(int j=i+1;j<=last;j++) {
+        double u = get(i,j);
+        const double *bj = b+(static_cast<size_t>(j)*lanes);
+        for(int n=0;n<lanes;n++) bi[n] -= u*bj[n];
+      }
+      double pivot = get(i,i);
+      for(int n=0;n<lanes;n++) bi[n] /= pivot;
+    }
+  }
+
+private:
+  int m_size;
+  int m_lower;
+  int m_upper;
+  int m_width;                 ///< lower+upper+1, elements stored per row
+  bool m_factored;
+  vector<double> m_band;       ///< Row major, row r holds columns r-lower .. r+upper
+};
+
+#endif
@@ -0,0 +1,259 @@
+/*
+    Swift (c) 2008 Genome Research Ltd.
+    Authors: Nava Whiteford and Tom Skelly (new@sgenomics.org ts6@sanger.ac.uk)
+
+    This file is part of Swift (http://swiftng.sourceforge.net).
+
+    Swift is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Swift is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with Swift.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SWIFT_BGZF_H
+#define SWIFT_BGZF_H
+
+#include <vector>
+#include <deque>
+#include <iostream>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstring>
+#include <zlib.h>
+
+using namespace std;
+
+/// One BGZF block: up to bgzf_block_input bytes of input, deflated into a complete gzip member
+class BgzfBlock {
+public:
+  BgzfBlock() : done(false) {}
+
+  vector<char> in;                    ///< Uncompressed data
+  vector<char> out;                   ///< The gzip member, header to trailer
+  bool         done;                  ///< out is ready, guarded by the pool
+};
+
+/// Largest input per block, as htslib uses, so that even incompressible data fits the 64KB block limit
+static const size_t bgzf_block_input = 0xff00;
+
+/// Threads which deflate BGZF blocks. Any number of BgzfStreams can share a pool, each submits its blocks
+/// and waits for them in its own order. With no threads, blocks are deflated by whoever waits for them.
+class BgzfPool {
+public:
+
+  BgzfPool(int threads=0,int level_in=Z_DEFAULT_COMPRESSION) : m_level(level_in), m_stop(false) {
+    memset(&m_inline,0,sizeof(m_inline));
+    deflateInit2(&m_inline,m_level,Z_DEFLATED,-15,8,Z_DEFAULT_STRATEGY);
+    for(int n=0;n<threads;n++) m_threads.push_back(thread(&BgzfPool::worker,this));
+  }
+
+  ~BgzfPool() {
+    {
+      lock_guard<mutex> lock(m_mutex);
+      m_stop = true;
+    }
+    m_work.notify_all();
+    for(size_t n=0;n<m_threads.size();n++) m_threads[n].join();
+    deflateEnd(&m_inline);
+  }
+
+  int threads() const {
+    return m_threads.size();
+  }
+
+  int level() const {
+    return m_level;
+  }
+
+  /// Queues a block for deflating, it must not be touched until wait() returns
+  void submit(BgzfBlock *b) {
+    if(m_threads.empty()) return;
+    {
+      lock_guard<mutex> lock(m_mutex);
+      b->done = false;
+      m_queue.push_back(b);
+    }
+    m_work.notify_one();
+  }
+
+  /// Returns once the block is deflated
+  void wait(BgzfBlock *b) {
+    if(m_threads.empty()) {
+      deflate_block(m_inline,*b);
+      return;
+    }
+
+    unique_lock<mutex> lock(m_mutex);
+    while(!b->done) m_done.wait(lock);
+  }
+
+  /// Deflates a block into a BGZF gzip member, zs must be a raw deflate stream
+  static void deflate_block(z_stream &zs,BgzfBlock &b) {
+    const size_t header_size  = 18;
+    const size_t trailer_size = 8;
+
+    deflateReset(&zs);
+    b.out.resize(header_size+deflateBound(&zs,b.in.size())+trailer_size);
+
+    zs.next_in   = reinterpret_cast<Bytef *>(b.in.data());
+    zs.avail_in  = b.in.size();
+    zs.next_out  = reinterpret_cast<Bytef *>(b.out.data()+header_size);
+    zs.avail_out = b.out.size()-header_size-trailer_size;
+    deflate(&zs,Z_FINISH);
+
+    size_t block_size = header_size+zs.total_out+trailer_size;
+    b.out.resize(block_size);
+
+    // gzip header with the BC extra field holding the block size - 1
+    static const unsigned char header[16] = {0x1f,0x8b,8,4,0,0,0,0,0,0xff,6,0,'B','C',2,0};
+    memcpy(b.out.data(),header,sizeof(header));
+    put_le(b.out.data()+16,block_size-1,2);
+
+    uLong crc = crc32(crc32(0,Z_NULL,0),reinterpret_cast<const Bytef *>(b.in.data()),b.in.size());
+    put_le(b.out.data()+block_size-8,crc,4);
+    put_le(b.out.data()+block_size-4,b.in.size(),4);
+  }
+
+  /// The empty block which marks the end of a BGZF file
+  static const char *eof_block(size_t &size) {
+    static const char eof[28] = {0x1f,static_cast<char>(0x8b),8,4,0,0,0,0,0,static_cast<char>(0xff),6,0,'B','C',2,0,0x1b,0,3,0,0,0,0,0,0,0,0,0};
+    size = sizeof(eof);
+    return eof;
+  }
+
+private:
+
+  static void put_le(char *p,unsigned long v,int bytes) {
+    for(int n=0;n<bytes;n++) p[n] = static_cast<char>((v >> (8*n)) & 0xff);
+  }
+
+  void worker() {
+    z_stream zs;
+    memset(&zs,0,sizeof(zs));
+    deflateInit2(&zs,m_level,Z_DEFLATED,-15,8,Z_DEFAULT_STRATEGY);
+
+    for(;;) {
+      BgzfBlock *b;
+      {
+        unique_lock<mutex> lock(m_mutex);
+        while(m_queue.empty() && !m_stop) m_work.wait(lock);
+        if(m_queue.empty()) break;
+        b = m_queue.front();
+        m_queue.pop_front();
+      }
+
+      deflate_block(zs,*b);
+
+      {
+        lock_guard<mutex> lock(m_mutex);
+        b->done = true;
+      }
+      m_done.notify_all();
+    }
+
+    deflateEnd(&zs);
+  }
+
+  int                 m_level;     ///< zlib compression level
+  z_stream            m_inline;    ///< Used by wait() when there are no threads
+  bool                m_stop;
+  vector<thread>      m_threads;
+  deque<BgzfBlock *>  m_queue;     ///< Blocks waiting for a thread
+  mutex               m_mutex;
+  condition_variable  m_work;      ///< Signalled when a block is queued
+  condition_variable  m_done;      ///< Signalled when a block is deflated
+};
+
+/// Writes BGZF (blocked gzip, readable by gzip/zcat and indexable by htslib) to an ostream. Input is cut
+/// into blocks which a BgzfPool deflates in parallel, and they are written in order as they complete.
+class BgzfStream {
+public:
+
+  BgzfStream(ostream &out_in,BgzfPool &pool_in) : m_out(out_in), m_pool(pool_in), m_current(0), m_open(true) {
+    m_max_in_flight = (m_pool.threads() > 0) ? 4*m_pool.threads() : 1;
+  }
+
+  ~BgzfStream() {
+    close();
+    for(size_t n=0;n<m_free.size();n++) delete m_free[n];
+  }
+
+  void write(const char *data,size_t size) {
+    if(!m_open) return;
+    while(size > 0) {
+      if(m_current == 0) m_current = next_block();
+
+      size_t space = bgzf_block_input - m_current->in.size();
+      size_t n = (size < space) ? size : space;
+      m_current->in.insert(m_current->in.end(),data,data+n);
+      data += n;
+      size -= n;
+
+      if(m_current->in.size() == bgzf_block_input) submit();
+    }
+  }
+
+  /// Writes any partial block, waits for everything to be written and adds the end of file block
+  void close() {
+    if(!m_open) return;
+
+    if(m_current != 0 && m_current->in.size() > 0) submit();
+    while(!m_in_flight.empty()) write_oldest();
+
+    if(m_current != 0) m_free.push_back(m_current);
+    m_current = 0;
+
+    size_t eof_size;
+    const char *eof = BgzfPool::eof_block(eof_size);
+    m_out.write(eof,eof_size);
+    m_open = false;
+  }
+
+private:
+
+  BgzfBlock *next_block() {
+    BgzfBlock *b;
+    if(!m_free.empty()) { b = m_free.back(); m_free.pop_back(); }
+                   else b = new BgzfBlock();
+    b->in.clear();
+    b->in.reserve(bgzf_block_input);
+    return b;
+  }
+
+  void submit() {
+    while(m_in_flight.size() >= m_max_in_flight) write_oldest();
+    m_pool.submit(m_current);
+    m_in_flight.push_back(m_current);
+    m_current = next_block();
+  }
+
+  void write_oldest() {
+    BgzfBlock *b = m_in_flight.front();
+    m_in_flight.pop_front();
+    m_pool.wait(b);
+    m_out.write(b->out.data(),b->out.size());
+    m_free.push_back(b);
+  }
+
+  BgzfStream(const BgzfStream &);
+  BgzfStream &operator=(const BgzfStream &);
+
+  ostream            &m_out;
+  BgzfPool           &m_pool;
+  BgzfBlock          *m_current;        ///< Block being filled, 0 before the first write and after close
+  bool                m_open;
+  deque<BgzfBlock *>  m_in_flight;      ///< Submitted blocks, oldest first
+  vector<BgzfBlock *> m_free;           ///< Written blocks for reuse
+  size_t              m_max_in_flight;
+};
+
+#endif
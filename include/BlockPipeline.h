@@ -0,0 +1,140 @@
+/*
+    Swift (c) 2008 Genome Research Ltd.
+    Authors: Nava Whiteford and Tom Skelly (new@sgenomics.org ts6@sanger.ac.uk)
+
+    This file is part of Swift (http://swiftng.sourceforge.net).
+
+    Swift is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Swift is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with Swift.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SWIFT_BLOCKPIPELINE_H
+#define SWIFT_BLOCKPIPELINE_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <exception>
+
+using namespace std;
+
+/// Runs a chain of stages over a sequence of blocks (of clusters, say), each block passing through the
+/// stages in the order they were added. Blocks are taken by threads in order, so one block can be in a
+/// late stage while those after it are still in earlier ones.
+///
+/// A parallel stage depends only on the block it's given, and runs on any number of blocks at once. An
+/// ordered stage sees the blocks one at a time in block order: it's for writing files and for gathering
+/// statistics a later step needs. Anything which needs every block before it can start (an estimate made
+/// over the whole tile) isn't a stage, it goes between two runs.
+///
+/// Stages are run by plain threads, they shouldn't start OpenMP loops of their own.
+template<class _block>
+class BlockPipeline {
+public:
+
+  typedef function<void(_block &)> stage_function;
+
+  BlockPipeline(int threads_in=1) : m_threads(threads_in) {
+  }
+
+  /// Adds a stage which may run on several blocks at once
+  void parallel(stage_function f) {
+    m_stages.push_back(stage(f,false));
+  }
+
+  /// Adds a stage which runs on one block at a time, in block order
+  void ordered(stage_function f) {
+    m_stages.push_back(stage(f,true));
+  }
+
+  /// Runs every block through the stages, returning once all are done. If a stage throws, the blocks
+  /// which aren't through yet are abandoned and the exception is rethrown here.
+  void run(vector<_block> &blocks) {
+    m_blocks = &blocks;
+    m_claim  = 0;
+    m_turn.assign(m_stages.size(),0);
+    m_failed = false;
+    m_error  = exception_ptr();
+
+    int threads = m_threads;
+    if(static_cast<size_t>(threads) > blocks.size()) threads = blocks.size();
+
+    vector<thread> workers;
+    for(int n=1;n<threads;n++) workers.push_back(thread(&BlockPipeline::worker,this));
+    worker();
+    for(size_t n=0;n<workers.size();n++) workers[n].join();
+
+    m_blocks = 0;
+    if(m_error) rethrow_exception(m_error);
+  }
+
+private:
+
+  struct stage {
+    stage(stage_function f_in,bool ordered_in) : f(f_in), ordered(ordered_in) {}
+
+    stage_function f;
+    bool           ordered;
+  };
+
+  void worker() {
+    for(size_t b=m_claim++;b<m_blocks->size();b=m_claim++) {
+      for(size_t s=0;s<m_stages.size();s++) {
+        if(m_failed || !run_stage(s,b)) return;
+      }
+    }
+  }
+
+  /// False if this or another block has failed
+  bool run_stage(size_t s,size_t b) {
+    if(m_stages[s].ordered) {
+      unique_lock<mutex> lock(m_mutex);
+      while((m_turn[s] != b) && !m_failed) m_turn_taken.wait(lock);
+      if(m_failed) return false;
+    }
+
+    bool ok = true;
+    try {
+      m_stages[s].f((*m_blocks)[b]);
+    } catch(...) {
+      lock_guard<mutex> lock(m_mutex);
+      if(!m_failed) m_error = current_exception();
+      m_failed = true;
+      ok = false;
+    }
+
+    if(m_stages[s].ordered || !ok) {
+      {
+        lock_guard<mutex> lock(m_mutex);
+        if(ok) m_turn[s]++;
+      }
+      m_turn_taken.notify_all();
+    }
+    return ok;
+  }
+
+  int                 m_threads;
+  vector<stage>       m_stages;
+  vector<_block>     *m_blocks;        ///< Blocks of the current run
+  atomic<size_t>      m_claim;         ///< Next block to be taken by a thread
+  vector<size_t>      m_turn;          ///< For each ordered stage, the block it's waiting for
+  atomic<bool>        m_failed;        ///< A stage threw, set holding m_mutex
+  exception_ptr       m_error;         ///< The first exception thrown
+  mutex               m_mutex;
+  condition_variable  m_turn_taken;    ///< Signalled when an ordered stage finishes a block, or one fails
+};
+
+#endif
@@ -0,0 +1,215 @@
+/*
+    Swift (c) 2008 Genome Research Ltd.
+    Authors: Nava Whiteford and Tom Skelly (new@sgenomics.org ts6@sanger.ac.uk)
+
+    This file is part of Swift (http://swiftng.sourceforge.net).
+
+    Swift is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Swift is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with Swift.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SWIFT_CHECKPOINT_H
+#define SWIFT_CHECKPOINT_H
+
+#include <vector>
+#include <string>
+#include <map>
+#include <fstream>
+#include <sstream>
+#include <cstring>
+#include <cstdint>
+#include <cstdio>
+#include <cerrno>
+#include "Cluster.h"
+#include "SignalId.h"
+#include "IntensityFile.h"
+
+using namespace std;
+
+/// Snapshot of a tile at a stage boundary, enough to carry on from that stage. The signal the next stage
+/// reads is kept as a binary intensity file, filename.int (exact values, and usable as an intfile). filename
+/// holds the rest: named text (the stage, the parameters it was made with, report XML) and named arrays of
+/// values (what the stages estimated).
+///
+/// Layout of filename, in the byte order of the machine which wrote it (checked on reading):
+///   0  "SWIFTCKP"   8 version (1)   12 byte order mark 0x01020304   16 records   20 unused
+///   then each record: type ('t' text, 'v' doubles)  name length (32 bit)  name  data length in bytes (64 bit)  data
+template<class _prec=float>
+class Checkpoint {
+public:
+
+  /// Text record, empty if there isn't one
+  string text(const string &name) const {
+    map<string,string>::const_iterator i = m_text.find(name);
+    if(i == m_text.end()) return string();
+    return (*i).second;
+  }
+
+  void set_text(const string &name,const string &value) {
+    m_text[name] = value;
+  }
+
+  /// Names of the text records, in order
+  vector<string> text_names() const {
+    vector<string> names;
+    for(map<string,string>::const_iterator i=m_text.begin();i != m_text.end();i++) names.push_back((*i).first);
+    return names;
+  }
+
+  /// Values record, empty if there isn't one
+  vector<double> values(const string &name) const {
+    map<string,vector<double> >::const_iterator i = m_values.find(name);
+    if(i == m_values.end()) return vector<double>();
+    return (*i).second;
+  }
+
+  void set_values(const string &name,const vector<double> &v) {
+    m_values[name] = v;
+  }
+
+  /// Writes the records to filename and signalid of the clusters to filename.int. Both are written under
+  /// temporary names and renamed into place, the records last, so an interrupted write never leaves a
+  /// partly written file under either name. Any earlier records are removed before the intensities are
+  /// replaced, so if the second rename fails there's no checkpoint rather than old records paired with
+  /// new intensities.
+  bool write(const string &filename,const vector<Cluster<_prec> > &clusters,const SignalId &signalid) const {
+    string intensities      = intensity_filename(filename);
+    string temp_records     = filename    + ".tmp";
+    string temp_intensities = intensities + ".tmp";
+
+    if(!IntensityFile<_prec>::write(temp_intensities,clusters,signalid)) {
+      remove(temp_intensities.c_str());
+      return false;
+    }
+
+    ostringstream records;
+    for(map<string,string>::const_iterator i=m_text.begin();i != m_text.end();i++) {
+      write_record(records,'t',(*i).first,(*i).second.data(),(*i).second.size());
+    }
+    for(map<string,vector<double> >::const_iterator i=m_values.begin();i != m_values.end();i++) {
+      write_record(records,'v',(*i).first,reinterpret_cast<const char *>((*i).second.data()),(*i).second.size()*sizeof(double));
+    }
+
+    char header[header_size];
+    memset(header,0,header_size);
+    memcpy(header,file_magic(),8);
+    store<uint32_t>(header+8 ,file_version);
+    store<uint32_t>(header+12,byte_order_mark);
+    store<uint32_t>(header+16,m_text.size()+m_values.size());
+
+    ofstream out(temp_records.c_str(),ios::binary);
+    out.write(header,header_size);
+    out << records.str();
+    out.close();
+
+    if(out.fail()                                                  ||
+       ((remove(filename.c_str()) != 0) && (errno != ENOENT))      ||
+       (rename(temp_intensities.c_str(),intensities.c_str()) != 0) ||
+       (rename(temp_records.c_str(),filename.c_str()) != 0)) {
+      remove(temp_intensities.c_str());
+      remove(temp_records.c_str());
+      return false;
+    }
+    return true;
+  }
+
+  /// Reads the records of filename, replacing any held. False if it isn't a checkpoint written on this architecture.
+  bool read(const string &filename) {
+    m_text.clear();
+    m_values.clear();
+
+    ifstream in(filename.c_str(),ios::binary);
+    if(!in) return false;
+    string data((istreambuf_iterator<char>(in)),istreambuf_iterator<char>());
+
+    if((data.size() < header_size)                          ||
+       (memcmp(data.data(),file_magic(),8) != 0)            ||
+       (load<uint32_t>(data.data()+8)  != file_version)     ||
+       (load<uint32_t>(data.data()+12) != byte_order_mark)) return false;
+
+    uint32_t records = load<uint32_t>(data.data()+16);
+    size_t p = header_size;
+    for(uint32_t r=0;r<records;r++) {
+      if(p+1+sizeof(uint32_t) > data.size()) return false;
+      char type = data[p];
+      uint32_t name_length = load<uint32_t>(data.data()+p+1);
+      p += 1+sizeof(uint32_t);
+
+      if(p+name_length+sizeof(uint64_t) > data.size()) return false;
+      string name = data.substr(p,name_length);
+      p += name_length;
+      uint64_t length = load<uint64_t>(data.data()+p);
+      p += sizeof(uint64_t);
+      if(length > data.size()-p) return false;
+
+      if(type == 't') {
+        m_text[name] = data.substr(p,length);
+      } else if(type == 'v') {
+        vector<double> &v = m_values[name];
+        v.resize(length/sizeof(double));
+        if(v.size() > 0) memcpy(v.data(),data.data()+p,v.size()*sizeof(double));
+      } else return false;
+      p += length;
+    }
+
+    return true;
+  }
+
+  /// Reads the records and replaces clusters with those saved, the intensities going to signalid
+  bool read(const string &filename,vector<Cluster<_prec> > &clusters,const SignalId &signalid) {
+    if(!read(filename)) return false;
+    return IntensityFile<_prec>::read(intensity_filename(filename),clusters,signalid);
+  }
+
+  /// Where the clusters of a checkpoint are
+  static string intensity_filename(const string &filename) {
+    return filename + ".int";
+  }
+
+private:
+  static const size_t   header_size     = 24;
+  static const uint32_t file_version    = 1;
+  static const uint32_t byte_order_mark = 0x01020304;
+
+  static const char *file_magic() {
+    return "SWIFTCKP";
+  }
+
+  static void write_record(ostream &out,char type,const string &name,const char *data,uint64_t length) {
+    char sizes[sizeof(uint64_t)];
+    out.put(type);
+    store<uint32_t>(sizes,name.size());
+    out.write(sizes,sizeof(uint32_t));
+    out.write(name.data(),name.size());
+    store<uint64_t>(sizes,length);
+    out.write(sizes,sizeof(uint64_t));
+    out.write(data,length);
+  }
+
+  template<class _t>
+  static void store(char *p,_t v) {
+    memcpy(p,&v,sizeof(_t));
+  }
+
+  template<class _t>
+  static _t load(const char *p) {
+    _t v;
+    memcpy(&v,p,sizeof(_t));
+    return v;
+  }
+
+  map<string,string>          m_text;
+  map<string,vector<double> > m_values;
+};
+
+#endif
@@ -25,48 +25,138 @@
 #include <map>
 #include <string>
 #include <sstream>
+#include <cstring>
 #include "stringify.h"
 #include "ClusterPosition.h"
 #include "ReadIntensity.h"
 #include "ProbabilitySequence.h"
+#include "SignalId.h"
+#include "Arena.h"
+#include "GAPipelineParser.h"
 #include <algorithm>
   
-// To use alternate allocator:
-/*
-  typedef std::vector<intensities_type,__gnu_cxx::new_allocator<intensities_type> >        signal_vec_type;  ///< Type which holds a vector of signal intensities.
-  typedef std::vector<intensities_type,__gnu_cxx::new_allocator<intensities_type> >        noise_vec_type;   ///< Type which holds a vector of noise intensities.
-  map<string,signal_vec_type,less<string>,__gnu_cxx::new_allocator<pair<string,signal_vec_type>  > > signal_vec;                 ///< Map of Vectors of Signal values
-  map<string,noise_vec_type ,less<string>,__gnu_cxx::new_allocator<pair<string,signal_vec_type>  > >  noise_vec;                  ///< Map of Vectors of noise estimates
-*/
+// Signal, noise and off edge vectors use ArenaAllocator: when an ArenaScope<arena_tile> is active
+// (swift_main installs one per tile) they are bump allocated and freed together, otherwise they use the heap.
 
 template <class _prec = float, class _position_prec = int> 
 class Cluster {
 
 public:
   typedef ReadIntensity<_prec>                 intensities_type; ///< Type which holds 4 intensities (one for each base).
-  typedef std::vector<intensities_type>        signal_vec_type;  ///< Type which holds a vector of signal intensities.
-  typedef std::vector<intensities_type>        noise_vec_type;   ///< Type which holds a vector of noise intensities.
-  typedef ProbabilitySequence<>                sequence_type;    ///< Type which holds bases called
+  typedef std::vector<intensities_type,ArenaAllocator<intensities_type> >   signal_vec_type;  ///< Type which holds a vector of signal intensities.
+  typedef std::vector<intensities_type,ArenaAllocator<intensities_type> >   noise_vec_type;   ///< Type which holds a vector of noise intensities.
+  typedef ProbabilitySequence<>                                             sequence_type;    ///< Type which holds bases called
+  typedef typename intensities_type::offedge_mask_type                      offedge_mask_type;
+  typedef std::vector<offedge_mask_type,ArenaAllocator<offedge_mask_type> > offedge_vec_type; ///< Type which holds off edge flags, one mask per cycle.
 
   bool valid;                                             ///< Valid or not, not sure if I'm happy with this being public.
 
+  typedef std::vector<_prec>         purity_vec_type;  ///< Purity per cycle
+  typedef std::vector<unsigned char> call_vec_type;    ///< Called (maximum) base per cycle
+
 private:
-  string last_process_signal;                             ///< This is the string identifer for the last signal   processing operation that occured.
+  /// Purity and called base per cycle of a signal. Built on first use by the purity and similarity
+  /// queries, and dropped whenever the signal is handed out for writing (the non-const signal accessor).
+  /// These use the heap: they are built by whichever thread queries first, and arenas are per thread.
+  struct derived_columns {
+    purity_vec_type purity;
+    call_vec_type   called;
+    bool            valid;
+
+    derived_columns() : valid(false) {}
+  };
+
+  /// A signal, its noise estimate and off edge flags, stored against an interned signal id.
+  /// offedge is empty for signals which don't track it (everything downstream of crosstalk correction).
+  struct signal_slot {
+    SignalId                 id;
+    signal_vec_type          signal;
+    noise_vec_type           noise;
+    offedge_vec_type         offedge;
+    mutable derived_columns  derived;
+  };
+
+  /// Storage recycled from the last deleted signal. A chain of stages alternates between the live
+  /// signal and this buffer (ping-pong), so only two signals are ever allocated per cluster.
+  /// Copies of a cluster do not carry it.
+  struct spare_storage {
+    signal_vec_type  signal;
+    noise_vec_type   noise;
+    offedge_vec_type offedge;
+
+    spare_storage() {}
+    spare_storage(const spare_storage &) {}
+    spare_storage(spare_storage &&) = default;
+    spare_storage &operator=(const spare_storage &) { return *this; }
+    spare_storage &operator=(spare_storage &&) = default;
+  };
+
+  SignalId last_process_signal;                           ///< This is the identifer for the last signal processing operation that occured.
   string last_process_sequence;                           ///< This is the string identifer for the last sequence processing operation that occured.
   ClusterPosition<_position_prec> m_position;             ///< The position of this cluster
-  map<string,signal_vec_type,less<string> > signal_vec;   ///< Map of Vectors of Signal values
-  map<string,noise_vec_type ,less<string> > noise_vec;    ///< Map of Vectors of noise estimates
-  vector<string>              signal_ids;                 ///< List of signal ids
+  vector<signal_slot>         signal_slots;               ///< Signals and noise estimates, in the order they were added
+  unsigned char               slot_of[SignalRegistry::max_signals]; ///< Position in signal_slots of each signal id, no_slot if it isn't present
+  spare_storage               m_spare;                    ///< Recycled signal storage, see spare_storage
   vector<string>              sequence_ids;               ///< List of signal ids
   map<string,sequence_type>   sequences;                  ///< Called sequences
 
+  /// Handle for "RAW", interned once.
+  static const SignalId &raw_id() {
+    static const SignalId id("RAW");
+    return id;
+  }
+
+  static const unsigned char no_slot = 0xFF;
+
+  /// Position of identifier in signal_slots, or -1 if it's not present
+  inline int find_slot(const SignalId &identifier) const {
+    if(!identifier.is_set()) return -1;
+    unsigned char slot = slot_of[identifier.index()];
+    return (slot == no_slot) ? -1 : slot;
+  }
+
+  /// Returned by the const accessors when a signal is not present
+  static const signal_vec_type &empty_signal() {
+    static const signal_vec_type empty;
+    return empty;
+  }
+
+  /// Derived columns for a signal, built if they aren't current. Not safe to call on the same cluster
+  /// from two threads at once.
+  const derived_columns &derived(const SignalId &identifier) const {
+
+    int slot = find_slot(identifier);
+    if(slot == -1) {
+      static const derived_columns empty;
+      cerr << "ERROR TAG: " << identifier.name() << " NOT FOUND IN CLUSTER" << endl;
+      return empty;
+    }
+
+    derived_columns &d = signal_slots[slot].derived;
+    if(d.valid) return d;
+
+    const signal_vec_type &sig = signal_slots[slot].signal;
+    size_t size = sig.size();
+    d.purity.resize(size);
+    d.called.resize(size);
+    for(size_t n=0;n<size;n++) {
+      typename intensities_type::base_type max = sig[n].max_base();
+      d.called[n] = static_cast<unsigned char>(max);
+      d.purity[n] = sig[n].purity(max);
+    }
+    d.valid = true;
+
+    return d;
+  }
+
 public:
   Cluster() : valid(true),
-              last_process_signal("RAW"),
+              last_process_signal(raw_id()),
               last_process_sequence("BASECALL") { // last_process should probably left blank here and set when the sequence/signals are inserted.
-    signal_vec["RAW"] = signal_vec_type();
-    noise_vec["RAW"]  = noise_vec_type();
-    signal_ids.push_back("RAW");
+    memset(slot_of,no_slot,sizeof(slot_of));
+    slot_of[raw_id().index()] = 0;
+    signal_slots.push_back(signal_slot());
+    signal_slots.back().id = raw_id();
     // sequence_ids.push_back("BASECALL"); // Should I be adding this here, or let BaseCaller do it?
   }
   
@@ -78,18 +168,26 @@ public:
     valid = v;
   }
 
-  bool add_signal(string identifier) {
+  bool add_signal(const SignalId &identifier) {
     
-    if(signal_vec.find(identifier) == signal_vec.end()) {
-      signal_vec[identifier] = signal_vec_type();
-      noise_vec [identifier] = noise_vec_type();
+    if(!identifier.is_set()) return false;
+    if(find_slot(identifier) == -1) {
+      slot_of[identifier.index()] = signal_slots.size();
+      signal_slots.push_back(signal_slot());
+      signal_slots.back().id = identifier;
+      signal_slots.back().signal.swap(m_spare.signal); // takes over recycled storage, if any (the spare is always empty)
+      signal_slots.back().noise .swap(m_spare.noise);
+      signal_slots.back().offedge.swap(m_spare.offedge);
       last_process_signal = identifier;
-      signal_ids.push_back(identifier);
     }
 
     return true;
   }
 
+  bool has_signal(const SignalId &identifier) const {
+    return find_slot(identifier) != -1;
+  }
+
   bool add_sequence(string identifier) {
     
     if(sequences.find(identifier) == sequences.end()) {
@@ -101,46 +199,93 @@ public:
     return true;
   }
 
-  inline void delete_signal(const string &identifier) {
+  /// Removes a signal. Its storage is kept as the spare buffer for the next add_signal, release_spare frees it.
+  /// References returned by the accessors are invalidated.
+  inline void delete_signal(const SignalId &identifier) {
    
-    signal_vec_type mst;
-    noise_vec_type  mnt;
+    int slot = find_slot(identifier);
+    if(slot == -1) {
+      cerr << "Error in Cluster.h: identifier not found during delete: " << identifier.name() << endl;
+      return;
+    }
 
-    if(signal_vec.find(identifier) == signal_vec.end()) cerr << "Error in Cluster.h: identifier not found during delete: " << identifier << endl;
-    signal(identifier).swap(mst);
-    noise (identifier).swap(mnt);
+    m_spare.signal.swap(signal_slots[slot].signal);
+    m_spare.noise .swap(signal_slots[slot].noise);
+    m_spare.offedge.swap(signal_slots[slot].offedge);
+    m_spare.signal.clear();
+    m_spare.noise .clear();
+    m_spare.offedge.clear();
 
-    signal_vec.erase(identifier);
-    noise_vec .erase(identifier);
-    
-    if(signal_vec.find(identifier) != signal_vec.end()) cerr << "Error in Cluster.h: identifier not deleted in delete: " << identifier << endl;
-    
-    std::remove(signal_ids.begin(),signal_ids.end(),identifier);
+    signal_slots.erase(signal_slots.begin()+slot);
+    slot_of[identifier.index()] = no_slot;
+    for(size_t n=slot;n<signal_slots.size();n++) slot_of[signal_slots[n].id.index()] = n;
+  }
+
+  /// Frees the recycled signal storage, for use at the end of a chain of stages.
+  inline void release_spare() {
+    signal_vec_type().swap(m_spare.signal);
+    noise_vec_type ().swap(m_spare.noise);
+    offedge_vec_type().swap(m_spare.offedge);
   }
 
-  /// Accessor for signal, no bounds checking
-  signal_vec_type &signal(const string &identifier) {
-    return (*signal_vec.find(identifier)).second;
+  // The signal accessors take a SignalId, which is implicitly constructed from a string, so
+  // c.signal("RAW") still works. In per-cluster loops pass a SignalId constructed once instead.
+  // add_signal and delete_signal may move the signals, so don't hold references across them.
+
+  /// Accessor for signal, no bounds checking. This may be written through, so it drops the derived
+  /// purity and call columns. Don't hold the reference across a purity or similarity query.
+  inline signal_vec_type &signal(const SignalId &identifier) {
+    signal_slot &slot = signal_slots[find_slot(identifier)];
+    slot.derived.valid = false;
+    return slot.signal;
   }
 
   /// Accessor for noise, no bounds checking
-  noise_vec_type &noise(const string &identifier) {
-    return (*noise_vec.find(identifier)).second;
+  inline noise_vec_type &noise(const SignalId &identifier) {
+    return signal_slots[find_slot(identifier)].noise;
   }
   
   /// Const Accessor for signal, no bounds checking
-  const signal_vec_type &const_signal(const string &identifier) const {
+  inline const signal_vec_type &const_signal(const SignalId &identifier) const {
 
-    if(signal_vec.find(identifier) == signal_vec.end()) {
-      cerr << "ERROR TAG: " << identifier << " NOT FOUND IN CLUSTER" << endl;
+    int slot = find_slot(identifier);
+    if(slot == -1) {
+      cerr << "ERROR TAG: " << identifier.name() << " NOT FOUND IN CLUSTER" << endl;
+      return empty_signal();
     }
 
-    return (*signal_vec.find(identifier)).second;
+    return signal_slots[slot].signal;
   }
 
   /// Const Accessor for noise, no bounds checking
-  const noise_vec_type &const_noise(const string &identifier) const {
-    return (*noise_vec.find(identifier)).second;
+  inline const noise_vec_type &const_noise(const SignalId &identifier) const {
+    return signal_slots[find_slot(identifier)].noise;
+  }
+
+  /// Accessor for off edge flags, one mask per cycle, no bounds checking
+  inline offedge_vec_type &offedge(const SignalId &identifier) {
+    return signal_slots[find_slot(identifier)].offedge;
+  }
+
+  /// Const accessor for off edge flags, no bounds checking
+  inline const offedge_vec_type &const_offedge(const SignalId &identifier) const {
+    return signal_slots[find_slot(identifier)].offedge;
+  }
+
+  /// Purity of each cycle, cached until the signal is next written
+  inline const purity_vec_type &const_purity(const SignalId &identifier) const {
+    return derived(identifier).purity;
+  }
+
+  /// Called (maximum) base of each cycle, cached until the signal is next written
+  inline const call_vec_type &const_calls(const SignalId &identifier) const {
+    return derived(identifier).called;
+  }
+
+  /// Off edge flags for one cycle, 0 if the signal doesn't track them
+  inline offedge_mask_type offedge_mask(const SignalId &identifier,size_t cycle) const {
+    const offedge_vec_type &o = const_offedge(identifier);
+    return (cycle < o.size()) ? o[cycle] : 0;
   }
   
   /// Accessor for sequence, no bounds checking
@@ -163,46 +308,46 @@ public:
 
   /// Accessor for RAW signal, no bounds checking
   signal_vec_type &raw_signal() {
-    return (*signal_vec.find("RAW")).second;
+    return signal(raw_id());
   }
 
   /// Accessor for RAW noise, no bounds checking
   noise_vec_type &raw_noise() {
-    return (*noise_vec.find("RAW")).second;
+    return noise(raw_id());
   }
   
   /// Accessor for RAW signal, no bounds checking, const version
   const signal_vec_type &const_raw_signal() const {
-    return (*signal_vec("RAW")).second;
+    return const_signal(raw_id());
   }
 
   /// Accessor for RAW noise, no bounds checking, const version
   const noise_vec_type &const_raw_noise() const {
-    return (*noise_vec("RAW")).second;
+    return const_noise(raw_id());
   }
 
   // Accessor for LAST PROCESSED signal
   signal_vec_type &processed_signal() {
-    return (*signal_vec(last_process_signal)).second;
+    return signal(last_process_signal);
   }
   
   // Accessor for LAST_PROCESSED noise
   noise_vec_type &processed_noise() {
-    return (*signal_vec(last_process_signal)).second;
+    return noise(last_process_signal);
   }
   
   // Const accessor for LAST_PROCESSED signal
   const signal_vec_type &const_processed_signal() const {
-    return (*signal_vec(last_process_signal)).second;
+    return const_signal(last_process_signal);
   }
 
   // Const accessor for LAST_PROCESSED noise
   const noise_vec_type &const_processed_noise() const {
-    return (*noise_vec(last_process_signal)).second;
+    return const_noise(last_process_signal);
   }
 
   const string last_processed_signal() const {
-    return last_process_signal;
+    return last_process_signal.name();
   }
   
   const string last_processed_sequence() const {
@@ -210,7 +355,9 @@ public:
   }
 
   const vector<string> get_signal_ids() const {
-    return signal_ids;
+    vector<string> ids;
+    for(typename vector<signal_slot>::const_iterator i = signal_slots.begin();i != signal_slots.end();i++) ids.push_back((*i).id.name());
+    return ids;
   }
   
   const vector<string> get_sequence_ids() const {
@@ -230,20 +377,16 @@ public:
   /// If they are within some similarity threshold, return true
   /// First attempt is similarity based on base with maximum
   /// intensity.
-  int similarity(const Cluster<_prec> &other,string signalid) {
+  int similarity(const Cluster<_prec> &other,const SignalId &signalid) const {
 
-    const signal_vec_type &mysignal    =       const_signal(signalid);
-    const signal_vec_type &othersignal = other.const_signal(signalid);
+    const call_vec_type &mycalls    =       const_calls(signalid);
+    const call_vec_type &othercalls = other.const_calls(signalid);
 
-    if(mysignal.size() != othersignal.size()) return false;
+    if(mycalls.size() != othercalls.size()) return false;
 
     int similar_bases=0;
-    for(size_t n=0;n<mysignal.size();n++) {
-      if(n < othersignal.size()) {
-        if(mysignal[n].max_base() == othersignal[n].max_base()) {
-          similar_bases++;
-        }
-      }
+    for(size_t n=0;n<mycalls.size();n++) {
+      if(mycalls[n] == othercalls[n]) similar_bases++;
     }
     
     return similar_bases;
@@ -252,24 +395,26 @@ public:
 
   // Return minimum Purity of bases between start_base and end_base.
   // No bounds checking.
-  _prec min_purity(int start_base,int end_base,string signalid) const {
+  _prec min_purity(int start_base,int end_base,const SignalId &signalid) const {
     
     if(end_base < start_base) return 0;
-    _prec min_purity = const_signal(signalid)[start_base].purity();
+    const purity_vec_type &purity = const_purity(signalid);
+    _prec min_purity = purity[start_base];
     for(int i=start_base+1;i <= end_base;i++) {
-      if(const_signal(signalid)[i].purity() < min_purity) min_purity = const_signal(signalid)[i].purity();
+      if(purity[i] < min_purity) min_purity = purity[i];
     }
     return min_purity;
   }
   
   // Return second lowest purity
-  _prec min_purity2(int start_base,int end_base,string signalid) const {
+  _prec min_purity2(int start_base,int end_base,const SignalId &signalid) const {
     
-    _prec min_purity  = const_signal(signalid)[start_base].purity();
+    const purity_vec_type &purity = const_purity(signalid);
+    _prec min_purity  = purity[start_base];
     _prec min_purity2 = min_purity;
     for(int i=start_base+1;i <= end_base;i++) {
 
-      _prec current_purity = const_signal(signalid)[i].purity();
+      _prec current_purity = purity[i];
 
       if(current_purity <= min_purity) {
         min_purity2 = min_purity;
@@ -283,75 +428,80 @@ public:
     return min_purity2;
   }
 
-  bool min_purity_greaterthaneq(int start_base,int end_base,string signalid,_prec threshold) const {
+  bool min_purity_greaterthaneq(int start_base,int end_base,const SignalId &signalid,_prec threshold) const {
+    const purity_vec_type &purity = const_purity(signalid);
     for(int i=start_base;i <= end_base;i++) {
-      if(const_signal(signalid)[i].purity() < threshold) return false;
+      if(purity[i] < threshold) return false;
     }
     return true;
   }
 
-  _prec average_purity(string signalid="RAW",int length=-1) const {
+  _prec average_purity(const SignalId &signalid="RAW",int length=-1) const {
 
     _prec purity_sum=0;
 
+    const purity_vec_type &purity = const_purity(signalid);
     size_t n=0;
-    for(typename signal_vec_type::const_iterator i = const_signal(signalid).begin();(i != const_signal(signalid).end()) && (n < length);i++,n++) {
-      purity_sum += (*i).purity();
+    for(typename purity_vec_type::const_iterator i = purity.begin();(i != purity.end()) && (n < length);i++,n++) {
+      purity_sum += (*i);
     }
 
-    return purity_sum/const_signal(signalid).size();
+    return purity_sum/purity.size();
   }
 
-  bool off_edge(int threshold,string signalid) const {
+  bool off_edge(int threshold,const SignalId &signalid) const {
     int offedgecount=0;
-    for(typename signal_vec_type::const_iterator i = const_signal(signalid).begin();i != const_signal(signalid).end();i++) {
-      if((*i).off_edge()) offedgecount++;
+    const offedge_vec_type &o = const_offedge(signalid);
+    for(typename offedge_vec_type::const_iterator i = o.begin();i != o.end();i++) {
+      if(intensities_type::off_edge(*i)) offedgecount++;
     }
   
     if(offedgecount > threshold) return true; else return false;
   }
   
-  bool any_off_edge(string signalid, int threshold) const {
+  bool any_off_edge(const SignalId &signalid, int threshold) const {
     int offedgecount=0;
-    for(typename signal_vec_type::const_iterator i = const_signal(signalid).begin();i != const_signal(signalid).end();i++) {
-      if((*i).any_off_edge()) offedgecount++;
+    const offedge_vec_type &o = const_offedge(signalid);
+    for(typename offedge_vec_type::const_iterator i = o.begin();i != o.end();i++) {
+      if(intensities_type::any_off_edge(*i)) offedgecount++;
     }
   
     if(offedgecount > threshold) return true; else return false;
   }
   
-  bool first_off_edge(string signalid,unsigned int howmany) const {
+  bool first_off_edge(const SignalId &signalid,unsigned int howmany) const {
     int offedgecount=0;
 
-    //TODO: Use an iterator here
     for(size_t i = 0;i < howmany;i++) {
-      if(const_signal(signalid)[i].off_edge()) offedgecount++;
+      if(intensities_type::off_edge(offedge_mask(signalid,i))) offedgecount++;
     }
   
     if(offedgecount > 0) return true;
                  else    return false;
   }
 
-  _prec average_peaksignal(string signalid) const {
+  _prec average_peaksignal(const SignalId &signalid) const {
     _prec sum=0;
-    for(typename signal_vec_type::const_iterator i = const_signal(signalid).begin();i != const_signal(signalid).end();i++) {
+    const signal_vec_type &sig = const_signal(signalid);
+    for(typename signal_vec_type::const_iterator i = sig.begin();i != sig.end();i++) {
       sum += (*i).max_intensity();
     }
 
-    return sum/signal_vec.size();
+    return sum/signal_slots.size();
   }
   
-  _prec average_peaksignal_within(string signalid,int bases=0) const {
+  _prec average_peaksignal_within(const SignalId &signalid,int bases=0) const {
     _prec sum=0;
+    const signal_vec_type &sig = const_signal(signalid);
     for(int n=0;n < bases;n++) {
-      sum += const_signal(signalid)[n].max_intensity();
+      sum += sig[n].max_intensity();
     }
 
     return sum/bases;
   }
 
 
-  string dump_gapipelinestr(string signalid) const {
+  string dump_gapipelinestr(const SignalId &signalid) const {
     string s;
     s += "1 1 ";
     s += get_position().as_string();
@@ -364,55 +514,38 @@ public:
     return s;
   }
   
-  bool read_gapipelinestr(string signalid,string line) {
-    stringstream in(line);
-    
-    string s;
-    
-    // discard lane and tile number
-    in >> s;
-    in >> s;
+  bool read_gapipelinestr(const SignalId &signalid,const string &line) {
+    GAPipelineLine in(line.data(),line.data()+line.size());
 
-    in >> s;
-    int x = convertTo<int>(s);
-    
-    in >> s;
-    int y = convertTo<int>(s);
+    // discard lane and tile number
+    int lane=0,tile=0,x=0,y=0;
+    in.next_int(lane);
+    in.next_int(tile);
+    in.next_int(x);
+    in.next_int(y);
     set_position(ClusterPosition<_position_prec>(x,y));
     
     signal(signalid).clear();
-    for(;!in.eof();) {
-      string sa;
-      in >> sa;
-
-      string sc;
-      in >> sc;
-
-      string sg;
-      in >> sg;
-
-      bool end_of_line = in.eof();
-      string st;
-      in >> st;
-     
-      if(!end_of_line) {
-        double a = convertTo<double>(sa);
-        double c = convertTo<double>(sc);
-        double g = convertTo<double>(sg);
-        double t = convertTo<double>(st);
-
-        bool a_offedge=false;
-        bool c_offedge=false;
-        bool g_offedge=false;
-        bool t_offedge=false;
-
-        if(a == 0.0) a_offedge=true;
-        if(c == 0.0) c_offedge=true;
-        if(g == 0.0) g_offedge=true;
-        if(t == 0.0) t_offedge=true;
-        
-        signal(signalid).push_back(ReadIntensity<_prec>(a,c,g,t,a_offedge,c_offedge,g_offedge,t_offedge));
-      }
+    offedge(signalid).clear();
+
+    // Reserve up front, growing a cycle at a time leaves the outgrown buffers behind in an arena.
+    // Four whitespace separated fields per cycle after the lane, tile, x and y fields.
+    size_t separators=0;
+    for(size_t n=0;n<line.size();n++) if((line[n] == ' ') || (line[n] == '\t')) separators++;
+    signal (signalid).reserve(separators/4);
+    offedge(signalid).reserve(separators/4);
+
+    // only complete groups of four are kept
+    double v[4];
+    while(in.next_cycle(v)) {
+      offedge_mask_type mask=0;
+      if(v[0] == 0.0) mask |= (1 << intensities_type::base_a);
+      if(v[1] == 0.0) mask |= (1 << intensities_type::base_c);
+      if(v[2] == 0.0) mask |= (1 << intensities_type::base_g);
+      if(v[3] == 0.0) mask |= (1 << intensities_type::base_t);
+
+      signal(signalid).push_back(ReadIntensity<_prec>(v[0],v[1],v[2],v[3]));
+      offedge(signalid).push_back(mask);
     }
 
     return true;
@@ -0,0 +1,68 @@
+/*
+    Swift (c) 2008 Genome Research Ltd.
+    Authors: Nava Whiteford and Tom Skelly (new@sgenomics.org ts6@sanger.ac.uk)
+
+    This file is part of Swift (http://swiftng.sourceforge.net).
+
+    Swift is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Swift is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with Swift.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SWIFT_CLUSTERSUBSET_H
+#define SWIFT_CLUSTERSUBSET_H
+
+#include <vector>
+#include "Cluster.h"
+
+using namespace std;
+
+/// A read only view of some of a vector of clusters, held as indices into it. Used to pass on the
+/// clusters a filter selected without copying them. Indexes like a vector: subset[n] is the nth
+/// selected cluster. The clusters must outlive the view, and not be added to or removed from.
+template<class _prec=double>
+class ClusterSubset {
+public:
+
+  ClusterSubset(const vector<Cluster<_prec> > &clusters,const vector<size_t> &indices) : m_clusters(&clusters),
+                                                                                         m_indices(indices) {
+  }
+
+  /// All of the clusters
+  ClusterSubset(const vector<Cluster<_prec> > &clusters) : m_clusters(&clusters),
+                                                           m_indices(clusters.size()) {
+    for(size_t n=0;n<m_indices.size();n++) m_indices[n] = n;
+  }
+
+  inline size_t size() const {
+    return m_indices.size();
+  }
+
+  inline const Cluster<_prec> &operator[](size_t n) const {
+    return (*m_clusters)[m_indices[n]];
+  }
+
+  /// Position of the nth selected cluster in the underlying vector
+  inline size_t index(size_t n) const {
+    return m_indices[n];
+  }
+
+  const vector<size_t> &indices() const {
+    return m_indices;
+  }
+
+private:
+  const vector<Cluster<_prec> > *m_clusters;
+  vector<size_t>                 m_indices;
+};
+
+#endif
@@ -0,0 +1,39 @@
+/*
+    Swift (c) 2008 Genome Research Ltd.
+    Authors: Nava Whiteford and Tom Skelly (new@sgenomics.org ts6@sanger.ac.uk)
+
+    This file is part of Swift (http://swiftng.sourceforge.net).
+
+    Swift is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Swift is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with Swift.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/// Writes the table one cluster per line, in the same layout as Cluster::dump_gapipelinestr
+template <class _prec,class _position_prec>
+inline std::ostream& operator<<(std::ostream& out, const ClusterTable<_prec,_position_prec> &rhs) {
+
+  const vector<string> signal_ids = rhs.get_signal_ids();
+
+  for(vector<string>::const_iterator i = signal_ids.begin();i != signal_ids.end();i++) {
+    out << ">SIGNAL " << (*i) << std::endl;
+    for(size_t cluster=0;cluster < rhs.cluster_count();cluster++) {
+      out << rhs.get_position(cluster).as_string() << " ";
+      for(size_t cycle=0;cycle < rhs.cycle_count();cycle++) {
+        out << rhs.get_intensity((*i),cycle,cluster).as_string() << " ";
+      }
+      out << std::endl;
+    }
+  }
+
+  return out;
+}
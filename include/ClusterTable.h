@@ -0,0 +1,467 @@
+/*
+    Swift (c) 2008 Genome Research Ltd.
+    Authors: Nava Whiteford and Tom Skelly (new@sgenomics.org ts6@sanger.ac.uk)
+
+    This file is part of Swift (http://swiftng.sourceforge.net).
+
+    Swift is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Swift is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with Swift.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SWIFT_CLUSTERTABLE_H
+#define SWIFT_CLUSTERTABLE_H
+
+#include <vector>
+#include <map>
+#include <string>
+#include <algorithm>
+#include <stdexcept>
+#include "Cluster.h"
+#include "ClusterPosition.h"
+#include "ReadIntensity.h"
+#include "HalfFloat.h"
+
+using namespace std;
+
+/// Columnar (structure of arrays) store for the clusters of a tile.
+///
+/// Each signal id is held as one contiguous array laid out cycle major: [cycle][cluster][base].
+/// A single cycle of a signal is therefore a unit stride run of cluster_count*4 values; one cluster
+/// across its cycles is not (see ClusterView). Positions, validity and off edge flags are held as
+/// separate columns. Adapters convert to and from vector<Cluster>.
+///
+/// The table is used where a tile's intensities are moved in bulk: GAPipeline text parsing, binary intensity
+/// files and spilling image analysis to disk. A tile run in chunks also reads each stripe into a table and
+/// applies the off edge filters and crosstalk correction to it a cycle at a time, the later correction stages
+/// still run on vector<Cluster>.
+template <class _prec = float, class _position_prec = int>
+class ClusterTable {
+
+public:
+  typedef Cluster<_prec,_position_prec>   cluster_type;     ///< Row type used by the adapters
+  typedef ReadIntensity<_prec>            intensities_type; ///< Type which holds 4 intensities (one for each base).
+  typedef ClusterPosition<_position_prec> position_type;    ///< Cluster x,y
+  typedef _prec                           value_type;       ///< A single intensity
+  typedef vector<_prec>                   signal_column;    ///< cycles*clusters*base_count values
+  typedef unsigned char                   offedge_type;     ///< Off edge flags, bit n set if base n is off edge
+  typedef vector<offedge_type>            offedge_column;   ///< cycles*clusters flags
+
+  static const int base_count = ReadIntensity<_prec>::base_count;
+
+  /// Precision a signal column is held at, see archive_signal
+  enum storage_type {
+    storage_native, ///< _prec, the default
+    storage_fp16,   ///< IEEE half precision, 11 bit significand, max 65504
+    storage_bf16    ///< bfloat16, float range with an 8 bit significand
+  };
+
+  /// Unit stride view of a single cycle of a signal, one group of base_count values per cluster.
+  class CycleView {
+  public:
+    CycleView(_prec *data,size_t cluster_count) : m_data(data), m_cluster_count(cluster_count) {
+    }
+
+    inline _prec       *operator[](size_t cluster)       { return m_data + (cluster*base_count); }
+    inline const _prec *operator[](size_t cluster) const { return m_data + (cluster*base_count); }
+
+    inline _prec *begin() { return m_data; }
+    inline _prec *end()   { return m_data + (m_cluster_count*base_count); }
+
+    inline size_t size() const { return m_cluster_count; }
+
+  private:
+    _prec *m_data;
+    size_t m_cluster_count;
+  };
+
+  /// View of one cluster across all cycles of a signal. Consecutive cycles are cluster_count*4 apart, so
+  /// this is a strided walk: per cluster work is better done a cycle at a time through CycleView.
+  class ClusterView {
+  public:
+    ClusterView(_prec *data,size_t cycle_count,size_t stride) : m_data(data), m_cycle_count(cycle_count), m_stride(stride) {
+    }
+
+    inline _prec       *operator[](size_t cycle)       { return m_data + (cycle*m_stride); }
+    inline const _prec *operator[](size_t cycle) const { return m_data + (cycle*m_stride); }
+
+    inline size_t size() const { return m_cycle_count; }
+
+  private:
+    _prec *m_data;
+    size_t m_cycle_count;
+    size_t m_stride;
+  };
+
+private:
+  struct archive_column {
+    storage_type     storage;
+    vector<uint16_t> values;
+  };
+
+  size_t                         m_cluster_count;   ///< Number of rows in the table
+  size_t                         m_cycle_count;     ///< Number of cycles in every signal column
+  vector<_position_prec>         m_x;               ///< Position column, x
+  vector<_position_prec>         m_y;               ///< Position column, y
+  vector<unsigned char>          m_valid;           ///< Validity column (not vector<bool>, so it can be written in parallel)
+  vector<string>                 signal_ids;        ///< List of signal ids, in insertion order
+  map<string,signal_column>      m_signals;         ///< Signal columns
+  map<string,offedge_column>     m_offedge;         ///< Off edge flag columns, one per signal
+  map<string,archive_column>     m_archive;         ///< 16 bit copies of archived signals, their native column is left empty
+
+  /// Keeps only the listed rows of a cycle major column with width values per row.
+  /// Rows only ever move towards the start of the column, so compaction can be done in place.
+  template<class _column>
+  void compact_column(_column &col,const vector<size_t> &keep,size_t width) {
+    size_t new_count = keep.size();
+    for(size_t cycle=0;cycle<m_cycle_count;cycle++) {
+      for(size_t n=0;n<new_count;n++) {
+        size_t from = (cycle*m_cluster_count)+keep[n];
+        size_t to   = (cycle*new_count)+n;
+        for(size_t b=0;b<width;b++) col[(to*width)+b] = col[(from*width)+b];
+      }
+    }
+    col.resize(m_cycle_count*new_count*width);
+  }
+
+  /// The column of a signal, or of its off edge flags. Throws invalid_argument for an unknown signal.
+  template<class _column>
+  static _column &column(map<string,_column> &columns,const string &identifier) {
+    typename map<string,_column>::iterator i = columns.find(identifier);
+    if(i == columns.end()) throw invalid_argument("ClusterTable: no signal " + identifier);
+    return (*i).second;
+  }
+
+  template<class _column>
+  static const _column &column(const map<string,_column> &columns,const string &identifier) {
+    typename map<string,_column>::const_iterator i = columns.find(identifier);
+    if(i == columns.end()) throw invalid_argument("ClusterTable: no signal " + identifier);
+    return (*i).second;
+  }
+
+  static inline uint16_t half_encode(_prec v,storage_type storage) {
+    if(storage == storage_bf16) return float_to_bf16(v);
+    return float_to_fp16(v);
+  }
+
+  static inline _prec half_decode(uint16_t v,storage_type storage) {
+    if(storage == storage_bf16) return bf16_to_float(v);
+    return fp16_to_float(v);
+  }
+
+public:
+  ClusterTable() : m_cluster_count(0), m_cycle_count(0) {
+  }
+
+  ClusterTable(size_t cluster_count,size_t cycle_count) : m_cluster_count(0), m_cycle_count(0) {
+    resize(cluster_count,cycle_count);
+  }
+
+  /// Resize the table, existing signal columns are discarded.
+  void resize(size_t cluster_count,size_t cycle_count) {
+    m_cluster_count = cluster_count;
+    m_cycle_count   = cycle_count;
+
+    m_x.assign(cluster_count,0);
+    m_y.assign(cluster_count,0);
+    m_valid.assign(cluster_count,1);
+
+    signal_ids.clear();
+    m_signals.clear();
+    m_offedge.clear();
+    m_archive.clear();
+  }
+
+  /// Adds cycles to the end of every signal, zero filled and marked off edge. Columns are cycle major, so
+  /// nothing already held moves.
+  void append_cycles(size_t cycles) {
+    m_cycle_count += cycles;
+
+    offedge_type all = intensities_type::offedge_all;
+    for(typename map<string,signal_column>::iterator s = m_signals.begin();s != m_signals.end();s++) {
+      typename map<string,archive_column>::iterator a = m_archive.find((*s).first);
+      if(a == m_archive.end()) (*s).second.resize(m_cycle_count*m_cluster_count*base_count,0);
+                          else (*a).second.values.resize(m_cycle_count*m_cluster_count*base_count,half_encode(0,(*a).second.storage));
+      m_offedge[(*s).first].resize(m_cycle_count*m_cluster_count,all);
+    }
+  }
+
+  inline size_t cluster_count() const { return m_cluster_count; }
+  inline size_t cycle_count()   const { return m_cycle_count;   }
+  inline size_t size()          const { return m_cluster_count; }
+
+  bool has_signal(const string &identifier) const {
+    return m_signals.find(identifier) != m_signals.end();
+  }
+
+  /// Adds a zero filled signal column, does nothing if it already exists.
+  bool add_signal(const string &identifier) {
+    if(has_signal(identifier)) return true;
+
+    m_signals[identifier].assign(m_cycle_count*m_cluster_count*base_count,0);
+    m_offedge[identifier].assign(m_cycle_count*m_cluster_count,0);
+    signal_ids.push_back(identifier);
+
+    return true;
+  }
+
+  /// Frees the storage used by a signal column.
+  void delete_signal(const string &identifier) {
+    if(!has_signal(identifier)) {
+      cerr << "Error in ClusterTable.h: identifier not found during delete: " << identifier << endl;
+      return;
+    }
+
+    m_signals.erase(identifier);
+    m_offedge.erase(identifier);
+    m_archive.erase(identifier);
+    signal_ids.erase(std::remove(signal_ids.begin(),signal_ids.end(),identifier),signal_ids.end());
+  }
+
+  const vector<string> get_signal_ids() const {
+    return signal_ids;
+  }
+
+  /// Raw access to a signal column, no bounds checking within it. Throws invalid_argument for an unknown signal.
+  inline _prec *data(const string &identifier) {
+    return column(m_signals,identifier).data();
+  }
+
+  /// Raw access to a signal column, const version
+  inline const _prec *const_data(const string &identifier) const {
+    return column(m_signals,identifier).data();
+  }
+
+  /// Raw access to an off edge column, no bounds checking within it. Throws invalid_argument for an unknown signal.
+  inline offedge_type *offedge_data(const string &identifier) {
+    return column(m_offedge,identifier).data();
+  }
+
+  /// Raw access to an off edge column, const version
+  inline const offedge_type *const_offedge_data(const string &identifier) const {
+    return column(m_offedge,identifier).data();
+  }
+
+  /// Offset of the first base of a cluster/cycle within a signal column
+  inline size_t offset(size_t cycle,size_t cluster) const {
+    return ((cycle*m_cluster_count)+cluster)*base_count;
+  }
+
+  /// The base_count intensities of one cluster in one cycle, no bounds checking
+  inline _prec *intensity(const string &identifier,size_t cycle,size_t cluster) {
+    return data(identifier) + offset(cycle,cluster);
+  }
+
+  inline CycleView cycle(const string &identifier,size_t cycle) {
+    return CycleView(data(identifier) + offset(cycle,0),m_cluster_count);
+  }
+
+  inline ClusterView cluster(const string &identifier,size_t cluster) {
+    return ClusterView(data(identifier) + offset(0,cluster),m_cycle_count,m_cluster_count*base_count);
+  }
+
+  /// Returns the values as a ReadIntensity, archived signals are expanded
+  intensities_type get_intensity(const string &identifier,size_t cycle,size_t cluster) const {
+
+    typename map<string,archive_column>::const_iterator a = m_archive.find(identifier);
+    if(a != m_archive.end()) {
+      const uint16_t *i = (*a).second.values.data() + offset(cycle,cluster);
+      intensities_type r;
+      for(int n=0;n<base_count;n++) r.set_base(n,half_decode(i[n],(*a).second.storage));
+      return r;
+    }
+
+    const _prec *i = const_data(identifier) + offset(cycle,cluster);
+    return intensities_type(i[0],i[1],i[2],i[3]);
+  }
+
+  /// Sets the values for one cluster/cycle, not valid for archived signals
+  void set_intensity(const string &identifier,size_t cycle,size_t cluster,const intensities_type &r) {
+    _prec *i = data(identifier) + offset(cycle,cluster);
+    for(int n=0;n<base_count;n++) i[n] = r.get_base(n);
+  }
+
+  inline offedge_type get_offedge(const string &identifier,size_t cycle,size_t cluster) const {
+    return const_offedge_data(identifier)[(cycle*m_cluster_count)+cluster];
+  }
+
+  inline void set_offedge(const string &identifier,size_t cycle,size_t cluster,offedge_type mask) {
+    offedge_data(identifier)[(cycle*m_cluster_count)+cluster] = mask;
+  }
+
+  /// Storage used by a signal column
+  storage_type get_storage(const string &identifier) const {
+    typename map<string,archive_column>::const_iterator a = m_archive.find(identifier);
+    if(a == m_archive.end()) return storage_native;
+    return (*a).second.storage;
+  }
+
+  /// Converts a signal to 16 bit storage, halving (for float) its memory use.
+  /// Intended for signals which are only kept so they can be written out (intout, corrected_intout):
+  /// get_intensity still works, the raw data/view accessors do not.
+  void archive_signal(const string &identifier,storage_type storage) {
+    if((storage == storage_native) || (get_storage(identifier) != storage_native)) return;
+
+    signal_column &sig = column(m_signals,identifier);
+    archive_column &a = m_archive[identifier];
+    a.storage = storage;
+    a.values.resize(sig.size());
+    for(size_t n=0;n<sig.size();n++) a.values[n] = half_encode(sig[n],storage);
+
+    signal_column().swap(sig);
+  }
+
+  /// Raw access to the 16 bit values of an archived signal, laid out as data() is. Throws invalid_argument unless it's archived.
+  inline const uint16_t *const_archive_data(const string &identifier) const {
+    return column(m_archive,identifier).values.data();
+  }
+
+  /// Expands an archived signal back to native precision, values keep the precision they were archived at.
+  void restore_signal(const string &identifier) {
+    typename map<string,archive_column>::iterator a = m_archive.find(identifier);
+    if(a == m_archive.end()) return;
+
+    signal_column &sig = column(m_signals,identifier);
+    sig.resize((*a).second.values.size());
+    for(size_t n=0;n<sig.size();n++) sig[n] = half_decode((*a).second.values[n],(*a).second.storage);
+
+    m_archive.erase(a);
+  }
+
+  inline _position_prec *x_data() { return m_x.data(); }
+  inline _position_prec *y_data() { return m_y.data(); }
+
+  inline const ClusterPosition<_position_prec> get_position(size_t cluster) const {
+    return ClusterPosition<_position_prec>(m_x[cluster],m_y[cluster]);
+  }
+
+  inline void set_position(size_t cluster,const ClusterPosition<_position_prec> &newpos) {
+    m_x[cluster] = newpos.x;
+    m_y[cluster] = newpos.y;
+  }
+
+  inline bool is_valid(size_t cluster) const {
+    return m_valid[cluster] != 0;
+  }
+
+  inline void set_valid(size_t cluster,bool v) {
+    m_valid[cluster] = v ? 1 : 0;
+  }
+
+  /// Removes invalid rows from all columns, preserving the order of the remaining rows.
+  void remove_invalid() {
+    vector<size_t> keep;
+    keep.reserve(m_cluster_count);
+    for(size_t n=0;n<m_cluster_count;n++) if(m_valid[n]) keep.push_back(n);
+
+    if(keep.size() == m_cluster_count) return;
+
+    size_t new_count = keep.size();
+    for(size_t n=0;n<new_count;n++) {
+      m_x[n] = m_x[keep[n]];
+      m_y[n] = m_y[keep[n]];
+    }
+    m_x.resize(new_count);
+    m_y.resize(new_count);
+    m_valid.assign(new_count,1);
+
+    for(typename map<string,signal_column>::iterator s = m_signals.begin();s != m_signals.end();s++) {
+      typename map<string,archive_column>::iterator a = m_archive.find((*s).first);
+      if(a == m_archive.end()) compact_column((*s).second      ,keep,base_count);
+                          else compact_column((*a).second.values,keep,base_count);
+      compact_column(m_offedge[(*s).first],keep,1);
+    }
+
+    m_cluster_count = new_count;
+  }
+
+  /// As above, also removing the entries of tags (one per row) belonging to the invalid rows
+  template<class _tag>
+  void remove_invalid(vector<_tag> &tags) {
+    size_t kept=0;
+    for(size_t n=0;n<m_cluster_count;n++) if(m_valid[n]) tags[kept++] = tags[n];
+    tags.resize(kept);
+
+    remove_invalid();
+  }
+
+  /// Build the table from a vector of clusters, copying the listed signals.
+  /// The cycle count is taken from the longest signal, shorter signals are zero padded and marked off edge.
+  void from_clusters(const vector<cluster_type> &clusters,const vector<string> &identifiers) {
+
+    size_t cycles=0;
+    for(typename vector<cluster_type>::const_iterator i = clusters.begin();i != clusters.end();i++) {
+      for(vector<string>::const_iterator s = identifiers.begin();s != identifiers.end();s++) {
+        if((*i).const_signal(*s).size() > cycles) cycles = (*i).const_signal(*s).size();
+      }
+    }
+
+    resize(clusters.size(),cycles);
+
+    for(size_t n=0;n<clusters.size();n++) {
+      m_x[n]     = clusters[n].get_position().x;
+      m_y[n]     = clusters[n].get_position().y;
+      m_valid[n] = clusters[n].is_valid() ? 1 : 0;
+    }
+
+    for(vector<string>::const_iterator s = identifiers.begin();s != identifiers.end();s++) {
+      add_signal(*s);
+
+      for(size_t n=0;n<clusters.size();n++) {
+        const typename cluster_type::signal_vec_type &sig = clusters[n].const_signal(*s);
+        for(size_t cycle=0;cycle<cycles;cycle++) {
+          if(cycle < sig.size()) {
+            set_intensity(*s,cycle,n,sig[cycle]);
+            set_offedge  (*s,cycle,n,clusters[n].offedge_mask(*s,cycle));
+          } else {
+            set_intensity(*s,cycle,n,intensities_type(0,0,0,0));
+            set_offedge  (*s,cycle,n,intensities_type::offedge_all);
+          }
+        }
+      }
+    }
+  }
+
+  /// Write the listed signals back into a vector of clusters.
+  /// If the vector is not the same size as the table it is rebuilt, taking positions and validity from the table.
+  void to_clusters(vector<cluster_type> &clusters,const vector<string> &identifiers) const {
+
+    if(clusters.size() != m_cluster_count) {
+      clusters.clear();
+      clusters.resize(m_cluster_count);
+      for(size_t n=0;n<m_cluster_count;n++) {
+        clusters[n].set_position(get_position(n));
+        clusters[n].set_valid(is_valid(n));
+      }
+    }
+
+    for(vector<string>::const_iterator s = identifiers.begin();s != identifiers.end();s++) {
+      for(size_t n=0;n<m_cluster_count;n++) {
+        clusters[n].add_signal(*s);
+        typename cluster_type::signal_vec_type &sig = clusters[n].signal(*s);
+        sig.clear();
+        sig.reserve(m_cycle_count);
+        for(size_t cycle=0;cycle<m_cycle_count;cycle++) sig.push_back(get_intensity(*s,cycle,n));
+
+        typename cluster_type::offedge_vec_type &mask = clusters[n].offedge(*s);
+        mask.clear();
+        mask.reserve(m_cycle_count);
+        for(size_t cycle=0;cycle<m_cycle_count;cycle++) mask.push_back(get_offedge(*s,cycle,n));
+      }
+    }
+  }
+
+};
+
+#include "ClusterTable.cpp"
+
+#endif
@@ -241,12 +241,15 @@ public:
 	// or default (an odd thing to do) makes no difference.
 
 	bool is_set (const string &parm) {
-		return (parm_list.count(parm) > 0);
+		return (thread_parms().count(parm) > 0) || (parm_list.count(parm) > 0);
 	}
 
 	string get_parm (const string &parm) {
     // no bounds checking...
-		if(is_set(parm)) {
+		parm_types_t::const_iterator t = thread_parms().find(parm);
+		if(t != thread_parms().end()) {
+			return (*t).second;
+		} else if(parm_list.count(parm) > 0) {
 			return (*parm_list.find(parm)).second;
 		} else {
 			return string("");
@@ -259,6 +262,17 @@ public:
 	  return convertTo<_T>(get_parm(parm));
 	}
 
+  // The batch mode of swift_main runs several tiles at once, on their own threads, each with its own
+  // file names. A value set for a thread takes precedence over the shared one, on that thread only.
+
+  void set_thread_parm (const string &parm,const string &value) {
+    thread_parms()[parm] = value;
+  }
+
+  void clear_thread_parms () {
+    thread_parms().clear();
+  }
+
 	/// Print usage information
 	string usage() {
 
@@ -292,6 +306,11 @@ public:
   }
 
 private:
+
+  static parm_types_t &thread_parms () {
+    static thread_local parm_types_t parms;
+    return parms;
+  }
   
 	parm_types_t         parm_list;        ///< Parameter values
 	parm_description_t   parm_description; ///< Description of valid parameters/usage
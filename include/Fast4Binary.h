@@ -0,0 +1,181 @@
+/*
+    Swift (c) 2008 Genome Research Ltd.
+    Authors: Nava Whiteford and Tom Skelly (new@sgenomics.org ts6@sanger.ac.uk)
+
+    This file is part of Swift (http://swiftng.sourceforge.net).
+
+    Swift is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Swift is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with Swift.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SWIFT_FAST4BINARY_H
+#define SWIFT_FAST4BINARY_H
+
+#include <string>
+#include <cstring>
+#include <cstdint>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+// Binary FAST4. All integers are 32 bit little endian.
+//
+// Header:
+//   0  "FAST4BIN"
+//   8  version (1)
+//   12 header size, the offset of the first record (a multiple of 8)
+//   16 cycles per read
+//   20 bases (4)
+//   24 record size, 8+(bases*cycles)
+//   28 scale, a stored value v is the probability v/scale
+//   32 base names, one character per base ("ACGT")
+//   36 id prefix length
+//   40 id prefix, zero padded to the header size
+//
+// Records, fixed size, from the header size to the end of the file:
+//   0 x
+//   4 y
+//   8 bases planes of cycles bytes, base 0 for every cycle first (the same order as the text format's lines)
+//
+// A read's id is the prefix followed by x:y.
+
+static const char     fast4_binary_magic[8]    = {'F','A','S','T','4','B','I','N'};
+static const uint32_t fast4_binary_version     = 1;
+static const uint32_t fast4_binary_scale       = 255;
+static const size_t   fast4_binary_fixed_header = 40;
+
+inline void fast4_put_le32(char *p,uint32_t v) {
+  for(int n=0;n<4;n++) p[n] = static_cast<char>((v >> (8*n)) & 0xff);
+}
+
+inline uint32_t fast4_get_le32(const char *p) {
+  uint32_t v=0;
+  for(int n=0;n<4;n++) v |= static_cast<uint32_t>(static_cast<unsigned char>(p[n])) << (8*n);
+  return v;
+}
+
+/// Quantises a probability for a binary FAST4 plane
+template<class _prec>
+inline unsigned char fast4_binary_quantise(_prec p) {
+  if(!(p > 0)) return 0;
+  if(p >= 1)   return fast4_binary_scale;
+  return static_cast<unsigned char>((p*fast4_binary_scale)+0.5);
+}
+
+/// Reads a binary FAST4 file in place, through mmap. Records are fixed size so any read can be found directly.
+class Fast4BinaryReader {
+public:
+
+  Fast4BinaryReader(string filename_in) : filename(filename_in), m_data(0), m_size(0), m_records(0), m_cycles(0), m_bases(0), m_record_size(0), m_header_size(0), m_scale(1) {
+  }
+
+  ~Fast4BinaryReader() {
+    close();
+  }
+
+  /// Maps the file and checks the header, false if it can't be read or isn't binary FAST4
+  bool open() {
+    close();
+
+    int fd = ::open(filename.c_str(),O_RDONLY);
+    if(fd < 0) return false;
+
+    struct stat st;
+    if(fstat(fd,&st) != 0 || static_cast<size_t>(st.st_size) < fast4_binary_fixed_header) { ::close(fd); return false; }
+
+    m_size = st.st_size;
+    void *p = mmap(0,m_size,PROT_READ,MAP_PRIVATE,fd,0);
+    ::close(fd);
+    if(p == MAP_FAILED) { m_size = 0; return false; }
+    m_data = static_cast<const char *>(p);
+
+    bool ok = (memcmp(m_data,fast4_binary_magic,sizeof(fast4_binary_magic)) == 0) &&
+              (fast4_get_le32(m_data+8) == fast4_binary_version);
+    if(ok) {
+      m_header_size = fast4_get_le32(m_data+12);
+      m_cycles      = fast4_get_le32(m_data+16);
+      m_bases       = fast4_get_le32(m_data+20);
+      m_record_size = fast4_get_le32(m_data+24);
+      m_scale       = fast4_get_le32(m_data+28);
+      uint32_t prefix_length = fast4_get_le32(m_data+36);
+
+      ok = (m_header_size >= fast4_binary_fixed_header+prefix_length) && (m_header_size <= m_size) &&
+           (m_record_size == 8+(m_bases*m_cycles)) && (m_scale > 0);
+      if(ok) {
+        m_base_names.assign(m_data+32,(m_bases < 4) ? m_bases : 4);
+        m_prefix.assign(m_data+fast4_binary_fixed_header,prefix_length);
+        m_records = (m_size-m_header_size)/m_record_size;
+      }
+    }
+
+    if(!ok) close();
+    return ok;
+  }
+
+  void close() {
+    if(m_data != 0) munmap(const_cast<char *>(m_data),m_size);
+    m_data    = 0;
+    m_size    = 0;
+    m_records = 0;
+  }
+
+  size_t size()   const { return m_records; }   ///< Number of reads
+  size_t cycles() const { return m_cycles;  }
+  size_t bases()  const { return m_bases;   }
+
+  const string &base_names() const { return m_base_names; }
+  const string &id_prefix()  const { return m_prefix;     }
+
+  int x(size_t read) const { return static_cast<int32_t>(fast4_get_le32(record(read)));   }
+  int y(size_t read) const { return static_cast<int32_t>(fast4_get_le32(record(read)+4)); }
+
+  string id(size_t read) const {
+    return m_prefix + to_string(x(read)) + ":" + to_string(y(read));
+  }
+
+  /// The quantised probabilities of a base for every cycle of a read
+  const unsigned char *plane(size_t read,size_t base) const {
+    return reinterpret_cast<const unsigned char *>(record(read)+8+(base*m_cycles));
+  }
+
+  double probability(size_t read,size_t base,size_t cycle) const {
+    return static_cast<double>(plane(read,base)[cycle])/m_scale;
+  }
+
+  string filename;
+
+private:
+
+  const char *record(size_t read) const {
+    return m_data+m_header_size+(read*m_record_size);
+  }
+
+  Fast4BinaryReader(const Fast4BinaryReader &);
+  Fast4BinaryReader &operator=(const Fast4BinaryReader &);
+
+  const char *m_data;           ///< The mapped file
+  size_t      m_size;           ///< Bytes mapped
+  size_t      m_records;
+  size_t      m_cycles;
+  size_t      m_bases;
+  size_t      m_record_size;
+  size_t      m_header_size;
+  uint32_t    m_scale;
+  string      m_base_names;
+  string      m_prefix;
+};
+
+#endif
@@ -19,33 +19,53 @@
 */
 
 #ifndef SWIFT_FAST4WRITER_H
-#define SEIFT_FAST4WRITER_H
+#define SWIFT_FAST4WRITER_H
 
 #include <vector>
 #include <string>
 #include <iostream>
-#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <cmath>
+#include <cstdlib>
+#include "OutputBuffer.h"
+#include "Fast4Binary.h"
 #include "ProbabilitySequence.h"
 
 using namespace std;
 
+/// Writes FAST4. Records are formatted by hand straight into an OutputBuffer, the text is the same as
+/// ostream << fixed << setprecision(4) would give. In binary mode records are fixed size quantised
+/// probability planes, see Fast4Binary.h, the header is written with the first record.
 template<class _basetype=int, class _prbprec=double>
 class Fast4Writer {
 public:
 
   string filename;
-  ofstream fast4_handle;
+  OutputBuffer fast4_handle;
   int quality_conversion; // This value is subtracted for the ascii character value to obtain the quality score.
   bool textmode;
+  bool binarymode;
+  BgzfPool *compression; ///< Write BGZF using these threads, 0 for plain text
 
-  Fast4Writer(string filename_in) : filename(filename_in), textmode(true) {
+  Fast4Writer(string filename_in) : filename(filename_in), textmode(true), binarymode(false), compression(0), m_header_written(false), m_cycles(0) {
     quality_conversion = 74;
   }
 
+  /// Write the file as BGZF (gzip compatible), compressed by the pool's threads. Call before open.
+  void set_compressed(BgzfPool *pool) {
+    compression = pool;
+  }
+
   void set_textmode() {
     textmode = true;
   }
 
+  /// Write binary FAST4 (readable with Fast4BinaryReader) rather than text
+  void set_binarymode() {
+    binarymode = true;
+  }
+
   void qualityoffset(int qualityoffset_in) {
     quality_conversion = qualityoffset_in;
   }
@@ -107,13 +127,7 @@ public:
 
     for(size_t n=0;n<ProbabilitySequence<_basetype,_prbprec>::base_count;n++) {
       for(typename ProbabilitySequence<_basetype,_prbprec>::probability_sequence_type::const_iterator i=p.const_sequence().begin();i != p.const_sequence().end();i++) {
-        int c = static_cast<int>(10*(log10(((*i)[n])/(1-(*i)[n]))));
-        if(c>= 50) c= 50;
-        if(c<=-40) c=-40;
-
-        c += quality_conversion;
-
-        s << static_cast<char>(c);
+        s << ascii_quality((*i)[n]);
       }
       s << endl;
     }
@@ -122,19 +136,121 @@ public:
   }
 
   void write(const ProbabilitySequence<_basetype,_prbprec> &s) {
-    if( textmode) fast4_handle << get_fast4_textmode_string_sequence(s);
-    if(!textmode) fast4_handle << get_fast4_ascii_string_sequence(s);
+    write(s.get_id(),s.const_sequence().data(),s.size());
+  }
+
+  /// Writes a record for length base probabilities starting at p, which needn't be a whole ProbabilitySequence
+  template<class _base_type>
+  void write(const string &id,const BaseProbability<_base_type,_prbprec> *p,size_t length) {
+
+    if(binarymode) {
+      write_binary(id,p,length);
+      return;
+    }
+
+    fast4_handle.put('@');
+    fast4_handle.append(id);
+    fast4_handle.put('\n');
+
+    for(size_t n=0;n<ProbabilitySequence<_basetype,_prbprec>::base_count;n++) {
+      if(textmode) {
+        for(size_t i=0;i<length;i++) {
+          _prbprec c = p[i][n];
+          if(c == -0) c=0;
+          fast4_handle.append_fixed4(c);
+          fast4_handle.put(' ');
+        }
+      } else {
+        char *q = fast4_handle.reserve(length);
+        for(size_t i=0;i<length;i++) q[i] = ascii_quality(p[i][n]);
+        fast4_handle.commit(length);
+      }
+      fast4_handle.put('\n');
+    }
   }
 
   void open() {
-    fast4_handle.open(filename.c_str());
+    fast4_handle.open(filename,compression);
 
-    fast4_handle << get_fast4_header();
+    m_header_written = false;
+    if(!binarymode) fast4_handle.append(get_fast4_header());
   }
 
   void close() {
+    if(binarymode && !m_header_written && fast4_handle.is_open()) write_binary_header("",0);
     fast4_handle.close();
   }
+
+private:
+
+  /// Binary records hold x and y, the rest of the id is in the header. Ids are expected to be prefix:x:y
+  /// with the same prefix and read length throughout a file, as swift writes them.
+  template<class _base_type>
+  void write_binary(const string &id,const BaseProbability<_base_type,_prbprec> *p,size_t length) {
+    size_t x_start = id.rfind(':');
+    x_start = ((x_start == string::npos) || (x_start == 0)) ? string::npos : id.rfind(':',x_start-1);
+    x_start = (x_start == string::npos) ? 0 : x_start+1;
+
+    if(!m_header_written) write_binary_header(id.substr(0,x_start),length);
+    else if((length != m_cycles) || (id.compare(0,x_start,m_prefix) != 0)) {
+      cerr << "Fast4Writer: " << id << " doesn't match the binary header of " << filename << " (" << m_prefix << ", " << m_cycles << " cycles)" << endl;
+    }
+
+    const char *xy = id.c_str()+x_start;
+    char *end;
+    long x = strtol(xy,&end,10);
+    long y = (*end == ':') ? strtol(end+1,0,10) : 0;
+
+    size_t bases = ProbabilitySequence<_basetype,_prbprec>::base_count;
+    char *r = fast4_handle.reserve(8+(bases*m_cycles));
+    fast4_put_le32(r  ,static_cast<uint32_t>(x));
+    fast4_put_le32(r+4,static_cast<uint32_t>(y));
+
+    size_t cycles = (length < m_cycles) ? length : m_cycles;
+    for(size_t n=0;n<bases;n++) {
+      unsigned char *plane = reinterpret_cast<unsigned char *>(r+8+(n*m_cycles));
+      for(size_t i=0;i<cycles;i++) plane[i] = fast4_binary_quantise(p[i][n]);
+      for(size_t i=cycles;i<m_cycles;i++) plane[i] = 0;
+    }
+    fast4_handle.commit(8+(bases*m_cycles));
+  }
+
+  void write_binary_header(const string &prefix,size_t cycles) {
+    size_t bases = ProbabilitySequence<_basetype,_prbprec>::base_count;
+    size_t header_size = ((fast4_binary_fixed_header+prefix.size()+7)/8)*8;
+
+    char *h = fast4_handle.reserve(header_size);
+    memset(h,0,header_size);
+    memcpy(h,fast4_binary_magic,sizeof(fast4_binary_magic));
+    fast4_put_le32(h+8 ,fast4_binary_version);
+    fast4_put_le32(h+12,header_size);
+    fast4_put_le32(h+16,cycles);
+    fast4_put_le32(h+20,bases);
+    fast4_put_le32(h+24,8+(bases*cycles));
+    fast4_put_le32(h+28,fast4_binary_scale);
+    for(size_t n=0;(n<bases) && (n<4);n++) h[32+n] = ProbabilitySequence<_basetype,_prbprec>::base_name[n][0];
+    fast4_put_le32(h+36,prefix.size());
+    memcpy(h+fast4_binary_fixed_header,prefix.data(),prefix.size());
+    fast4_handle.commit(header_size);
+
+    m_header_written = true;
+    m_cycles = cycles;
+    m_prefix = prefix;
+  }
+
+  inline char ascii_quality(_prbprec p) const {
+    int c = static_cast<int>(10*(log10(p/(1-p))));
+    if(c>= 50) c= 50;
+    if(c<=-40) c=-40;
+
+    c += quality_conversion;
+
+    return static_cast<char>(c);
+  }
+
+  bool   m_header_written;   ///< Binary mode, the header is written with the first record
+  size_t m_cycles;           ///< Binary mode, read length given in the header
+  string m_prefix;           ///< Binary mode, id prefix given in the header
 };
 
 #endif
@@ -19,28 +19,36 @@
 */
 
 #ifndef SWIFT_FASTQWRITER_H
-#define SEIFT_FASTQWRITER_H
+#define SWIFT_FASTQWRITER_H
 
 #include <vector>
 #include <string>
 #include <iostream>
-#include <fstream>
+#include "OutputBuffer.h"
 #include "ProbabilitySequence.h"
 
 using namespace std;
 
+/// Writes FASTQ. Each record is formatted straight into an OutputBuffer: the base call and quality for a
+/// position come from one pass over its probabilities, with no intermediate strings or vectors.
 class FastqWriter {
 public:
 
   string filename;
-  ofstream fastq_handle;
+  OutputBuffer fastq_handle;
   int quality_conversion; // This value is subtracted for the ascii character value to obtain the quality score.
   bool textmode;
+  BgzfPool *compression; ///< Write BGZF using these threads, 0 for plain text
 
-  FastqWriter(string filename_in) : filename(filename_in), textmode(false) {
+  FastqWriter(string filename_in) : filename(filename_in), textmode(false), compression(0) {
     quality_conversion = 33;
   }
 
+  /// Write the file as BGZF (gzip compatible), compressed by the pool's threads. Call before open.
+  void set_compressed(BgzfPool *pool) {
+    compression = pool;
+  }
+
   void set_textmode() {
     textmode = true;
   }
@@ -53,10 +61,7 @@ public:
   string quality_int_to_ascii(const vector<_prec> qual_in) {
     string s;
     for(typename vector<_prec>::const_iterator i = qual_in.begin();i != qual_in.end();i++) {
-      unsigned int q = static_cast<char>((*i)+quality_conversion+0.5);
-      if(q > 126) q = 126;
-      if(q < 33)  q = 33;
-      s.push_back(static_cast<char>(q));
+      s.push_back(quality_to_ascii(*i));
     }
 
     return s;
@@ -64,28 +69,73 @@ public:
 
   template<class _prec>
   void write(const ProbabilitySequence<_prec> &s) {
-    fastq_handle << "@" << s.get_id() << endl;
-    fastq_handle << s.get_sequence_string() << endl;
-
-    fastq_handle << "+" << s.get_id() << endl;
-    if(!textmode) fastq_handle << quality_int_to_ascii(s.phred_quality()) << endl;
-    else {
-      for(typename vector<int>::const_iterator i = s.phred_quality().begin();i != s.phred_quality().end();i++) {
-        fastq_handle << *i << " ";
+    write(s.get_id(),s.const_sequence().data(),s.size());
+  }
+
+  /// Writes a record for length base probabilities starting at p, which needn't be a whole ProbabilitySequence
+  template<class _base_type,class _prec>
+  void write(const string &id,const BaseProbability<_base_type,_prec> *p,size_t length) {
+    static const char base_chars[] = "ACGT"; // as ProbabilitySequence::base_name
+
+    fastq_handle.put('@');
+    fastq_handle.append(id);
+    fastq_handle.put('\n');
+
+    // Bases are written as they are called, the qualities are kept for the second line
+    m_quality.resize(length);
+    char *bases = fastq_handle.reserve(length);
+    for(size_t n=0;n<length;n++) {
+      // as get_sequence_string and phred_quality
+      _prec max=0;
+      size_t max_idx=0;
+      for(size_t b=0;b<BaseProbability<_base_type,_prec>::base_count;b++) {
+        if(p[n][b] > max) {
+          max = p[n][b];
+          max_idx = b;
+        }
       }
-      fastq_handle << endl;
+      bases[n] = base_chars[max_idx];
+      m_quality[n] = static_cast<int>((30*max)+1+0.5);
     }
+    fastq_handle.commit(length);
+    fastq_handle.put('\n');
+
+    fastq_handle.put('+');
+    fastq_handle.append(id);
+    fastq_handle.put('\n');
+
+    if(!textmode) {
+      char *q = fastq_handle.reserve(length);
+      for(size_t n=0;n<length;n++) q[n] = quality_to_ascii(m_quality[n]);
+      fastq_handle.commit(length);
+    } else {
+      for(size_t n=0;n<length;n++) {
+        fastq_handle.append_int(m_quality[n]);
+        fastq_handle.put(' ');
+      }
+    }
+    fastq_handle.put('\n');
   }
 
   void open() {
-    fastq_handle.open(filename.c_str());
+    fastq_handle.open(filename,compression);
   }
 
   void close() {
     fastq_handle.close();
   }
 
+private:
+
+  template<class _prec>
+  inline char quality_to_ascii(_prec quality) const {
+    unsigned int q = static_cast<char>(quality+quality_conversion+0.5);
+    if(q > 126) q = 126;
+    if(q < 33)  q = 33;
+    return static_cast<char>(q);
+  }
 
+  vector<int> m_quality; ///< Qualities of the record being written
 };
 
 #endif
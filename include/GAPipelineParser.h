@@ -0,0 +1,258 @@
+/*
+    Swift (c) 2008 Genome Research Ltd.
+    Authors: Nava Whiteford and Tom Skelly (new@sgenomics.org ts6@sanger.ac.uk)
+
+    This file is part of Swift (http://swiftng.sourceforge.net).
+
+    Swift is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Swift is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with Swift.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SWIFT_GAPIPELINEPARSER_H
+#define SWIFT_GAPIPELINEPARSER_H
+
+#include <vector>
+#include <string>
+#include <cstring>
+#include <cstdlib>
+#include <stdint.h>
+#include "MappedFile.h"
+
+using namespace std;
+
+/// The whitespace separated fields of one GAPipeline intensity line: lane, tile, x, y, then four
+/// intensities per cycle. Numbers are parsed in place, without copying or allocating, and give the
+/// values operator>> would.
+class GAPipelineLine {
+public:
+
+  GAPipelineLine(const char *begin,const char *end) : m_p(begin), m_end(end) {
+  }
+
+  /// The next field as an int (as operator>> into an int, anything after the digits is ignored)
+  bool next_int(int &v) {
+    const char *token,*token_end;
+    if(!next_token(token,token_end)) return false;
+
+    bool negative = (*token == '-');
+    if((*token == '-') || (*token == '+')) token++;
+
+    long n=0;
+    for(;(token < token_end) && (*token >= '0') && (*token <= '9');token++) n = (n*10)+(*token-'0');
+    v = static_cast<int>(negative ? -n : n);
+    return true;
+  }
+
+  /// The next field as a double, correctly rounded as strtod (and so operator>>) gives it
+  bool next_double(double &v) {
+    const char *token,*token_end;
+    if(!next_token(token,token_end)) return false;
+
+    if(!fast_double(token,token_end,v)) {
+      char buffer[64];
+      size_t length = token_end-token;
+      if(length < sizeof(buffer)) {
+        memcpy(buffer,token,length);
+        buffer[length] = 0;
+        v = strtod(buffer,0);
+      } else {
+        v = strtod(string(token,length).c_str(),0);
+      }
+    }
+    return true;
+  }
+
+  /// Reads the four values of the next cycle, false if there isn't a complete group of four left
+  bool next_cycle(double *v) {
+    for(int n=0;n<4;n++) if(!next_double(v[n])) return false;
+    return true;
+  }
+
+private:
+
+  static inline bool is_space(char c) {
+    return (c == ' ') || (c == '\t') || (c == '\r') || (c == '\v') || (c == '\f') || (c == '\n');
+  }
+
+  bool next_token(const char *&token,const char *&token_end) {
+    while((m_p < m_end) && is_space(*m_p)) m_p++;
+    if(m_p == m_end) return false;
+
+    token = m_p;
+    while((m_p < m_end) && !is_space(*m_p)) m_p++;
+    token_end = m_p;
+    return true;
+  }
+
+  /// Plain decimals of up to 15 significant digits with small exponents. The digits are exact in a
+  /// double as is the power of ten, so one multiply or divide gives the correctly rounded value.
+  static bool fast_double(const char *p,const char *end,double &v) {
+    static const double powers[] = {1e0,1e1,1e2,1e3,1e4,1e5,1e6,1e7,1e8,1e9,1e10,1e11,
+                                    1e12,1e13,1e14,1e15,1e16,1e17,1e18,1e19,1e20,1e21,1e22};
+
+    bool negative = (*p == '-');
+    if((*p == '-') || (*p == '+')) p++;
+
+    uint64_t mantissa=0;
+    int digits=0;
+    int exponent=0;
+    bool any=false;
+
+    for(;(p < end) && (*p >= '0') && (*p <= '9');p++) {
+      any = true;
+      if((mantissa == 0) && (*p == '0')) continue;
+      mantissa = (mantissa*10)+(*p-'0');
+      if(++digits > 15) return false;
+    }
+    if((p < end) && (*p == '.')) {
+      p++;
+      for(;(p < end) && (*p >= '0') && (*p <= '9');p++) {
+        any = true;
+        exponent--;
+        if((mantissa == 0) && (*p == '0')) continue;
+        mantissa = (mantissa*10)+(*p-'0');
+        if(++digits > 15) return false;
+      }
+    }
+    if(!any || (p != end)) return false; // exponents, inf, nan and anything odd go to strtod
+
+    if(exponent < -22) return false;
+    double d = static_cast<double>(mantissa);
+    d = (exponent < 0) ? d/powers[-exponent] : d;
+    v = negative ? -d : d;
+    return true;
+  }
+
+  const char *m_p;
+  const char *m_end;
+};
+
+/// A GAPipeline _int.txt file, mapped and indexed by line. Lines can be read one at a time, or a whole
+/// file parsed in parallel into a ClusterTable. Only lines ending in a newline are read, as getline
+/// loops checking eof() do.
+class GAPipelineParser {
+public:
+
+  GAPipelineParser(string filename_in) : filename(filename_in) {
+  }
+
+  bool open() {
+    m_lines.clear();
+    if(!m_file.open(filename)) return false;
+    m_file.sequential();
+
+    const char *p   = m_file.data();
+    const char *end = p+m_file.size();
+    while(p < end) {
+      const char *newline = static_cast<const char *>(memchr(p,'\n',end-p));
+      if(newline == 0) break;
+      m_lines.push_back(p-m_file.data());
+      p = newline+1;
+    }
+    m_lines.push_back(p-m_file.data()); // end of the last complete line, plus one
+
+    return true;
+  }
+
+  void close() {
+    m_file.close();
+    m_lines.clear();
+  }
+
+  /// Number of lines (clusters)
+  size_t size() const {
+    return m_lines.empty() ? 0 : m_lines.size()-1;
+  }
+
+  /// Fields of a line, without its newline
+  GAPipelineLine line(size_t n) const {
+    return GAPipelineLine(m_file.data()+m_lines[n],m_file.data()+m_lines[n+1]-1);
+  }
+
+  /// Number of complete cycles on a line
+  size_t cycles(size_t n) const {
+    GAPipelineLine l = line(n);
+    int header;
+    for(int f=0;f<4;f++) l.next_int(header);
+    double v[4];
+    size_t count=0;
+    while(l.next_cycle(v)) count++;
+    return count;
+  }
+
+  /// Parses every line into a table (a ClusterTable) in parallel, sized by the first line. Values of exactly
+  /// zero are flagged off edge, as Cluster::read_gapipelinestr does. Shorter lines are padded with zeros
+  /// flagged off edge, cycles beyond the first line's are ignored.
+  template<class _table>
+  void read(_table &table,const string &identifier) const {
+    read(table,identifier,0,size());
+  }
+
+  /// Parses count lines from first into a table, for reading a file a chunk at a time. The table is sized by
+  /// the first line of the file, so every chunk has the same cycles.
+  template<class _table>
+  void read(_table &table,const string &identifier,size_t first,size_t count) const {
+    typedef typename _table::position_type position_type;
+    typedef typename _table::offedge_type  offedge_type;
+
+    if(first > size())       first = size();
+    if(count > size()-first) count = size()-first;
+    size_t cycles = (size() > 0) ? this->cycles(0) : 0;
+
+    table.resize(count,cycles);
+    table.add_signal(identifier);
+
+    typename _table::value_type *data = table.data(identifier);
+    offedge_type *offedge = table.offedge_data(identifier);
+    const size_t base_count = _table::base_count;
+
+    int line_count = count;
+    #if defined(_OPENMP)
+      #pragma omp parallel for schedule(static)
+    #endif
+    for(int n=0;n<line_count;n++) {
+      GAPipelineLine l = line(first+n);
+
+      int lane,tile,x=0,y=0;
+      l.next_int(lane);
+      l.next_int(tile);
+      l.next_int(x);
+      l.next_int(y);
+      table.set_position(n,position_type(x,y));
+
+      double v[4];
+      for(size_t cycle=0;cycle<cycles;cycle++) {
+        typename _table::value_type *out = data+table.offset(cycle,n);
+        offedge_type mask=0;
+        if(l.next_cycle(v)) {
+          for(size_t b=0;b<base_count;b++) {
+            out[b] = v[b];
+            if(v[b] == 0.0) mask |= (1 << b);
+          }
+        } else {
+          for(size_t b=0;b<base_count;b++) out[b] = 0;
+          mask = (1 << base_count)-1;
+        }
+        offedge[(cycle*count)+n] = mask;
+      }
+    }
+  }
+
+  string filename;
+
+private:
+  MappedFile     m_file;
+  vector<size_t> m_lines;    ///< Offset of the start of each line, and one past the last line's newline
+};
+
+#endif
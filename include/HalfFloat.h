@@ -0,0 +1,98 @@
+/*
+    Swift (c) 2008 Genome Research Ltd.
+    Authors: Nava Whiteford and Tom Skelly (new@sgenomics.org ts6@sanger.ac.uk)
+
+    This file is part of Swift (http://swiftng.sourceforge.net).
+
+    Swift is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Swift is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with Swift.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SWIFT_HALFFLOAT_H
+#define SWIFT_HALFFLOAT_H
+
+#include <stdint.h>
+#include <string.h>
+
+/// 16 bit float conversions, used to archive intensities which are only kept for output.
+/// Both formats round to nearest, ties to even. No hardware support is assumed.
+
+inline uint32_t float_bits(float f) {
+  uint32_t u;
+  memcpy(&u,&f,sizeof(u));
+  return u;
+}
+
+inline float bits_float(uint32_t u) {
+  float f;
+  memcpy(&f,&u,sizeof(f));
+  return f;
+}
+
+/// float to bfloat16 (the top 16 bits of a float)
+inline uint16_t float_to_bf16(float f) {
+  uint32_t u = float_bits(f);
+
+  if((u & 0x7FFFFFFF) > 0x7F800000) return (uint16_t) ((u >> 16) | 0x0040); // NaN, keep it quiet
+
+  u += 0x7FFF + ((u >> 16) & 1);
+  return (uint16_t) (u >> 16);
+}
+
+inline float bf16_to_float(uint16_t h) {
+  return bits_float(((uint32_t) h) << 16);
+}
+
+/// float to IEEE 754 binary16, values beyond 65504 become infinity
+inline uint16_t float_to_fp16(float f) {
+  uint32_t u    = float_bits(f);
+  uint16_t sign = (uint16_t) ((u >> 16) & 0x8000);
+  uint32_t absu = u & 0x7FFFFFFF;
+
+  if(absu >= 0x7F800000) {                                   // Inf or NaN
+    return sign | 0x7C00 | ((absu > 0x7F800000) ? 0x0200 : 0);
+  }
+
+  if(absu >= 0x477FF000) return sign | 0x7C00;               // rounds above 65504
+
+  if(absu < 0x38800000) {                                    // fp16 subnormal or zero
+    if(absu < 0x33000000) return sign;                       // below half the smallest subnormal
+    uint32_t mant  = (absu & 0x007FFFFF) | 0x00800000;
+    int      shift = 126 - (int) (absu >> 23);               // 14 - (e - 112), plus 13
+    uint32_t r     = mant >> shift;
+    uint32_t rem   = mant & ((1u << shift) - 1);
+    uint32_t half  = 1u << (shift - 1);
+    if((rem > half) || ((rem == half) && (r & 1))) r++;
+    return sign | (uint16_t) r;
+  }
+
+  absu -= 0x38000000;                                        // rebias exponent 127 -> 15
+  absu += 0x0FFF + ((absu >> 13) & 1);
+  return sign | (uint16_t) (absu >> 13);
+}
+
+inline float fp16_to_float(uint16_t h) {
+  uint32_t sign = ((uint32_t) (h & 0x8000)) << 16;
+  uint32_t exp  = (h >> 10) & 0x1F;
+  uint32_t mant = h & 0x03FF;
+
+  if(exp == 0x1F) return bits_float(sign | 0x7F800000 | (mant << 13));
+  if(exp == 0) {
+    float v = ((float) mant) * (1.0f/16777216.0f);           // mant * 2^-24
+    return (sign != 0) ? -v : v;
+  }
+
+  return bits_float(sign | ((exp + 112) << 23) | (mant << 13));
+}
+
+#endif
@@ -0,0 +1,463 @@
+/*
+    Swift (c) 2008 Genome Research Ltd.
+    Authors: Nava Whiteford and Tom Skelly (new@sgenomics.org ts6@sanger.ac.uk)
+
+    This file is part of Swift (http://swiftng.sourceforge.net).
+
+    Swift is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Swift is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with Swift.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SWIFT_INTENSITYFILE_H
+#define SWIFT_INTENSITYFILE_H
+
+#include <vector>
+#include <string>
+#include <cstring>
+#include <cstdint>
+#include "Cluster.h"
+#include "ClusterPosition.h"
+#include "ClusterTable.h"
+#include "ReadIntensity.h"
+#include "SignalId.h"
+#include "OutputBuffer.h"
+#include "MappedFile.h"
+
+using namespace std;
+
+/// Binary intensity file, one signal of a tile. Written sequentially, read back through mmap.
+///
+/// Layout, in the byte order of the machine which wrote it (checked on reading), sections 64 byte aligned:
+///   header    64 bytes, see below
+///   positions x for every cluster then y for every cluster, int32
+///   planes    values (float32 unless written at 16 bits), cycle major as ClusterTable holds them: [cycle][cluster][base]
+///   offedge   one off edge mask per cycle per cluster, [cycle][cluster]
+///
+/// Header:
+///   0  "SWIFTINT"           8  version (1)           12 byte order mark 0x01020304
+///   16 clusters (64 bit)    24 cycles                28 bases (4)
+///   32 value encoding       36 bytes per position (4)
+///   40 positions offset     48 planes offset         56 offedge offset      (64 bit)
+///
+/// The value encoding holds the bytes per value in its low 16 bits: 4 for float32, 2 for IEEE half and 0x10002
+/// for bfloat16 (ClusterTable's storage types). Float32 values are exact, unlike the GAPipeline text format which
+/// rounds them to 6 decimal places; the 16 bit encodings halve the planes. Every encoding is read back to _prec.
+/// The writers return false unless the whole file was written (it opened, and no write or the close failed).
+template<class _prec=float,class _position_prec=int>
+class IntensityFile {
+public:
+  typedef Cluster<_prec,_position_prec>          cluster_type;
+  typedef ReadIntensity<_prec>                   intensities_type;
+  typedef ClusterTable<_prec,_position_prec>     table_type;
+  typedef typename table_type::storage_type      storage_type;
+
+  static const int base_count = ReadIntensity<_prec>::base_count;
+
+  /// True if the file starts with the binary intensity file magic (otherwise it's taken to be GAPipeline text)
+  static bool is_intensity_file(const string &filename) {
+    char magic[8];
+    ifstream in(filename.c_str(),ios::binary);
+    if(!in.read(magic,sizeof(magic))) return false;
+    return memcmp(magic,file_magic(),sizeof(magic)) == 0;
+  }
+
+  /// Writes signalid of every cluster, at the given storage precision. Signals shorter than the longest are
+  /// zero padded and marked off edge.
+  static bool write(const string &filename,const vector<cluster_type> &clusters,const SignalId &signalid,storage_type storage=table_type::storage_native) {
+
+    uint64_t count  = clusters.size();
+    uint32_t cycles = 0;
+    for(size_t n=0;n<clusters.size();n++) {
+      if(clusters[n].const_signal(signalid).size() > cycles) cycles = clusters[n].const_signal(signalid).size();
+    }
+
+    OutputBuffer out;
+    sections s;
+    if(!begin_write(out,filename,count,cycles,storage,s)) return false;
+
+    for(size_t n=0;n<clusters.size();n++) put_value<int32_t>(out,clusters[n].get_position().x);
+    for(size_t n=0;n<clusters.size();n++) put_value<int32_t>(out,clusters[n].get_position().y);
+    pad(out,s.planes_offset-(s.positions_offset+(count*2*sizeof(int32_t))));
+
+    for(size_t cycle=0;cycle<cycles;cycle++) {
+      for(size_t n=0;n<clusters.size();n++) {
+        const typename cluster_type::signal_vec_type &sig = clusters[n].const_signal(signalid);
+        char *p = out.reserve(base_count*s.value_size);
+        for(int b=0;b<base_count;b++) {
+          store_value(p+(b*s.value_size),(cycle < sig.size()) ? sig[cycle].get_base(b) : 0,storage);
+        }
+        out.commit(base_count*s.value_size);
+      }
+    }
+    pad(out,s.offedge_offset-(s.planes_offset+(count*cycles*base_count*s.value_size)));
+
+    for(size_t cycle=0;cycle<cycles;cycle++) {
+      char *p = out.reserve(clusters.size());
+      for(size_t n=0;n<clusters.size();n++) {
+        bool present = cycle < clusters[n].const_signal(signalid).size();
+        p[n] = present ? clusters[n].offedge_mask(signalid,cycle) : intensities_type::offedge_all;
+      }
+      out.commit(clusters.size());
+    }
+
+    out.close();
+    return out.good();
+  }
+
+  /// Writes a signal of a table, which is already laid out as the file is. The file takes the signal's storage
+  /// precision, an archived signal (see ClusterTable::archive_signal) is written as it's held.
+  static bool write(const string &filename,table_type &table,const string &signalid) {
+
+    uint64_t     count   = table.size();
+    uint32_t     cycles  = table.cycle_count();
+    storage_type storage = table.get_storage(signalid);
+
+    OutputBuffer out;
+    sections s;
+    if(!begin_write(out,filename,count,cycles,storage,s)) return false;
+
+    for(size_t n=0;n<count;n++) put_value<int32_t>(out,table.get_position(n).x);
+    for(size_t n=0;n<count;n++) put_value<int32_t>(out,table.get_position(n).y);
+    pad(out,s.planes_offset-(s.positions_offset+(count*2*sizeof(int32_t))));
+
+    if(storage == table_type::storage_native) {
+      const _prec *v = table.data(signalid);
+      for(size_t n=0;n<count*cycles*base_count;n++) put_value<float>(out,v[n]);
+    } else {
+      out.append(reinterpret_cast<const char *>(table.const_archive_data(signalid)),count*cycles*base_count*s.value_size);
+    }
+    pad(out,s.offedge_offset-(s.planes_offset+(count*cycles*base_count*s.value_size)));
+
+    out.append(reinterpret_cast<const char *>(table.offedge_data(signalid)),count*cycles);
+
+    out.close();
+    return out.good();
+  }
+
+  /// Replaces clusters with those in the file, the intensities going to signalid. Returns false, leaving
+  /// clusters empty, if the file can't be read or isn't a binary intensity file written on this architecture.
+  static bool read(const string &filename,vector<cluster_type> &clusters,const SignalId &signalid) {
+    clusters.clear();
+
+    MappedFile mapped;
+    sections s;
+    if(!open_read(mapped,filename,s)) return false;
+    mapped.sequential();
+
+    clusters.resize(s.count);
+    for(size_t n=0;n<s.count;n++) {
+      clusters[n].set_position(position(s,n));
+      append_cycles(s,n,clusters[n],signalid);
+    }
+
+    return true;
+  }
+
+  /// Reads the clusters at these indices (in file order, any order of indices) into clusters, one per index.
+  /// The file's cycles are appended to signalid, so files holding consecutive cycles of the same clusters can
+  /// be read one after another. Positions are set from the file.
+  static bool read(const string &filename,const vector<size_t> &indices,vector<cluster_type> &clusters,const SignalId &signalid) {
+
+    MappedFile mapped;
+    sections s;
+    if(!open_read(mapped,filename,s)) return false;
+
+    if(clusters.size() != indices.size()) {
+      clusters.clear();
+      clusters.resize(indices.size());
+    }
+
+    for(size_t n=0;n<indices.size();n++) {
+      if(indices[n] >= s.count) return false;
+      clusters[n].set_position(position(s,indices[n]));
+      append_cycles(s,indices[n],clusters[n],signalid);
+    }
+
+    return true;
+  }
+
+  /// As above into a table, one row per index. Unless the table already has signalid for this many rows it's
+  /// rebuilt with just that signal, otherwise the file's cycles are appended to it. Each cycle of the file is
+  /// gathered straight into the table's cycle, both being laid out [cycle][cluster][base].
+  static bool read(const string &filename,const vector<size_t> &indices,table_type &table,const string &signalid) {
+
+    MappedFile mapped;
+    sections s;
+    if(!open_read(mapped,filename,s)) return false;
+
+    for(size_t n=0;n<indices.size();n++) if(indices[n] >= s.count) return false;
+
+    if((table.size() != indices.size()) || !table.has_signal(signalid)) {
+      table.resize(indices.size(),0);
+      table.add_signal(signalid);
+    }
+    size_t first = table.cycle_count();
+    table.append_cycles(s.cycles);
+
+    for(size_t n=0;n<indices.size();n++) table.set_position(n,position(s,indices[n]));
+
+    const size_t intensity_size = base_count*s.value_size;
+    for(size_t cycle=0;cycle<s.cycles;cycle++) {
+      const char *plane   = s.planes +(cycle*s.count*intensity_size);
+      const char *offedge = s.offedge+(cycle*s.count);
+
+      typename table_type::CycleView view = table.cycle(signalid,first+cycle);
+      typename table_type::offedge_type *mask = table.offedge_data(signalid)+((first+cycle)*indices.size());
+      for(size_t n=0;n<indices.size();n++) {
+        const char *v = plane+(indices[n]*intensity_size);
+        for(int b=0;b<base_count;b++) view[n][b] = load_value(v+(b*s.value_size),s.storage);
+        mask[n] = offedge[indices[n]];
+      }
+    }
+
+    return true;
+  }
+
+  /// Number of clusters and cycles in a file, false if it isn't a readable intensity file
+  static bool dimensions(const string &filename,size_t &count,size_t &cycles) {
+    MappedFile mapped;
+    sections s;
+    if(!open_read(mapped,filename,s)) return false;
+
+    count  = s.count;
+    cycles = s.cycles;
+    return true;
+  }
+
+  /// Positions of every cluster, in file order. Only the positions section is read.
+  static bool read_positions(const string &filename,vector<ClusterPosition<_position_prec> > &positions) {
+    positions.clear();
+
+    MappedFile mapped;
+    sections s;
+    if(!open_read(mapped,filename,s)) return false;
+
+    positions.reserve(s.count);
+    for(size_t n=0;n<s.count;n++) positions.push_back(position(s,n));
+    return true;
+  }
+
+  /// Joins files holding the same cycles of different clusters into one, the clusters of each file
+  /// following those of the file before. Every section is copied in order, nothing is held in memory.
+  /// The files must share a value encoding, which the joined file keeps.
+  static bool concatenate(const string &filename,const vector<string> &parts) {
+
+    vector<MappedFile *> mapped(parts.size(),static_cast<MappedFile *>(0));
+    vector<sections>     s(parts.size());
+
+    bool ok=true;
+    uint64_t count=0;
+    for(size_t p=0;(p<parts.size()) && ok;p++) {
+      mapped[p] = new MappedFile;
+      ok = open_read(*mapped[p],parts[p],s[p]) && (s[p].cycles == s[0].cycles) && (s[p].storage == s[0].storage);
+      count += s[p].count;
+    }
+
+    OutputBuffer out;
+    sections o;
+    uint32_t     cycles  = parts.empty() ? 0 : s[0].cycles;
+    storage_type storage = parts.empty() ? table_type::storage_native : s[0].storage;
+    if(ok) ok = begin_write(out,filename,count,cycles,storage,o);
+
+    if(ok) {
+      for(size_t p=0;p<parts.size();p++) out.append(s[p].x,s[p].count*sizeof(int32_t));
+      for(size_t p=0;p<parts.size();p++) out.append(s[p].y,s[p].count*sizeof(int32_t));
+      pad(out,o.planes_offset-(o.positions_offset+(count*2*sizeof(int32_t))));
+
+      const size_t intensity_size = base_count*o.value_size;
+      for(size_t cycle=0;cycle<cycles;cycle++) {
+        for(size_t p=0;p<parts.size();p++) out.append(s[p].planes+(cycle*s[p].count*intensity_size),s[p].count*intensity_size);
+      }
+      pad(out,o.offedge_offset-(o.planes_offset+(count*cycles*intensity_size)));
+
+      for(size_t cycle=0;cycle<cycles;cycle++) {
+        for(size_t p=0;p<parts.size();p++) out.append(s[p].offedge+(cycle*s[p].count),s[p].count);
+      }
+      out.close();
+      ok = out.good();
+    }
+
+    for(size_t p=0;p<mapped.size();p++) delete mapped[p];
+    return ok;
+  }
+
+private:
+  static const size_t   header_size     = 64;
+  static const uint32_t file_version    = 1;
+  static const uint32_t byte_order_mark = 0x01020304;
+
+  static const char *file_magic() {
+    return "SWIFTINT";
+  }
+
+  /// Where the sections of a file are, pointers are into its mapping
+  struct sections {
+    uint64_t     count;
+    uint32_t     cycles;
+    storage_type storage;    ///< Value encoding
+    size_t       value_size; ///< Bytes per value
+    uint64_t    positions_offset;
+    uint64_t    planes_offset;
+    uint64_t    offedge_offset;
+    const char *x;
+    const char *y;
+    const char *planes;
+    const char *offedge;
+  };
+
+  /// Maps a file and checks its header, and that its sections fit
+  static bool open_read(MappedFile &mapped,const string &filename,sections &s) {
+    if(!mapped.open(filename) || (mapped.size() < header_size)) return false;
+
+    size_t size = mapped.size();
+    const char *data = mapped.data();
+
+    s.count            = load<uint64_t>(data+16);
+    s.cycles           = load<uint32_t>(data+24);
+    bool known         = storage_of(load<uint32_t>(data+32),s.storage);
+    s.value_size       = value_size(s.storage);
+    s.positions_offset = load<uint64_t>(data+40);
+    s.planes_offset    = load<uint64_t>(data+48);
+    s.offedge_offset   = load<uint64_t>(data+56);
+
+    bool ok = (memcmp(data,file_magic(),8) == 0)                       &&
+              (load<uint32_t>(data+8)  == file_version)                 &&
+              (load<uint32_t>(data+12) == byte_order_mark)              &&
+              (load<uint32_t>(data+28) == static_cast<uint32_t>(base_count)) &&
+              known                                                     &&
+              (load<uint32_t>(data+36) == sizeof(int32_t))              &&
+              (s.positions_offset+(s.count*2*sizeof(int32_t))             <= size) &&
+              (s.planes_offset+(s.count*s.cycles*base_count*s.value_size) <= size) &&
+              (s.offedge_offset+(s.count*s.cycles)                         <= size);
+    if(!ok) return false;
+
+    s.x       = data+s.positions_offset;
+    s.y       = s.x+(s.count*sizeof(int32_t));
+    s.planes  = data+s.planes_offset;
+    s.offedge = data+s.offedge_offset;
+    return true;
+  }
+
+  /// Opens a file for writing and writes its header, sections are laid out for count clusters of cycles
+  static bool begin_write(OutputBuffer &out,const string &filename,uint64_t count,uint32_t cycles,storage_type storage,sections &s) {
+    s.count            = count;
+    s.cycles           = cycles;
+    s.storage          = storage;
+    s.value_size       = value_size(storage);
+    s.positions_offset = header_size;
+    s.planes_offset    = align(s.positions_offset+(count*2*sizeof(int32_t)));
+    s.offedge_offset   = align(s.planes_offset+(count*cycles*base_count*s.value_size));
+
+    out.open(filename);
+    if(!out.is_open()) return false;
+
+    char header[header_size];
+    memset(header,0,header_size);
+    memcpy(header,file_magic(),8);
+    store<uint32_t>(header+8 ,file_version);
+    store<uint32_t>(header+12,byte_order_mark);
+    store<uint64_t>(header+16,count);
+    store<uint32_t>(header+24,cycles);
+    store<uint32_t>(header+28,base_count);
+    store<uint32_t>(header+32,value_code(storage));
+    store<uint32_t>(header+36,sizeof(int32_t));
+    store<uint64_t>(header+40,s.positions_offset);
+    store<uint64_t>(header+48,s.planes_offset);
+    store<uint64_t>(header+56,s.offedge_offset);
+    out.append(header,header_size);
+    return true;
+  }
+
+  static ClusterPosition<_position_prec> position(const sections &s,size_t n) {
+    return ClusterPosition<_position_prec>(load<int32_t>(s.x+(n*sizeof(int32_t))),load<int32_t>(s.y+(n*sizeof(int32_t))));
+  }
+
+  /// Appends the cycles of cluster n to a cluster's signal
+  static void append_cycles(const sections &s,size_t n,cluster_type &c,const SignalId &signalid) {
+    c.add_signal(signalid);
+    typename cluster_type::signal_vec_type  &sig  = c.signal(signalid);
+    typename cluster_type::offedge_vec_type &mask = c.offedge(signalid);
+    size_t first = sig.size();
+    sig.resize(first+s.cycles);
+    mask.resize(first+s.cycles);
+
+    const size_t stride = s.count*base_count*s.value_size;
+    const char *v = s.planes+(n*base_count*s.value_size);
+    for(size_t cycle=0;cycle<s.cycles;cycle++,v+=stride) {
+      for(int b=0;b<base_count;b++) sig[first+cycle].bases[b] = load_value(v+(b*s.value_size),s.storage);
+      mask[first+cycle] = s.offedge[(cycle*s.count)+n];
+    }
+  }
+
+  static uint64_t align(uint64_t offset) {
+    return (offset+63) & ~static_cast<uint64_t>(63);
+  }
+
+  /// Header value encoding of a storage type, bytes per value in the low 16 bits
+  static uint32_t value_code(storage_type storage) {
+    if(storage == table_type::storage_fp16) return 2;
+    if(storage == table_type::storage_bf16) return 0x10002;
+    return sizeof(float);
+  }
+
+  /// The storage type of a header value encoding, false if it isn't one
+  static bool storage_of(uint32_t code,storage_type &storage) {
+    storage_type types[] = { table_type::storage_native, table_type::storage_fp16, table_type::storage_bf16 };
+    for(size_t n=0;n<sizeof(types)/sizeof(types[0]);n++) {
+      if(value_code(types[n]) == code) { storage = types[n]; return true; }
+    }
+    return false;
+  }
+
+  static size_t value_size(storage_type storage) {
+    return value_code(storage) & 0xFFFF;
+  }
+
+  static void store_value(char *p,_prec v,storage_type storage) {
+    if(storage == table_type::storage_fp16) store<uint16_t>(p,float_to_fp16(v)); else
+    if(storage == table_type::storage_bf16) store<uint16_t>(p,float_to_bf16(v)); else
+                                            store<float>   (p,static_cast<float>(v));
+  }
+
+  static _prec load_value(const char *p,storage_type storage) {
+    if(storage == table_type::storage_fp16) return fp16_to_float(load<uint16_t>(p));
+    if(storage == table_type::storage_bf16) return bf16_to_float(load<uint16_t>(p));
+    return load<float>(p);
+  }
+
+  template<class _type>
+  static void store(char *p,_type v) {
+    memcpy(p,&v,sizeof(_type));
+  }
+
+  template<class _type>
+  static _type load(const char *p) {
+    _type v;
+    memcpy(&v,p,sizeof(_type));
+    return v;
+  }
+
+  template<class _type,class _in>
+  static void put_value(OutputBuffer &out,_in v) {
+    _type t = static_cast<_type>(v);
+    out.append(reinterpret_cast<const char *>(&t),sizeof(_type));
+  }
+
+  static void pad(OutputBuffer &out,size_t n) {
+    char *p = out.reserve(n);
+    memset(p,0,n);
+    out.commit(n);
+  }
+};
+
+#endif
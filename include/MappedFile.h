@@ -0,0 +1,84 @@
+/*
+    Swift (c) 2008 Genome Research Ltd.
+    Authors: Nava Whiteford and Tom Skelly (new@sgenomics.org ts6@sanger.ac.uk)
+
+    This file is part of Swift (http://swiftng.sourceforge.net).
+
+    Swift is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Swift is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with Swift.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SWIFT_MAPPEDFILE_H
+#define SWIFT_MAPPEDFILE_H
+
+#include <string>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+/// A whole file mapped read only. Empty files open but have no data.
+class MappedFile {
+public:
+
+  MappedFile() : m_data(0), m_size(0) {
+  }
+
+  ~MappedFile() {
+    close();
+  }
+
+  bool open(const string &filename) {
+    close();
+
+    int fd = ::open(filename.c_str(),O_RDONLY);
+    if(fd < 0) return false;
+
+    struct stat st;
+    if(fstat(fd,&st) != 0) { ::close(fd); return false; }
+
+    m_size = st.st_size;
+    if(m_size > 0) {
+      void *p = mmap(0,m_size,PROT_READ,MAP_PRIVATE,fd,0);
+      if(p == MAP_FAILED) { ::close(fd); m_size = 0; return false; }
+      m_data = static_cast<const char *>(p);
+    }
+    ::close(fd);
+    return true;
+  }
+
+  void close() {
+    if(m_data != 0) munmap(const_cast<char *>(m_data),m_size);
+    m_data = 0;
+    m_size = 0;
+  }
+
+  /// Hint that the file will be read front to back
+  void sequential() const {
+    if(m_data != 0) madvise(const_cast<char *>(m_data),m_size,MADV_SEQUENTIAL);
+  }
+
+  const char *data() const { return m_data; }
+  size_t      size() const { return m_size; }
+
+private:
+  MappedFile(const MappedFile &);
+  MappedFile &operator=(const MappedFile &);
+
+  const char *m_data;
+  size_t      m_size;
+};
+
+#endif
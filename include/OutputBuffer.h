@@ -0,0 +1,176 @@
+/*
+    Swift (c) 2008 Genome Research Ltd.
+    Authors: Nava Whiteford and Tom Skelly (new@sgenomics.org ts6@sanger.ac.uk)
+
+    This file is part of Swift (http://swiftng.sourceforge.net).
+
+    Swift is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Swift is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with Swift.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SWIFT_OUTPUTBUFFER_H
+#define SWIFT_OUTPUTBUFFER_H
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include "Bgzf.h"
+
+using namespace std;
+
+/// Buffered file output for the sequence writers. Records are formatted straight into a large buffer,
+/// which is written out when it fills and on close. Nothing is flushed per line. Given a BgzfPool, the file is
+/// written as BGZF, blocks being deflated by the pool's threads while records are formatted.
+class OutputBuffer {
+public:
+
+  OutputBuffer(size_t capacity=1024*1024) : m_capacity(capacity), m_used(0), m_good(true), m_bgzf(0) {
+  }
+
+  ~OutputBuffer() {
+    close();
+  }
+
+  void open(const string &filename,BgzfPool *pool=0) {
+    m_handle.open(filename.c_str(),ios::out | ios::binary);
+    if(pool != 0) m_bgzf = new BgzfStream(m_handle,*pool);
+    m_buffer.resize(m_capacity);
+    m_used = 0;
+    m_good = m_handle.is_open();
+  }
+
+  bool is_open() const {
+    return m_handle.is_open();
+  }
+
+  /// False if the file didn't open, or anything written to it since (a flush, or the close) failed: a full disk, say
+  bool good() const {
+    return m_good;
+  }
+
+  /// Writes out the buffer and closes the file
+  void close() {
+    if(!m_handle.is_open()) return;
+    flush();
+    if(m_bgzf != 0) {
+      m_bgzf->close();
+      delete m_bgzf;
+      m_bgzf = 0;
+    }
+    m_handle.close();
+    if(m_handle.fail()) m_good = false;
+    vector<char>().swap(m_buffer);
+  }
+
+  /// Writes out the buffer
+  void flush() {
+    if(m_used > 0) {
+      if(m_bgzf != 0) m_bgzf->write(&m_buffer[0],m_used);
+                 else m_handle.write(&m_buffer[0],m_used);
+      if(m_handle.fail()) m_good = false;
+    }
+    m_used = 0;
+  }
+
+  /// Space for n more characters, returns where to write them. Call commit(n) once they are written.
+  inline char *reserve(size_t n) {
+    if(m_used+n > m_buffer.size()) {
+      flush();
+      if(n > m_buffer.size()) m_buffer.resize(n);
+    }
+    return &m_buffer[m_used];
+  }
+
+  inline void commit(size_t n) {
+    m_used += n;
+  }
+
+  inline void put(char c) {
+    *reserve(1) = c;
+    m_used++;
+  }
+
+  inline void append(const char *s,size_t n) {
+    memcpy(reserve(n),s,n);
+    m_used += n;
+  }
+
+  inline void append(const string &s) {
+    append(s.data(),s.size());
+  }
+
+  /// As ostream << v
+  void append_int(long v) {
+    char digits[24];
+    int  count=0;
+
+    unsigned long u = (v < 0) ? (0UL-static_cast<unsigned long>(v)) : static_cast<unsigned long>(v);
+    do { digits[count++] = static_cast<char>('0'+(u%10)); u /= 10; } while(u != 0);
+
+    char *p = reserve(count+1);
+    size_t n=0;
+    if(v < 0) p[n++] = '-';
+    while(count > 0) p[n++] = digits[--count];
+    commit(n);
+  }
+
+  /// As ostream << fixed << setprecision(4) << v. A float times 10000 is exact in a double, so rounding
+  /// that to an integer (ties to even, as printf does) gives the printed digits directly.
+  void append_fixed4(float v) {
+    double scaled = static_cast<double>(v)*10000.0;
+    if(!(fabs(scaled) < 1e15)) { append_printf4(v); return; }
+
+    unsigned long r = static_cast<unsigned long>(nearbyint(fabs(scaled)));
+    unsigned long whole = r/10000;
+    unsigned long frac  = r%10000;
+
+    if(signbit(v)) put('-');
+    append_int(static_cast<long>(whole));
+
+    char *p = reserve(5);
+    p[0] = '.';
+    p[1] = static_cast<char>('0'+(frac/1000));
+    p[2] = static_cast<char>('0'+((frac/100)%10));
+    p[3] = static_cast<char>('0'+((frac/10)%10));
+    p[4] = static_cast<char>('0'+(frac%10));
+    commit(5);
+  }
+
+  /// As ostream << fixed << setprecision(4) << v. Not exact when scaled, so printf does the rounding.
+  void append_fixed4(double v) {
+    append_printf4(v);
+  }
+
+private:
+  void append_printf4(double v) {
+    char s[64];
+    int n = snprintf(s,sizeof(s),"%.4f",v);
+    if(n >= static_cast<int>(sizeof(s))) n = sizeof(s)-1;
+    if(n > 0) append(s,n);
+  }
+
+  OutputBuffer(const OutputBuffer &);
+  OutputBuffer &operator=(const OutputBuffer &);
+
+  size_t       m_capacity;
+  vector<char> m_buffer;
+  size_t       m_used;    ///< Characters in m_buffer waiting to be written
+  bool         m_good;    ///< Cleared when opening or writing fails, see good()
+  ofstream     m_handle;
+  BgzfStream  *m_bgzf;    ///< Compresses into m_handle, 0 for plain text
+};
+
+#endif
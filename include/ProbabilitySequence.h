@@ -24,8 +24,11 @@
 
 #include <string>
 #include <vector>
+#include <sstream>
+#include <iomanip>
 #include <math.h>
 #include "BaseProbability.h"
+#include "Arena.h"
 
 
 using namespace std;
@@ -45,7 +48,7 @@ public:
   constexpr static const base_type base_t       = 3;    ///< Constant for base T
   constexpr const static size_t    base_count   = 4;    ///< Number of bases
   
-  typedef vector<BaseProbability<probability_type> > probability_sequence_type;
+  typedef vector<BaseProbability<probability_type>,ArenaAllocator<BaseProbability<probability_type> > > probability_sequence_type;
 
   static const std::string base_name[];  ///< string names for bases
   static const std::string base_descriptions[];  ///< string names for bases
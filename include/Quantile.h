@@ -0,0 +1,184 @@
+/*
+    Swift (c) 2008 Genome Research Ltd.
+    Authors: Nava Whiteford and Tom Skelly (new@sgenomics.org ts6@sanger.ac.uk)
+
+    This file is part of Swift (http://swiftng.sourceforge.net).
+
+    Swift is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Swift is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with Swift.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SWIFT_QUANTILE_H
+#define SWIFT_QUANTILE_H
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+// Exact selection. These return what sorting v and indexing it would, in linear time. v is reordered.
+
+/// The value which would be at position n if v were sorted
+template<class T>
+inline T select_nth(vector<T> &v,size_t n) {
+  nth_element(v.begin(),v.begin()+n,v.end());
+  return v[n];
+}
+
+/// Median, sorted[size/2] (the upper median for even sizes)
+template<class T>
+inline T select_median(vector<T> &v) {
+  return select_nth(v,v.size()/2);
+}
+
+/// Position of a percentile (0-100) in a sorted vector of this size
+inline size_t percentile_position(size_t size,double percentile) {
+  return static_cast<size_t>((percentile/100)*static_cast<double>(size));
+}
+
+/// Value at a percentile (0-100), sorted[(percentile/100)*size]
+template<class T>
+inline T select_percentile(vector<T> &v,double percentile) {
+  return select_nth(v,percentile_position(v.size(),percentile));
+}
+
+/// Two percentiles at once. The second selection only searches the side of the first which contains it.
+template<class T>
+inline void select_percentiles(vector<T> &v,double percentile_lower,double percentile_upper,T &lower,T &upper) {
+  size_t lower_pos = percentile_position(v.size(),percentile_lower);
+  size_t upper_pos = percentile_position(v.size(),percentile_upper);
+
+  lower = select_nth(v,lower_pos);
+
+  if(upper_pos > lower_pos) nth_element(v.begin()+lower_pos+1,v.begin()+upper_pos,v.end());
+  if(upper_pos < lower_pos) nth_element(v.begin(),v.begin()+upper_pos,v.begin()+lower_pos);
+  upper = v[upper_pos];
+}
+
+/// Approximate quantiles of a stream, in bounded memory (a KLL sketch).
+///
+/// Values are held in levels, a value on level h standing for 2^h inputs. When a level fills it is
+/// sorted and every other value is promoted to the next level. Lower levels get geometrically less
+/// space, so memory is O(k) and rank error is roughly 1.7/k of the count. Sketches built on separate
+/// threads or chunks can be merged. The half kept by each compaction is chosen by a fixed seed
+/// generator, so results are reproducible.
+template<class T>
+class QuantileSketch {
+public:
+
+  QuantileSketch(size_t k=200) : m_k((k < 8) ? 8 : k), m_count(0), m_state(0x9E3779B97F4A7C15ULL), m_levels(1) {
+  }
+
+  void insert(const T &value) {
+    m_levels[0].push_back(value);
+    m_count++;
+    if(m_levels[0].size() >= capacity(0)) compress();
+  }
+
+  /// Adds the values seen by another sketch. Both should use the same k.
+  void merge(const QuantileSketch<T> &other) {
+    if(other.m_levels.size() > m_levels.size()) m_levels.resize(other.m_levels.size());
+
+    for(size_t h=0;h<other.m_levels.size();h++) {
+      m_levels[h].insert(m_levels[h].end(),other.m_levels[h].begin(),other.m_levels[h].end());
+    }
+    m_count += other.m_count;
+
+    compress();
+  }
+
+  /// Number of values inserted (including those merged in)
+  size_t size() const {
+    return m_count;
+  }
+
+  /// Approximate value at quantile q (0-1). The sketch must not be empty.
+  T quantile(double q) const {
+    vector<pair<T,size_t> > weighted;
+    size_t total_weight=0;
+    for(size_t h=0;h<m_levels.size();h++) {
+      for(size_t n=0;n<m_levels[h].size();n++) weighted.push_back(pair<T,size_t>(m_levels[h][n],static_cast<size_t>(1) << h));
+      total_weight += m_levels[h].size() << h;
+    }
+    sort(weighted.begin(),weighted.end());
+
+    double target = q*static_cast<double>(total_weight);
+    size_t cumulative=0;
+    for(size_t n=0;n<weighted.size();n++) {
+      cumulative += weighted[n].second;
+      if(static_cast<double>(cumulative) > target) return weighted[n].first;
+    }
+    return weighted.back().first;
+  }
+
+  /// Approximate median
+  T median() const {
+    return quantile(0.5);
+  }
+
+  /// Approximate value at a percentile (0-100)
+  T percentile(double p) const {
+    return quantile(p/100);
+  }
+
+private:
+
+  /// Space allowed on level h, shrinks by 2/3 per level below the top
+  size_t capacity(size_t h) const {
+    size_t depth = m_levels.size()-1-h;
+    size_t c = static_cast<size_t>(ceil(static_cast<double>(m_k)*pow(2.0/3.0,static_cast<double>(depth))));
+    return (c < 2) ? 2 : c;
+  }
+
+  void compress() {
+    for(size_t h=0;h<m_levels.size();h++) {
+      if(m_levels[h].size() < capacity(h)) continue;
+
+      if(h+1 == m_levels.size()) m_levels.push_back(vector<T>());
+
+      vector<T> &level = m_levels[h];
+      sort(level.begin(),level.end());
+
+      // an odd value out stays on this level
+      size_t pairs = level.size()/2;
+      size_t offset = coin();
+
+      vector<T> &next = m_levels[h+1];
+      for(size_t n=0;n<pairs;n++) next.push_back(level[(2*n)+offset]);
+
+      if(level.size() % 2) {
+        T leftover = level.back();
+        level.clear();
+        level.push_back(leftover);
+      } else {
+        level.clear();
+      }
+    }
+  }
+
+  /// Which half compaction keeps. A fixed seed xorshift, so results are reproducible.
+  size_t coin() {
+    m_state ^= m_state << 13;
+    m_state ^= m_state >> 7;
+    m_state ^= m_state << 17;
+    return static_cast<size_t>(m_state >> 63);
+  }
+
+  size_t             m_k;      ///< Space of the top level, controls accuracy
+  size_t             m_count;  ///< Values inserted
+  unsigned long long m_state;  ///< Coin state
+  vector<vector<T> > m_levels; ///< m_levels[h] holds values of weight 2^h
+};
+
+#endif
@@ -30,8 +30,13 @@
 
 using namespace std;
 
+/// Four intensities, one per base.
+///
+/// Only the values are stored, so with float precision a ReadIntensity is exactly 16 bytes and
+/// 16 byte aligned, one SIMD register. Off edge flags are held per cycle alongside the signal in
+/// Cluster (see offedge_mask_type).
 template<class _prec=float>
-class ReadIntensity {
+class alignas(sizeof(_prec)*4 <= 16 ? sizeof(_prec)*4 : 16) ReadIntensity {
 public:
 
   typedef int base_type;
@@ -40,14 +45,15 @@ public:
   static const int base_g = 2;
   static const int base_t = 3;
   const static int base_count = 4;
+
+  typedef unsigned char offedge_mask_type; ///< Off edge flags for one cycle, bit n set if base n fell off the image
+  static const offedge_mask_type offedge_all = 0xF;
   
   _prec bases[base_count];
-  bool  bases_offedge[base_count];
 
   static const std::string base_name[]; ///< string names for bases
 
   ReadIntensity() {
-    for(int n=0;n<base_count;n++) bases_offedge[n] = false;
   }
   
   ReadIntensity(_prec a,_prec c,_prec g,_prec t) {
@@ -55,18 +61,16 @@ public:
     bases[base_c] = c;
     bases[base_g] = g;
     bases[base_t] = t;
-    for(int n=0;n<base_count;n++) bases_offedge[n] = false;
   }
-  
-  ReadIntensity(_prec a,_prec c,_prec g,_prec t,bool offedge_a,bool offedge_c,bool offedge_g,bool offedge_t) {
-    bases[base_a] = a;
-    bases[base_c] = c;
-    bases[base_g] = g;
-    bases[base_t] = t;
-    bases_offedge[base_a] = offedge_a;
-    bases_offedge[base_c] = offedge_c;
-    bases_offedge[base_g] = offedge_g;
-    bases_offedge[base_t] = offedge_t;
+
+  /// True if all bases in this mask are off edge
+  static inline bool off_edge(offedge_mask_type mask) {
+    return (mask & offedge_all) == offedge_all;
+  }
+
+  /// True if any base in this mask is off edge
+  static inline bool any_off_edge(offedge_mask_type mask) {
+    return (mask & offedge_all) != 0;
   }
 
   inline base_type max_base() const {
@@ -122,7 +126,11 @@ public:
   }
 
   _prec purity() const {
-    base_type max_base_pos  = max_base();
+    return purity(max_base());
+  }
+
+  /// Purity, when max_base() is already known
+  _prec purity(base_type max_base_pos) const {
     _prec max_intensity     = get_base(max_base_pos);
     _prec sub_max_intensity = get_base(sub_max_base(max_base_pos));
     
@@ -175,20 +183,6 @@ public:
 
   }
 
-  bool off_edge() const {
-    if((bases_offedge[base_a]) &&
-       (bases_offedge[base_c]) &&
-       (bases_offedge[base_t]) &&
-       (bases_offedge[base_g])) return true; else return false;
-  }
-  
-  bool any_off_edge() const {
-    if((bases_offedge[base_a]) ||
-       (bases_offedge[base_c]) ||
-       (bases_offedge[base_g]) ||
-       (bases_offedge[base_t])) return true; else return false;
-  }
-
 
   _prec distance(_prec pa,_prec pc,_prec pg,_prec pt,
                  _prec qa,_prec qc,_prec qg,_prec qt) const {
@@ -0,0 +1,196 @@
+/*
+    Swift (c) 2008 Genome Research Ltd.
+    Authors: Nava Whiteford and Tom Skelly (new@sgenomics.org ts6@sanger.ac.uk)
+
+    This file is part of Swift (http://swiftng.sourceforge.net).
+
+    Swift is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Swift is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with Swift.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SWIFT_RUNFOLDER_H
+#define SWIFT_RUNFOLDER_H
+
+#include <vector>
+#include <string>
+#include <map>
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <dirent.h>
+#include "stringify.h"
+
+using namespace std;
+
+/// Finds the images of tiles in GA run folders, as the runswift scripts did with ls.
+///
+/// Images are Images/L00<lane>/C<cycle>.1/s_<lane>_<tile>_<base>*.tif under a run folder. The cycle
+/// directories of a lane are listed once by scan, after which the images of any tile are found without
+/// touching the file system. A paired run is two folders, the cycles of the second following the first.
+class RunFolder {
+public:
+
+  RunFolder(const vector<string> &folders_in) : folders(folders_in) {
+  }
+
+  /// Lists the cycle directories of a lane in every folder, returns false if a folder has none
+  bool scan(int lane) {
+    vector<vector<cycle_directory> > &lane_cycles = cycles[lane];
+    lane_cycles.clear();
+
+    bool ok=true;
+    for(size_t f=0;f<folders.size();f++) {
+      string lane_path = folders[f] + "/Images/" + lane_directory(lane);
+      lane_cycles.push_back(vector<cycle_directory>());
+
+      vector<string> entries;
+      list_directory(lane_path,entries);
+      for(size_t n=0;n<entries.size();n++) {
+        int cycle = cycle_number(entries[n]);
+        if(cycle < 0) continue;
+
+        cycle_directory d;
+        d.cycle = cycle;
+        d.path  = lane_path + "/" + entries[n];
+        list_directory(d.path,d.files);
+        sort(d.files.begin(),d.files.end());
+        lane_cycles.back().push_back(d);
+      }
+      sort(lane_cycles.back().begin(),lane_cycles.back().end());
+
+      if(lane_cycles.back().empty()) ok=false;
+    }
+
+    return ok;
+  }
+
+  /// The image files of a tile for each base (a, c, g, t) in cycle order. Returns false if the lane hasn't
+  /// been scanned, or any cycle doesn't have exactly one image of each base for the tile.
+  bool tile_images(int lane,int tile,vector<vector<string> > &images) const {
+    images.assign(base_count,vector<string>());
+
+    lane_map::const_iterator l = cycles.find(lane);
+    if(l == cycles.end()) return false;
+
+    string prefix = tile_name(lane,tile) + "_";
+    for(size_t f=0;f<(*l).second.size();f++) {
+      const vector<cycle_directory> &lane_cycles = (*l).second[f];
+      for(size_t c=0;c<lane_cycles.size();c++) {
+        for(int base=0;base<base_count;base++) {
+          string base_prefix = prefix + base_names()[base];
+
+          int found=0;
+          vector<string>::const_iterator i = lower_bound(lane_cycles[c].files.begin(),lane_cycles[c].files.end(),base_prefix);
+          for(;(i != lane_cycles[c].files.end()) && ((*i).compare(0,base_prefix.size(),base_prefix) == 0);i++) {
+            if(ends_with(*i,".tif")) {
+              if(found == 0) images[base].push_back(lane_cycles[c].path + "/" + (*i));
+              found++;
+            }
+          }
+          if(found != 1) return false;
+        }
+      }
+    }
+
+    return images[0].size() > 0;
+  }
+
+  /// Name of a tile as it appears in image file names, and as used for output files
+  static string tile_name(int lane,int tile) {
+    return "s_" + stringify(lane) + "_" + stringify(tile);
+  }
+
+  /// Parses a list of numbers and ranges such as "1-8" or "1,3,5-7". Returns false on anything else.
+  static bool parse_range(const string &s,vector<int> &values) {
+    values.clear();
+
+    size_t start=0;
+    for(;start <= s.size();) {
+      size_t end = s.find(',',start);
+      if(end == string::npos) end = s.size();
+      string item = s.substr(start,end-start);
+
+      size_t dash = item.find('-',1);
+      int first,last;
+      if(dash == string::npos) {
+        if(!parse_int(item,first)) return false;
+        last = first;
+      } else {
+        if(!parse_int(item.substr(0,dash),first) || !parse_int(item.substr(dash+1),last)) return false;
+      }
+      if(last < first) return false;
+      for(int n=first;n<=last;n++) values.push_back(n);
+
+      start = end+1;
+    }
+
+    return values.size() > 0;
+  }
+
+private:
+  static const int base_count = 4;
+
+  struct cycle_directory {
+    int            cycle;
+    string         path;
+    vector<string> files;   ///< Sorted
+
+    bool operator<(const cycle_directory &other) const { return cycle < other.cycle; }
+  };
+  typedef map<int,vector<vector<cycle_directory> > > lane_map;
+
+  static const char *const *base_names() {
+    static const char *const names[base_count] = {"a","c","g","t"};
+    return names;
+  }
+
+  static string lane_directory(int lane) {
+    char name[32];
+    snprintf(name,sizeof(name),"L%03d",lane);
+    return name;
+  }
+
+  /// Cycle of a directory named C<cycle>.1, -1 for anything else
+  static int cycle_number(const string &name) {
+    if((name.size() < 4) || (name[0] != 'C') || !ends_with(name,".1")) return -1;
+    int cycle;
+    if(!parse_int(name.substr(1,name.size()-3),cycle)) return -1;
+    return cycle;
+  }
+
+  static bool parse_int(const string &s,int &value) {
+    if(s.empty() || (s.find_first_not_of("0123456789") != string::npos)) return false;
+    value = atoi(s.c_str());
+    return true;
+  }
+
+  static bool ends_with(const string &s,const string &suffix) {
+    return (s.size() >= suffix.size()) && (s.compare(s.size()-suffix.size(),suffix.size(),suffix) == 0);
+  }
+
+  static void list_directory(const string &path,vector<string> &entries) {
+    entries.clear();
+    DIR *dir = opendir(path.c_str());
+    if(dir == NULL) return;
+    for(struct dirent *e=readdir(dir);e != NULL;e=readdir(dir)) {
+      string name(e->d_name);
+      if((name != ".") && (name != "..")) entries.push_back(name);
+    }
+    closedir(dir);
+  }
+
+  vector<string>  folders;   ///< Run folders, in read order
+  lane_map        cycles;    ///< lane to, for each folder, its cycle directories in cycle order
+};
+
+#endif
@@ -0,0 +1,125 @@
+/*
+    Swift (c) 2008 Genome Research Ltd.
+    Authors: Nava Whiteford and Tom Skelly (new@sgenomics.org ts6@sanger.ac.uk)
+
+    This file is part of Swift (http://swiftng.sourceforge.net).
+
+    Swift is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Swift is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with Swift.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SWIFT_SIGNALID_H
+#define SWIFT_SIGNALID_H
+
+#include <string>
+#include <atomic>
+#include <mutex>
+#include <stdexcept>
+
+using namespace std;
+
+/// Maps signal names ("RAW", "FINAL" etc.) to small integers.
+///
+/// Names are interned once, normally when a stage is constructed, after which
+/// clusters are indexed by integer rather than by string comparison.
+///
+/// Tiles may run on several threads at once (see the batch mode of swift_main), so lookups read only
+/// names which have been published, and never move; adding a name takes a lock.
+class SignalRegistry {
+public:
+
+  static const int max_signals = 64;
+
+  // As with CommandLine there is a single instance, obtained through Instance().
+  static SignalRegistry *Instance() {
+    static SignalRegistry only_instance;
+    return &only_instance;
+  }
+
+  /// Returns the index for name, adding it if this is the first time it's been seen.
+  int intern(const string &name) {
+    int index = find(name,m_size.load(memory_order_acquire));
+    if(index >= 0) return index;
+
+    lock_guard<mutex> lock(m_add);
+    int count = m_size.load(memory_order_relaxed);
+    index = find(name,count);
+    if(index >= 0) return index;
+
+    if(count == max_signals) throw std::length_error("SignalRegistry: too many signals, adding " + name);
+    m_names[count] = name;
+    m_size.store(count+1,memory_order_release);
+    return count;
+  }
+
+  /// Name for an index, no bounds checking
+  const string &name(int index) const {
+    return m_names[index];
+  }
+
+  size_t size() const {
+    return m_size.load(memory_order_acquire);
+  }
+
+private:
+  SignalRegistry() : m_size(0) {
+  }
+
+  /// There are only a handful of signals, a scan is as quick as a map
+  int find(const string &name,int count) const {
+    for(int n=0;n<count;n++) if(m_names[n] == name) return n;
+    return -1;
+  }
+
+  string      m_names[max_signals];   ///< index to name, entries below m_size don't change
+  atomic<int> m_size;                 ///< names published
+  mutex       m_add;                  ///< held while adding a name
+};
+
+/// Handle for an interned signal name.
+///
+/// Constructing from a string interns it, so code which passes strings to the
+/// Cluster accessors keeps working. Stages should construct their handles once
+/// and use those inside per-cluster loops.
+class SignalId {
+public:
+  SignalId() : m_index(-1) {
+  }
+
+  SignalId(const string &name) : m_index(SignalRegistry::Instance()->intern(name)) {
+  }
+
+  SignalId(const char *name) : m_index(SignalRegistry::Instance()->intern(name)) {
+  }
+
+  inline int index() const {
+    return m_index;
+  }
+
+  inline bool is_set() const {
+    return m_index >= 0;
+  }
+
+  const string &name() const {
+    return SignalRegistry::Instance()->name(m_index);
+  }
+
+  inline bool operator==(const SignalId &rhs) const { return m_index == rhs.m_index; }
+  inline bool operator!=(const SignalId &rhs) const { return m_index != rhs.m_index; }
+  inline bool operator< (const SignalId &rhs) const { return m_index <  rhs.m_index; }
+
+private:
+  int m_index;
+};
+
+#endif
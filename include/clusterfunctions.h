@@ -25,6 +25,7 @@
 #include <vector>
 #include "ReadIntensity.h"
 #include <algorithm>
+#include "Quantile.h"
 
 using namespace std; // Bad me!
 
@@ -51,6 +52,24 @@ void remove_invalid_clusters(vector<Cluster<_prec> > &clusters) {
   clusters.erase(remove_if(clusters.begin(),clusters.end(),pred),clusters.end());
 }
 
+/// As above, also removing the entries of tags (one per cluster) belonging to the invalid clusters
+template<class _prec,class _tag>
+void remove_invalid_clusters(vector<Cluster<_prec> > &clusters,vector<_tag> &tags) {
+
+  Cluster_invalid<_prec> pred;
+  size_t kept=0;
+  for(size_t n=0;n<clusters.size();n++) {
+    if(pred(clusters[n])) continue;
+    if(kept != n) {
+      clusters[kept] = std::move(clusters[n]);
+      tags[kept]     = tags[n];
+    }
+    kept++;
+  }
+  clusters.erase(clusters.begin()+kept,clusters.end());
+  tags.resize(kept);
+}
+
 /// Bins reads in the x and y direction (counting read distribution across the x and y axis)
 template<class _prec>
 void cluster_xybins(const vector<Cluster<_prec> > &clusters,   ///< A vector of clusters to process
@@ -84,7 +103,7 @@ void cluster_xybins(const vector<Cluster<_prec> > &clusters,   ///< A vector of
 /// Bins read in 2D space
 template<class _prec>
 void cluster_crosstalk_bins(const vector<Cluster<_prec> > &clusters,
-                            const string &source_signalid,
+                            const SignalId &source_signalid,
                             vector<vector<int> > &bins,
                             typename ReadIntensity<double>::base_type base_x,
                             typename ReadIntensity<double>::base_type base_y,
@@ -200,10 +219,10 @@ bool cluster_get_percentile(const vector<Cluster<_prec> > &clusters,        ///<
     base_intensities.push_back((*i).signal().get_base(base));
   }
 
-  sort(base_intensities.begin(),base_intensities.end());
-
-  percentile_lower = base_intensities[base_intensities.size()*(static_cast<double>(percentile_lower_limit)/100)];
-  percentile_upper = base_intensities[base_intensities.size()*(static_cast<double>(percentile_upper_limit)/100)];
+  _prec lower,upper;
+  select_percentiles(base_intensities,percentile_lower_limit,percentile_upper_limit,lower,upper);
+  percentile_lower = lower;
+  percentile_upper = upper;
 
   return true;
 }
@@ -223,21 +242,30 @@ bool cluster_get_percentile_peaksignal(const vector<Cluster<_prec> > &clusters,
     base_intensities.push_back((*i).average_peaksignal());
   }
 
-  sort(base_intensities.begin(),base_intensities.end());
-
-  percentile_lower = base_intensities[static_cast<int>(base_intensities.size()*(static_cast<double>(percentile_lower_limit)/100))];
-  percentile_upper = base_intensities[static_cast<int>(base_intensities.size()*(static_cast<double>(percentile_upper_limit)/100))];
+  _prec lower,upper;
+  select_percentiles(base_intensities,percentile_lower_limit,percentile_upper_limit,lower,upper);
+  percentile_lower = lower;
+  percentile_upper = upper;
 
   return true;
 }
 
+/// Removes signal_id from every cluster. The storage is recycled as the target of the next stage (see Cluster::delete_signal).
 template<class _prec>
-inline void clear_cluster_signal(vector<Cluster<_prec> > &clusters,const string &signal_id) {
+inline void clear_cluster_signal(vector<Cluster<_prec> > &clusters,const SignalId &signal_id) {
   for(typename vector<Cluster<_prec> >::iterator i=clusters.begin();i != clusters.end();i++) {
     (*i).delete_signal(signal_id);
   }
 }
 
+/// Frees the storage recycled by clear_cluster_signal, call once a chain of stages has finished.
+template<class _prec>
+inline void release_cluster_spare(vector<Cluster<_prec> > &clusters) {
+  for(typename vector<Cluster<_prec> >::iterator i=clusters.begin();i != clusters.end();i++) {
+    (*i).release_spare();
+  }
+}
+
 template<class _prec>
 inline void clear_cluster_validity(vector<Cluster<_prec> > &clusters, bool validity) {
   for(typename vector<Cluster<_prec> >::iterator i=clusters.begin();i != clusters.end();i++) {
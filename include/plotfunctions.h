@@ -32,7 +32,7 @@
 using namespace std;
   
 void crosstalk_plot(const vector<Cluster<> > &clusters,          ///< Clusters to plot
-                    string signalid,                             ///< Which signal id to plot
+                    const SignalId &signalid,                    ///< Which signal id to plot
                     int cycle,ReadIntensity<>::base_type base_x, ///< X Axis base for crosstalk plot
                     ReadIntensity<>::base_type base_y,           ///< Y Axis base for crosstalk plot
                     string plottitle) {                          ///< Plot title/data name  
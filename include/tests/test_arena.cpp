@@ -0,0 +1,99 @@
+/*
+    Swift (c) 2008 Genome Research Ltd.
+    Authors: Nava Whiteford and Tom Skelly (new@sgenomics.org ts6@sanger.ac.uk)
+
+    This file is part of Swift (http://swiftng.sourceforge.net).
+
+    Swift is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Swift is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with Swift.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "utf.h"
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <stdexcept>
+#include "Arena.h"
+#include "test_arena.h"
+
+typedef vector<int,ArenaAllocator<int> > arena_ints;
+
+/// As batch_worker in swift_main: one arena per thread, each tile loaded in a stack scope over it, a tile
+/// which throws is reported and the next one started. Counts tiles which saw the wrong arena.
+static void arena_worker(atomic<size_t> &next,size_t tiles,size_t failing,atomic<int> &failed,atomic<int> &wrong) {
+  MonotonicArena tile_arena(4096);
+
+  for(size_t t=next++;t<tiles;t=next++) {
+    try {
+      ArenaScope<arena_tile> tile_scope(tile_arena);
+      if(ArenaScope<arena_tile>::current() != &tile_arena) wrong++;
+
+      arena_ints clusters(1000,static_cast<int>(t));
+      if(t == failing) throw runtime_error("tile failed");
+    } catch(exception &) {
+      failed++;
+    }
+
+    // Nothing left installed, so this comes from the heap rather than an arena about to be reset
+    if(ArenaScope<arena_tile>::current() != NULL) wrong++;
+    size_t used = tile_arena.bytes_used();
+    arena_ints after_tile(1000,0);
+    if(tile_arena.bytes_used() != used) wrong++;
+
+    tile_arena.reset();
+  }
+}
+
+void test_arena(UnitTest &ut) {
+
+  ut.begin_test_set("Arena");
+
+  MonotonicArena arena;
+  {
+    ArenaScope<arena_tile> scope(arena);
+    arena_ints v(100,1);
+    ut.test(arena.bytes_used() >= 100*sizeof(int),true);
+
+    // scopes nest, the inner one is removed when it goes out of scope
+    MonotonicArena inner;
+    {
+      ArenaScope<arena_tile> inner_scope(inner);
+      ut.test(ArenaScope<arena_tile>::current() == &inner,true);
+    }
+    ut.test(ArenaScope<arena_tile>::current() == &arena,true);
+
+    // a scope without an arena sends allocations to the heap until it ends
+    {
+      ArenaScope<arena_tile> heap_scope;
+      size_t used = arena.bytes_used();
+      arena_ints temporary(1000,2);
+      ut.test(arena.bytes_used(),used);
+    }
+    ut.test(ArenaScope<arena_tile>::current() == &arena,true);
+  }
+  ut.test(ArenaScope<arena_tile>::current() == static_cast<MonotonicArena *>(NULL),true);
+
+  // A batch of tiles on several threads, one of which throws while its scope is open
+  atomic<size_t> next(0);
+  atomic<int>    failed(0);
+  atomic<int>    wrong(0);
+  vector<thread> workers;
+  for(int n=0;n<3;n++) workers.push_back(thread(arena_worker,ref(next),static_cast<size_t>(12),static_cast<size_t>(4),ref(failed),ref(wrong)));
+  for(size_t n=0;n<workers.size();n++) workers[n].join();
+
+  ut.test(failed.load(),1);
+  ut.test(wrong.load(),0);
+  ut.test(next.load() >= 12,true);
+
+  ut.end_test_set();
+}
@@ -0,0 +1,81 @@
+/*
+    Swift (c) 2008 Genome Research Ltd.
+    Authors: Nava Whiteford and Tom Skelly (new@sgenomics.org ts6@sanger.ac.uk)
+
+    This file is part of Swift (http://swiftng.sourceforge.net).
+
+    Swift is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Swift is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with Swift.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "utf.h"
+#include "BandedMatrix.h"
+#include "test_bandedmatrix.h"
+
+void test_bandedmatrix(UnitTest &ut) {
+
+  ut.begin_test_set("BandedMatrix");
+
+  // A phasing style matrix: unit diagonal, geometric tails below (2 wide) and above (3 wide)
+  const int size  = 12;
+  const int lanes = 3;
+  BandedMatrix m(size,2,3);
+  for(int r=0;r<size;r++) {
+    for(int c=0;c<size;c++) {
+      if(!m.in_band(r,c)) continue;
+      if(r == c) m.at(r,c) = 1;
+      else       m.at(r,c) = pow(0.1*(1+(c%3)),abs(r-c));
+    }
+  }
+  ut.test(m.get(0,4),0.0);
+  ut.test(m.get(5,2),0.0);
+
+  // b = m x for known x, three right hand sides
+  vector<double> x(size*lanes);
+  for(int r=0;r<size;r++) for(int l=0;l<lanes;l++) x[(r*lanes)+l] = (l == 0) ? 1000*(r%4 == l) : 50.0*(r+l);
+
+  vector<double> b(size*lanes,0);
+  for(int r=0;r<size;r++) {
+    for(int c=0;c<size;c++) {
+      for(int l=0;l<lanes;l++) b[(r*lanes)+l] += m.get(r,c)*x[(c*lanes)+l];
+    }
+  }
+
+  ut.test(m.factored(),false);
+  ut.test(m.factor(),true);
+  ut.test(m.factored(),true);
+
+  vector<double> batch = b;
+  m.solve(&batch[0],lanes);
+
+  double worst=0;
+  for(size_t n=0;n<x.size();n++) worst = max(worst,fabs(batch[n]-x[n]));
+  ut.test(worst < 1e-9,true);
+
+  // A single right hand side gives the same answer as its lane in a batch
+  vector<double> single(size);
+  for(int r=0;r<size;r++) single[r] = b[(r*lanes)+1];
+  m.solve(&single[0]);
+  bool same=true;
+  for(int r=0;r<size;r++) if(single[r] != batch[(r*lanes)+1]) same=false;
+  ut.test(same,true);
+
+  // A zero pivot is refused
+  BandedMatrix z(3,1,1);
+  z.at(0,0) = 0; z.at(0,1) = 1;
+  z.at(1,0) = 1; z.at(1,1) = 1; z.at(1,2) = 1;
+  z.at(2,1) = 1; z.at(2,2) = 1;
+  ut.test(z.factor(),false);
+
+  ut.end_test_set();
+}
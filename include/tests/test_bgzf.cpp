@@ -0,0 +1,94 @@
+/*
+    Swift (c) 2008 Genome Research Ltd.
+    Authors: Nava Whiteford and Tom Skelly (new@sgenomics.org ts6@sanger.ac.uk)
+
+    This file is part of Swift (http://swiftng.sourceforge.net).
+
+    Swift is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Swift is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with Swift.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "utf.h"
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <cstdio>
+#include <zlib.h>
+#include "Bgzf.h"
+#include "OutputBuffer.h"
+#include "test_bgzf.h"
+
+/// Decompresses a whole gzip file, all members
+string gunzip_file(const char *filename) {
+  string s;
+  gzFile f = gzopen(filename,"rb");
+  if(f == 0) return s;
+  char buffer[4096];
+  int n;
+  while((n = gzread(f,buffer,sizeof(buffer))) > 0) s.append(buffer,n);
+  gzclose(f);
+  return s;
+}
+
+string read_file(const char *filename) {
+  ifstream in(filename,ios::binary);
+  ostringstream s;
+  s << in.rdbuf();
+  return s.str();
+}
+
+void test_bgzf(UnitTest &ut) {
+
+  ut.begin_test_set("Bgzf");
+
+  // Several blocks worth, with some incompressible data
+  string expected;
+  unsigned int state = 1;
+  for(int n=0;n<20000;n++) {
+    expected += "@read:" + to_string(n) + "\nACGTACGTTTGA\n+\n";
+    for(int c=0;c<12;c++) { state = (state*1103515245)+12345; expected.push_back(static_cast<char>(33+((state >> 16) % 90))); }
+    expected += "\n";
+  }
+
+  const char *filename = "test_bgzf.tmp.gz";
+  for(int threads=0;threads<=3;threads+=3) {
+    BgzfPool pool(threads);
+    OutputBuffer out(10000);
+    out.open(filename,&pool);
+    out.append(expected);
+    out.close();
+
+    ut.test(gunzip_file(filename),expected);
+
+    // every block is a gzip member with a BC field, the last is the empty end of file block
+    string written = read_file(filename);
+    ut.test(written.size() > 28,true);
+    ut.test(written.substr(12,4),string("BC\2\0",4));
+
+    size_t eof_size;
+    const char *eof = BgzfPool::eof_block(eof_size);
+    ut.test(written.substr(written.size()-28),string(eof,eof_size));
+  }
+
+  // An empty file is just the end of file block
+  BgzfPool pool(0);
+  OutputBuffer out;
+  out.open(filename,&pool);
+  out.close();
+  ut.test(read_file(filename).size(),static_cast<size_t>(28));
+  ut.test(gunzip_file(filename),string());
+
+  remove(filename);
+
+  ut.end_test_set();
+}
@@ -0,0 +1,70 @@
+/*
+    Swift (c) 2008 Genome Research Ltd.
+    Authors: Nava Whiteford and Tom Skelly (new@sgenomics.org ts6@sanger.ac.uk)
+
+    This file is part of Swift (http://swiftng.sourceforge.net).
+
+    Swift is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Swift is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with Swift.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "utf.h"
+#include <vector>
+#include <stdexcept>
+#include "BlockPipeline.h"
+#include "test_blockpipeline.h"
+
+void test_blockpipeline(UnitTest &ut) {
+
+  ut.begin_test_set("BlockPipeline");
+
+  // Blocks of numbers are squared in parallel, then listed and summed in order
+  vector<vector<int> > blocks(50);
+  for(size_t b=0;b<blocks.size();b++) {
+    for(int n=0;n<100;n++) blocks[b].push_back((b*100)+n);
+  }
+
+  vector<int> seen;
+  long long sum=0;
+  BlockPipeline<vector<int> > pipeline(4);
+  pipeline.parallel([](vector<int> &b) { for(size_t n=0;n<b.size();n++) b[n] = b[n]*b[n]; });
+  pipeline.ordered([&seen](vector<int> &b) { seen.push_back(b[0]); });
+  pipeline.ordered([&sum](vector<int> &b) { for(size_t n=0;n<b.size();n++) sum += b[n]; });
+  pipeline.run(blocks);
+
+  bool in_order=(seen.size() == blocks.size());
+  for(size_t b=0;in_order && (b<seen.size());b++) in_order = (seen[b] == static_cast<int>(b*100*b*100));
+  ut.test(in_order,true);
+
+  long long expected=0;
+  for(long long n=0;n<5000;n++) expected += n*n;
+  ut.test(sum,expected);
+  ut.test(blocks[49][99],4999*4999);
+
+  // A stage which throws stops the run, and the exception reaches the caller
+  BlockPipeline<vector<int> > failing(4);
+  size_t written=0;
+  failing.parallel([](vector<int> &b) { if(b[0] == 20*100*20*100) throw runtime_error("block 20"); });
+  failing.ordered([&written](vector<int> &) { written++; });
+
+  bool thrown=false;
+  try {
+    failing.run(blocks);
+  } catch(runtime_error &) {
+    thrown=true;
+  }
+  ut.test(thrown,true);
+  ut.test(written <= 20,true);
+
+  ut.end_test_set();
+}
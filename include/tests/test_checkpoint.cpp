@@ -0,0 +1,109 @@
+/*
+    Swift (c) 2008 Genome Research Ltd.
+    Authors: Nava Whiteford and Tom Skelly (new@sgenomics.org ts6@sanger.ac.uk)
+
+    This file is part of Swift (http://swiftng.sourceforge.net).
+
+    Swift is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Swift is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with Swift.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "utf.h"
+#include <cstdio>
+#include <fstream>
+#include <sys/stat.h>
+#include "Cluster.h"
+#include "Checkpoint.h"
+#include "test_checkpoint.h"
+
+void test_checkpoint(UnitTest &ut) {
+
+  ut.begin_test_set("Checkpoint");
+
+  const char *filename = "test_checkpoint.tmp";
+  string intensities = Checkpoint<float>::intensity_filename(filename);
+
+  vector<Cluster<float> > clusters;
+  for(int n=0;n<3;n++) {
+    Cluster<float> c;
+    c.set_position(ClusterPosition<int>(n,n*2));
+    c.add_signal("POSITIVE");
+    for(int cycle=0;cycle<4;cycle++) {
+      c.signal("POSITIVE").push_back(ReadIntensity<float>(n+0.1f,cycle*1.5f,0.333333f,1e-6f));
+      c.offedge("POSITIVE").push_back(0);
+    }
+    clusters.push_back(c);
+  }
+
+  Checkpoint<float> saved;
+  saved.set_text("stage","crosstalk");
+  saved.set_text("parameter:phasing_window","");
+  vector<double> matrix;
+  for(int n=0;n<16;n++) matrix.push_back((n%5 == 0) ? 1 : -0.01*n);
+  saved.set_values("crosstalk",matrix);
+  ut.test(saved.write(filename,clusters,"POSITIVE"),true);
+
+  // Written under temporary names and renamed, none of which are left behind
+  ut.test(ifstream((string(filename) + ".tmp").c_str()).good(),false);
+  ut.test(ifstream((intensities + ".tmp").c_str()).good(),false);
+  ut.test(saved.write("no_such_directory/test_checkpoint.tmp",clusters,"POSITIVE"),false);
+
+  Checkpoint<float> loaded;
+  vector<Cluster<float> > resumed;
+  ut.test(loaded.read(filename,resumed,"POSITIVE"),true);
+  ut.test(loaded.text("stage"),string("crosstalk"));
+  ut.test(loaded.text("parameter:phasing_window"),string(""));
+  ut.test(loaded.text("missing"),string(""));
+  ut.test(loaded.values("crosstalk") == matrix,true);
+  ut.test(loaded.values("missing").size(),static_cast<size_t>(0));
+
+  ut.test(resumed.size(),static_cast<size_t>(3));
+  ut.test(resumed[2].get_position().y,4);
+  ut.test(resumed[1].const_signal("POSITIVE")[3].get_base(1),clusters[1].const_signal("POSITIVE")[3].get_base(1));
+
+  // Written again over the last one, the new records and intensities are read back together
+  saved.set_text("stage","phasing");
+  clusters.pop_back();
+  ut.test(saved.write(filename,clusters,"POSITIVE"),true);
+  ut.test(loaded.read(filename,resumed,"POSITIVE"),true);
+  ut.test(loaded.text("stage"),string("phasing"));
+  ut.test(resumed.size(),static_cast<size_t>(2));
+
+  // If the old records can't be removed, the old intensities aren't replaced either
+  const char *blocked = "test_checkpoint_blocked.tmp";
+  string blocked_intensities = Checkpoint<float>::intensity_filename(blocked);
+  string blocked_inside      = string(blocked) + "/inside";
+  mkdir(blocked,0700);
+  ofstream(blocked_inside.c_str()) << "keeps the directory from being removed" << endl;
+  ofstream(blocked_intensities.c_str()) << "old" << endl;
+  ut.test(saved.write(blocked,clusters,"POSITIVE"),false);
+  ifstream old_intensities(blocked_intensities.c_str());
+  string first_line;
+  getline(old_intensities,first_line);
+  ut.test(first_line,string("old"));
+  remove(blocked_inside.c_str());
+  remove(blocked);
+  remove(blocked_intensities.c_str());
+
+  // Anything else is refused
+  ofstream other(filename);
+  other << "SWIFTINT and something else" << endl;
+  other.close();
+  ut.test(loaded.read(filename),false);
+  ut.test(loaded.text("stage"),string(""));
+
+  remove(filename);
+  remove(intensities.c_str());
+
+  ut.end_test_set();
+}
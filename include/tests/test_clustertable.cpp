@@ -0,0 +1,116 @@
+/*
+    Swift (c) 2008 Genome Research Ltd.
+    Authors: Nava Whiteford and Tom Skelly (new@sgenomics.org ts6@sanger.ac.uk)
+
+    This file is part of Swift (http://swiftng.sourceforge.net).
+
+    Swift is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Swift is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with Swift.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "utf.h"
+#include <stdexcept>
+#include "Cluster.h"
+#include "ClusterTable.h"
+#include "test_clustertable.h"
+
+void test_clustertable(UnitTest &ut) {
+
+  ut.begin_test_set("ClusterTable");
+
+  vector<Cluster<float> > clusters;
+  for(int n=0;n<3;n++) {
+    Cluster<float> c;
+    c.set_position(ClusterPosition<int>(n*10,n*20));
+    for(int cycle=0;cycle<2;cycle++) {
+      c.signal("RAW").push_back(ReadIntensity<float>(n,cycle,100*n,0));
+      c.offedge("RAW").push_back((n==1) ? 8 : 0);
+    }
+    clusters.push_back(c);
+  }
+  clusters[1].set_valid(false);
+
+  vector<string> ids;
+  ids.push_back("RAW");
+
+  ClusterTable<float> table;
+  table.from_clusters(clusters,ids);
+
+  ut.test(table.cluster_count(),static_cast<size_t>(3));
+  ut.test(table.cycle_count()  ,static_cast<size_t>(2));
+  ut.test(table.get_position(2).y,40);
+
+  // cycle major layout, a single cycle is contiguous
+  ClusterTable<float>::CycleView v = table.cycle("RAW",1);
+  ut.test(v[2][ReadIntensity<float>::base_a],2.0f);
+  ut.test(v[2][ReadIntensity<float>::base_c],1.0f);
+  ut.test(v[2][ReadIntensity<float>::base_g],200.0f);
+  ut.test(static_cast<int>(v.end()-v.begin()),12);
+
+  ClusterTable<float>::ClusterView cv = table.cluster("RAW",2);
+  ut.test(cv[1][ReadIntensity<float>::base_g],200.0f);
+
+  ut.test(ReadIntensity<float>::any_off_edge(table.get_offedge("RAW",0,1)),true);
+  ut.test(ReadIntensity<float>::any_off_edge(table.get_offedge("RAW",0,2)),false);
+
+  table.remove_invalid();
+  ut.test(table.cluster_count(),static_cast<size_t>(2));
+  ut.test(table.get_position(1).x,20);
+  ut.test(table.cycle("RAW",1)[1][ReadIntensity<float>::base_g],200.0f);
+
+  vector<Cluster<float> > back;
+  table.to_clusters(back,ids);
+  ut.test(back.size(),static_cast<size_t>(2));
+  ut.test(back[1].signal("RAW")[1] == clusters[2].signal("RAW")[1],true);
+  ut.test(back[1].get_position().x,20);
+
+  // archived signals read back at reduced precision, and survive compaction
+  table.set_intensity("RAW",0,1,ReadIntensity<float>(1.0f/3.0f,65504,-2.5f,70000));
+  table.archive_signal("RAW",ClusterTable<float>::storage_fp16);
+  ut.test(table.get_storage("RAW") == ClusterTable<float>::storage_fp16,true);
+  ut.test(table.get_intensity("RAW",0,1).get_base(ReadIntensity<float>::base_a),0.333251953125f);
+  ut.test(table.get_intensity("RAW",0,1).get_base(ReadIntensity<float>::base_c),65504.0f);
+  ut.test(table.get_intensity("RAW",0,1).get_base(ReadIntensity<float>::base_g),-2.5f);
+  ut.test(table.get_intensity("RAW",1,1).get_base(ReadIntensity<float>::base_g),200.0f);
+  table.set_valid(0,false);
+  table.remove_invalid();
+  table.restore_signal("RAW");
+  ut.test(table.cycle("RAW",1)[0][ReadIntensity<float>::base_g],200.0f);
+
+  ut.test(bf16_to_float(float_to_bf16(1.0f/3.0f)),0.333984375f);
+  ut.test(fp16_to_float(float_to_fp16(70000.0f)) > 65504.0f,true);
+  ut.test(fp16_to_float(float_to_fp16(5.96046448e-08f)),5.96046448e-08f);
+
+  // signals added after a deleted one are still found where they moved to
+  Cluster<float> slots;
+  slots.add_signal("SLOT_A");
+  slots.add_signal("SLOT_B");
+  slots.signal("SLOT_B").push_back(ReadIntensity<float>(1,2,3,4));
+  slots.delete_signal("SLOT_A");
+  ut.test(slots.has_signal("SLOT_A"),false);
+  ut.test(slots.const_signal("SLOT_B").size(),static_cast<size_t>(1));
+  slots.add_signal("SLOT_A");
+  ut.test(slots.const_signal("SLOT_A").size(),static_cast<size_t>(0));
+  ut.test(slots.get_signal_ids().back(),string("SLOT_A"));
+
+  // an unknown signal is refused rather than dereferenced
+  bool thrown=false;
+  try {
+    table.data("MISSING");
+  } catch(invalid_argument &) {
+    thrown=true;
+  }
+  ut.test(thrown,true);
+
+  ut.end_test_set();
+}
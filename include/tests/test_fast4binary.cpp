@@ -0,0 +1,86 @@
+/*
+    Swift (c) 2008 Genome Research Ltd.
+    Authors: Nava Whiteford and Tom Skelly (new@sgenomics.org ts6@sanger.ac.uk)
+
+    This file is part of Swift (http://swiftng.sourceforge.net).
+
+    Swift is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Swift is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with Swift.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "utf.h"
+#include <cstdio>
+#include "Fast4Writer.h"
+#include "Fast4Binary.h"
+#include "test_fast4binary.h"
+
+void test_fast4binary(UnitTest &ut) {
+
+  ut.begin_test_set("Fast4Binary");
+
+  const char *filename = "test_fast4binary.tmp";
+  const size_t cycles = 5;
+
+  Fast4Writer<size_t,float> writer(filename);
+  writer.set_binarymode();
+  writer.open();
+
+  ProbabilitySequence<size_t,float> s;
+  for(int read=0;read<3;read++) {
+    s.sequence().clear();
+    for(size_t c=0;c<cycles;c++) {
+      BaseProbability<float> p;
+      p[0] = 0.1f*c; p[1] = 1; p[2] = 0; p[3] = 0.5f;
+      s.sequence().push_back(p);
+    }
+    s.set_id("T1:end2:" + to_string(100+read) + ":" + to_string(-read));
+    writer.write(s);
+  }
+  writer.close();
+
+  Fast4BinaryReader reader(filename);
+  ut.test(reader.open(),true);
+  ut.test(reader.size(),static_cast<size_t>(3));
+  ut.test(reader.cycles(),cycles);
+  ut.test(reader.bases(),static_cast<size_t>(4));
+  ut.test(reader.base_names(),string("ACGT"));
+  ut.test(reader.id_prefix(),string("T1:end2:"));
+  ut.test(reader.id(2),string("T1:end2:102:-2"));
+  ut.test(reader.x(1),101);
+  ut.test(reader.y(1),-1);
+  ut.test(reader.probability(1,1,3),1.0);
+  ut.test(reader.probability(1,2,3),0.0);
+  ut.test(static_cast<int>(reader.plane(0,3)[0]),128);
+  ut.test(static_cast<int>(reader.plane(2,0)[4]),102);
+  reader.close();
+
+  // An empty file still has a header
+  Fast4Writer<size_t,float> empty(filename);
+  empty.set_binarymode();
+  empty.open();
+  empty.close();
+  ut.test(reader.open(),true);
+  ut.test(reader.size(),static_cast<size_t>(0));
+  reader.close();
+
+  // Text FAST4 is not binary
+  Fast4Writer<size_t,float> text(filename);
+  text.open();
+  text.write(s);
+  text.close();
+  ut.test(reader.open(),false);
+
+  remove(filename);
+
+  ut.end_test_set();
+}
@@ -0,0 +1,93 @@
+/*
+    Swift (c) 2008 Genome Research Ltd.
+    Authors: Nava Whiteford and Tom Skelly (new@sgenomics.org ts6@sanger.ac.uk)
+
+    This file is part of Swift (http://swiftng.sourceforge.net).
+
+    Swift is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Swift is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with Swift.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "utf.h"
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include "Cluster.h"
+#include "ClusterTable.h"
+#include "GAPipelineParser.h"
+#include "test_gapipelineparser.h"
+
+void test_gapipelineparser(UnitTest &ut) {
+
+  ut.begin_test_set("GAPipelineParser");
+
+  // numbers parse as operator>> would
+  const char *fields = "7 -12 +3 0.1 -0.0 1234.5678 1e-3 0.30000000000000004 123456789012345678 .5 5.";
+  string line(fields);
+  GAPipelineLine l(line.data(),line.data()+line.size());
+  istringstream in(line);
+
+  int a,b;
+  int ia,ib;
+  l.next_int(a); in >> ia;
+  l.next_int(b); in >> ib;
+  ut.test(a,ia);
+  ut.test(b,ib);
+
+  bool same=true;
+  double v,iv;
+  int count=0;
+  for(;l.next_double(v);count++) {
+    in >> iv;
+    if(v != iv) same=false;
+  }
+  ut.test(same,true);
+  ut.test(count,9);
+
+  // a file of three clusters, a trailing partial cycle is dropped and the last line has no newline
+  const char *filename = "test_gapipelineparser.tmp";
+  ofstream text(filename);
+  text << "1\t1\t10\t20\t1.5 2.5 0 -4.25\t5 6 7 8\t9\n";
+  text << "1\t1\t-3\t4\t0.1 0.2 0.3 0.4\n";
+  text << "1\t1\t5\t6\t1 2 3 4";
+  text.close();
+
+  GAPipelineParser parser(filename);
+  ut.test(parser.open(),true);
+  ut.test(parser.size(),static_cast<size_t>(2));
+  ut.test(parser.cycles(0),static_cast<size_t>(2));
+
+  ClusterTable<float> table;
+  parser.read(table,"RAW");
+  ut.test(table.size(),static_cast<size_t>(2));
+  ut.test(table.cycle_count(),static_cast<size_t>(2));
+  ut.test(table.get_position(1).x,-3);
+  ut.test(table.get_intensity("RAW",0,0).get_base(ReadIntensity<float>::base_t),-4.25f);
+  ut.test(table.get_intensity("RAW",0,1).get_base(ReadIntensity<float>::base_a),0.1f);
+
+  // zeros are off edge, and so is the padding of a short line
+  ut.test(static_cast<int>(table.get_offedge("RAW",0,0)),1 << ReadIntensity<float>::base_g);
+  ut.test(static_cast<int>(table.get_offedge("RAW",1,1)),static_cast<int>(ReadIntensity<float>::offedge_all));
+
+  // the same as the per line cluster parser
+  Cluster<float> c;
+  c.read_gapipelinestr("RAW","1\t1\t10\t20\t1.5 2.5 0 -4.25\t5 6 7 8\t9");
+  ut.test(c.const_signal("RAW").size(),static_cast<size_t>(2));
+  ut.test(c.const_signal("RAW")[1].get_base(ReadIntensity<float>::base_c),table.get_intensity("RAW",1,0).get_base(ReadIntensity<float>::base_c));
+  ut.test(c.offedge_mask("RAW",0),table.get_offedge("RAW",0,0));
+
+  parser.close();
+  remove(filename);
+
+  ut.end_test_set();
+}
@@ -0,0 +1,155 @@
+/*
+    Swift (c) 2008 Genome Research Ltd.
+    Authors: Nava Whiteford and Tom Skelly (new@sgenomics.org ts6@sanger.ac.uk)
+
+    This file is part of Swift (http://swiftng.sourceforge.net).
+
+    Swift is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Swift is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with Swift.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "utf.h"
+#include <cstdio>
+#include <fstream>
+#include "Cluster.h"
+#include "IntensityFile.h"
+#include "test_intensityfile.h"
+
+void test_intensityfile(UnitTest &ut) {
+
+  ut.begin_test_set("IntensityFile");
+
+  const char *filename = "test_intensityfile.tmp";
+
+  vector<Cluster<float> > clusters;
+  for(int n=0;n<5;n++) {
+    Cluster<float> c;
+    c.set_position(ClusterPosition<int>(n*10,-n));
+    int cycles = (n == 3) ? 2 : 3;  // a short one, padded on writing
+    c.add_signal("FINAL");
+    for(int cycle=0;cycle<cycles;cycle++) {
+      c.signal("FINAL").push_back(ReadIntensity<float>(n+0.123456789f,cycle,-100.5f*n,1e-7f));
+      c.offedge("FINAL").push_back((n==1) ? 2 : 0);
+    }
+    clusters.push_back(c);
+  }
+
+  ut.test(IntensityFile<float>::write(filename,clusters,"FINAL"),true);
+  ut.test(IntensityFile<float>::is_intensity_file(filename),true);
+
+  vector<Cluster<float> > loaded;
+  ut.test(IntensityFile<float>::read(filename,loaded,"RAW"),true);
+  ut.test(loaded.size(),static_cast<size_t>(5));
+  ut.test(loaded[4].get_position().x,40);
+  ut.test(loaded[4].get_position().y,-4);
+  ut.test(loaded[0].const_signal("RAW").size(),static_cast<size_t>(3));
+
+  // values are exact
+  bool same=true;
+  for(int n=0;n<5;n++) {
+    for(size_t cycle=0;cycle<clusters[n].const_signal("FINAL").size();cycle++) {
+      for(int b=0;b<4;b++) {
+        if(loaded[n].const_signal("RAW")[cycle].get_base(b) != clusters[n].const_signal("FINAL")[cycle].get_base(b)) same=false;
+      }
+      if(loaded[n].offedge_mask("RAW",cycle) != clusters[n].offedge_mask("FINAL",cycle)) same=false;
+    }
+  }
+  ut.test(same,true);
+
+  // the short cluster is padded with an off edge cycle
+  ut.test(loaded[3].const_signal("RAW")[2].get_base(0),0.0f);
+  ut.test(static_cast<int>(loaded[3].offedge_mask("RAW",2)),static_cast<int>(ReadIntensity<float>::offedge_all));
+
+  // two files of different clusters join into one, which can be read a subset at a time
+  const char *second   = "test_intensityfile_2.tmp";
+  const char *combined = "test_intensityfile_3.tmp";
+  vector<Cluster<float> > first_two(clusters.begin(),clusters.begin()+2);
+  ut.test(IntensityFile<float>::write(filename,first_two,"FINAL"),true);
+  vector<Cluster<float> > last_three(clusters.begin()+2,clusters.end());
+  ut.test(IntensityFile<float>::write(second,last_three,"FINAL"),true);
+  vector<string> parts;
+  parts.push_back(filename);
+  parts.push_back(second);
+  ut.test(IntensityFile<float>::concatenate(combined,parts),true);
+  ut.test(IntensityFile<float>::write("/dev/full",clusters,"FINAL"),false);
+  ut.test(IntensityFile<float>::concatenate("/dev/full",parts),false);
+
+  size_t count=0,cycles=0;
+  ut.test(IntensityFile<float>::dimensions(combined,count,cycles),true);
+  ut.test(count,static_cast<size_t>(5));
+  ut.test(cycles,static_cast<size_t>(3));
+
+  vector<size_t> indices;
+  indices.push_back(4);
+  indices.push_back(1);
+  vector<Cluster<float> > subset;
+  ut.test(IntensityFile<float>::read(combined,indices,subset,"RAW"),true);
+  ut.test(subset.size(),static_cast<size_t>(2));
+  ut.test(subset[0].get_position().x,40);
+  ut.test(subset[1].const_signal("RAW")[2].get_base(2),clusters[1].const_signal("FINAL")[2].get_base(2));
+  ut.test(static_cast<int>(subset[1].offedge_mask("RAW",0)),2);
+
+  // a second read appends the file's cycles
+  ut.test(IntensityFile<float>::read(combined,indices,subset,"RAW"),true);
+  ut.test(subset[0].const_signal("RAW").size(),static_cast<size_t>(6));
+
+  // and the same into a table, whose rows are then filtered with their tags
+  ClusterTable<float> table;
+  ut.test(IntensityFile<float>::read(combined,indices,table,"RAW"),true);
+  ut.test(IntensityFile<float>::read(combined,indices,table,"RAW"),true);
+  ut.test(table.cycle_count(),static_cast<size_t>(6));
+  ut.test(table.get_position(0).x,40);
+  ut.test(table.cycle("RAW",5)[1][2],clusters[1].const_signal("FINAL")[2].get_base(2));
+  ut.test(static_cast<int>(table.get_offedge("RAW",3,1)),2);
+  vector<char> tags(2,'t');
+  tags[1] = 'u';
+  table.set_valid(0,false);
+  table.remove_invalid(tags);
+  ut.test(tags.size(),static_cast<size_t>(1));
+  ut.test(tags[0],'u');
+  ut.test(table.get_position(0).y,-1);
+  indices.push_back(5);
+  ut.test(IntensityFile<float>::read(combined,indices,table,"RAW"),false);
+
+  // 16 bit files, from clusters or an archived table, read back at that precision and join like any other
+  ut.test(IntensityFile<float>::write(filename,clusters,"FINAL",ClusterTable<float>::storage_fp16),true);
+  ut.test(IntensityFile<float>::read(filename,loaded,"RAW"),true);
+  ut.test(loaded[1].const_signal("RAW")[2].get_base(0),fp16_to_float(float_to_fp16(1.123456789f)));
+  ut.test(loaded[4].const_signal("RAW")[1].get_base(2),-402.0f);
+  ut.test(static_cast<int>(loaded[1].offedge_mask("RAW",0)),2);
+  ClusterTable<float> archived;
+  archived.from_clusters(clusters,vector<string>(1,"FINAL"));
+  archived.archive_signal("FINAL",ClusterTable<float>::storage_bf16);
+  ut.test(IntensityFile<float>::write(second,archived,"FINAL"),true);
+  ut.test(IntensityFile<float>::read(second,loaded,"RAW"),true);
+  ut.test(loaded[4].const_signal("RAW")[1].get_base(2),bf16_to_float(float_to_bf16(-402.0f)));
+  ut.test(IntensityFile<float>::concatenate(combined,parts),false);
+  ut.test(IntensityFile<float>::write(second,clusters,"FINAL",ClusterTable<float>::storage_fp16),true);
+  ut.test(IntensityFile<float>::concatenate(combined,parts),true);
+  ut.test(IntensityFile<float>::read(combined,loaded,"RAW"),true);
+  ut.test(loaded.size(),static_cast<size_t>(10));
+  remove(second);
+  remove(combined);
+
+  // GAPipeline text isn't taken for a binary file
+  ofstream text(filename);
+  text << clusters[0].dump_gapipelinestr("FINAL") << endl;
+  text.close();
+  ut.test(IntensityFile<float>::is_intensity_file(filename),false);
+  ut.test(IntensityFile<float>::read(filename,loaded,"RAW"),false);
+  ut.test(loaded.size(),static_cast<size_t>(0));
+
+  remove(filename);
+
+  ut.end_test_set();
+}
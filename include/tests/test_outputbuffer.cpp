@@ -0,0 +1,92 @@
+/*
+    Swift (c) 2008 Genome Research Ltd.
+    Authors: Nava Whiteford and Tom Skelly (new@sgenomics.org ts6@sanger.ac.uk)
+
+    This file is part of Swift (http://swiftng.sourceforge.net).
+
+    Swift is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Swift is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with Swift.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "utf.h"
+#include <sstream>
+#include <iomanip>
+#include <cstdio>
+#include "OutputBuffer.h"
+#include "test_outputbuffer.h"
+
+void test_outputbuffer(UnitTest &ut) {
+
+  ut.begin_test_set("OutputBuffer");
+
+  // A small buffer, so that it fills and is written out several times
+  const char *filename = "test_outputbuffer.tmp";
+  OutputBuffer out(16);
+  out.open(filename);
+  ut.test(out.is_open(),true);
+
+  ostringstream expected;
+  expected << fixed << setprecision(4);
+
+  float values[] = {0,-0.0f,1,0.5f,0.03125f,0.09375f,-0.03125f,0.99995f,0.12345678f,-0.00001f,123456.78f,1e20f,-3.5e-5f};
+  for(size_t n=0;n<sizeof(values)/sizeof(float);n++) {
+    out.append_fixed4(values[n]);
+    out.put(' ');
+    expected << values[n] << " ";
+  }
+
+  // every float of the form k/2^16 in [0,1], which includes all the ties
+  for(int k=0;k<=65536;k+=7) {
+    float v = static_cast<float>(k)/65536;
+    out.append_fixed4(v);
+    out.put(' ');
+    expected << v << " ";
+  }
+
+  double d = 0.123456789;
+  out.append_fixed4(d);
+  expected << d;
+
+  long ints[] = {0,7,-7,10,99,-100,1234567890123L};
+  for(size_t n=0;n<sizeof(ints)/sizeof(long);n++) {
+    out.put(',');
+    out.append_int(ints[n]);
+    expected << "," << ints[n];
+  }
+
+  string record = "@a record longer than the buffer itself\n";
+  out.append(record);
+  expected << record;
+
+  out.close();
+  ut.test(out.is_open(),false);
+
+  ifstream in(filename,ios::binary);
+  ostringstream written;
+  written << in.rdbuf();
+  in.close();
+  remove(filename);
+
+  ut.test(written.str(),expected.str());
+
+  // A write which fails is remembered, not only one which fails to open
+  ut.test(out.good(),true);
+  OutputBuffer full(16);
+  full.open("/dev/full");
+  ut.test(full.good(),true);
+  full.append(record);
+  full.close();
+  ut.test(full.good(),false);
+
+  ut.end_test_set();
+}
@@ -0,0 +1,69 @@
+/*
+    Swift (c) 2008 Genome Research Ltd.
+    Authors: Nava Whiteford and Tom Skelly (new@sgenomics.org ts6@sanger.ac.uk)
+
+    This file is part of Swift (http://swiftng.sourceforge.net).
+
+    Swift is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Swift is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with Swift.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "utf.h"
+#include "Quantile.h"
+#include "test_quantile.h"
+
+void test_quantile(UnitTest &ut) {
+
+  ut.begin_test_set("Quantile");
+
+  vector<int> values;
+  for(int n=0;n<101;n++) values.push_back((n*37)%101);  // 0..100 shuffled
+
+  vector<int> v = values;
+  ut.test(select_median(v),50);
+  v = values;
+  ut.test(select_nth(v,3),3);
+  v = values;
+  ut.test(select_percentile(v,90),90);
+
+  int lower=0;
+  int upper=0;
+  v = values;
+  select_percentiles(v,10,90,lower,upper);
+  ut.test(lower,10);
+  ut.test(upper,90);
+  v = values;
+  select_percentiles(v,90,10,lower,upper);
+  ut.test(lower,90);
+  ut.test(upper,10);
+
+  // even sizes give the upper median, as sorted[size/2]
+  vector<double> e;
+  e.push_back(4); e.push_back(1); e.push_back(3); e.push_back(2);
+  ut.test(select_median(e),3.0);
+
+  // sketches of two halves, merged, against the exact answer
+  QuantileSketch<double> a(200);
+  QuantileSketch<double> b(200);
+  for(int n=0;n<100000;n++) {
+    double x = static_cast<double>((n*7919)%100000);
+    if(n%2) a.insert(x); else b.insert(x);
+  }
+  a.merge(b);
+  ut.test(a.size(),static_cast<size_t>(100000));
+  ut.test(fabs(a.median()       - 50000) < 2000,true);
+  ut.test(fabs(a.percentile(95) - 95000) < 2000,true);
+  ut.test(fabs(a.percentile(5)  -  5000) < 2000,true);
+
+  ut.end_test_set();
+}
@@ -56,6 +56,24 @@ void test_readintensity(UnitTest &ut) {
   ut.test(r3.sub_max_base() ,ReadIntensity<double>::base_c);
   ut.test(r4.sub_max_base() ,ReadIntensity<double>::base_c);
 
+  // Cached purity and calls follow writes to the signal
+  Cluster<double> c;
+  c.signal("RAW").push_back(r);
+  c.signal("RAW").push_back(r1);
+  c.signal("RAW").push_back(r3);
+  ut.test_approx(c.min_purity(0,2,"RAW"),0.625,0.0001);
+  ut.test(static_cast<int>(c.const_calls("RAW")[2]),ReadIntensity<double>::base_g);
+
+  Cluster<double> d = c;
+  ut.test(c.similarity(d,"RAW"),3);
+
+  d.signal("RAW")[2] = r4;
+  ut.test(static_cast<int>(d.const_calls("RAW")[2]),ReadIntensity<double>::base_a);
+  ut.test(c.similarity(d,"RAW"),2);
+
+  d.signal("RAW")[1] = r;
+  ut.test_approx(d.min_purity(0,1,"RAW"),1.0,0.0001);
+
   ut.end_test_set();
 }
 
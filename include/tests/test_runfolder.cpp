@@ -0,0 +1,86 @@
+/*
+    Swift (c) 2008 Genome Research Ltd.
+    Authors: Nava Whiteford and Tom Skelly (new@sgenomics.org ts6@sanger.ac.uk)
+
+    This file is part of Swift (http://swiftng.sourceforge.net).
+
+    Swift is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    Swift is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License
+    along with Swift.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "utf.h"
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sys/stat.h>
+#include "RunFolder.h"
+#include "test_runfolder.h"
+
+void test_runfolder(UnitTest &ut) {
+
+  ut.begin_test_set("RunFolder");
+
+  vector<int> values;
+  ut.test(RunFolder::parse_range("1-3,5,7-8",values),true);
+  ut.test(values.size(),static_cast<size_t>(6));
+  ut.test(values[3],5);
+  ut.test(values[5],8);
+  ut.test(RunFolder::parse_range("3-1",values),false);
+  ut.test(RunFolder::parse_range("1,x",values),false);
+  ut.test(RunFolder::tile_name(2,14),string("s_2_14"));
+
+  // Cycles 1, 2 and 10 of lane 1, tile 1 is complete, tile 2 is missing an image and tile 11 mustn't be
+  // taken for tile 1
+  string root = "test_runfolder.tmp";
+  mkdir(root.c_str(),0755);
+  mkdir((root + "/Images").c_str(),0755);
+  mkdir((root + "/Images/L001").c_str(),0755);
+  const char *cycles[] = {"C10.1","C2.1","C1.1"};
+  const char *bases[]  = {"a","c","g","t"};
+  vector<string> created;
+  for(int c=0;c<3;c++) {
+    string dir = root + "/Images/L001/" + cycles[c];
+    mkdir(dir.c_str(),0755);
+    created.push_back(dir);
+    for(int b=0;b<4;b++) {
+      const char *tiles[] = {"1","2","11"};
+      for(int t=0;t<3;t++) {
+        if((t == 1) && (c == 1) && (b == 2)) continue;
+        string file = dir + "/s_1_" + tiles[t] + "_" + bases[b] + "_" + cycles[c] + ".tif";
+        ofstream out(file.c_str());
+        created.push_back(file);
+      }
+    }
+  }
+
+  RunFolder run(vector<string>(1,root));
+  vector<vector<string> > images;
+  ut.test(run.tile_images(1,1,images),false);    // not scanned
+  ut.test(run.scan(1),true);
+  ut.test(run.scan(2),false);
+  ut.test(run.tile_images(1,1,images),true);
+  ut.test(images.size(),static_cast<size_t>(4));
+  ut.test(images[2].size(),static_cast<size_t>(3));
+  ut.test(images[2][0],root + "/Images/L001/C1.1/s_1_1_g_C1.1.tif");
+  ut.test(images[3][2],root + "/Images/L001/C10.1/s_1_1_t_C10.1.tif");
+  ut.test(run.tile_images(1,2,images),false);
+  ut.test(run.tile_images(1,11,images),true);
+  ut.test(run.tile_images(1,3,images),false);
+
+  for(size_t n=created.size();n>0;n--) remove(created[n-1].c_str());
+  remove((root + "/Images/L001").c_str());
+  remove((root + "/Images").c_str());
+  remove(root.c_str());
+
+  ut.end_test_set();
+}
@@ -20,12 +20,36 @@
 
 #include "utf.h"
 #include "test_readintensity.h"
+#include "test_clustertable.h"
+#include "test_quantile.h"
+#include "test_bandedmatrix.h"
+#include "test_outputbuffer.h"
+#include "test_bgzf.h"
+#include "test_fast4binary.h"
+#include "test_intensityfile.h"
+#include "test_gapipelineparser.h"
+#include "test_runfolder.h"
+#include "test_blockpipeline.h"
+#include "test_checkpoint.h"
+#include "test_arena.h"
 
 int main(void) {
 
   UnitTest ut("Testing ReadIntensity/Cluster and other Classes");
 
   test_readintensity(ut);  
+  test_clustertable(ut);
+  test_quantile(ut);
+  test_bandedmatrix(ut);
+  test_outputbuffer(ut);
+  test_bgzf(ut);
+  test_fast4binary(ut);
+  test_intensityfile(ut);
+  test_gapipelineparser(ut);
+  test_runfolder(ut);
+  test_blockpipeline(ut);
+  test_checkpoint(ut);
+  test_arena(ut);
   
   ut.test_report();
 
@@ -22,13 +22,27 @@
 #include <fstream>
 #include <vector>
 #include <iomanip>
+#include <algorithm>
+#include <cstdio>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <memory>
 #include "ImageAnalysis.h"
 #include "MockImageAnalysis.h"
 #include "CrossTalkCorrection.h"
 #include "PureCrossTalkCorrection.h"
 #include "PhasingCorrection.h"
 #include "Cluster.h"
+#include "IntensityFile.h"
+#include "ClusterTable.h"
+#include "GAPipelineParser.h"
+#include "RunFolder.h"
+#include "Checkpoint.h"
+#include "BlockPipeline.h"
+#include "Arena.h"
 #include "PrbBaseCaller.h"
+#include "PrbSequenceWriter.h"
 #include "FastaReader.h"
 #include "FastqWriter.h"
 #include "Fast4Writer.h"
@@ -41,6 +55,7 @@
 #include "Timetagger.h"
 #include "clusterfilter_makepositive.h"
 #include "clusterfilter_normalise.h"
+#include "clusterfilter_pipeline.h"
 #include "clusterfilter_normalisecycle.h"
 #include "clusterfilter_normalisecalls.h"
 // #include "clusterfilter_scalequality.h"
@@ -54,19 +69,68 @@ using namespace std;
 
 typedef float _precision;
 
+/// Orders cluster indices by the y of their positions
+struct position_y_less {
+  position_y_less(const vector<ClusterPosition<> > &positions_in) : positions(positions_in) {}
+  bool operator()(size_t a,size_t b) const { return positions[a].y < positions[b].y; }
+  const vector<ClusterPosition<> > &positions;
+};
+
+/// Stage boundaries a tile is checkpointed at, and can be resumed from. Each is after the stage it's named for.
+enum checkpoint_stage {
+  checkpoint_none,
+  checkpoint_analysis,       ///< RAW, as image analysis or the intfile gave it
+  checkpoint_crosstalk,      ///< POSITIVE, crosstalk corrected, normalised and made positive
+  checkpoint_phasing         ///< FINAL, phasing corrected
+};
+
 bool process_parameters (int argc, char **argv);
-void write_sequence_files(CommandLine *parms, vector<Cluster<_precision> > &clusters); 
+void open_sequence_files(CommandLine *parms, PrbSequenceWriter<_precision> &writer, bool keep_sequences);
+void write_intensity_file(const string &filename, const vector<Cluster<_precision> > &clusters, const SignalId &signalid, bool text, ClusterTable<_precision>::storage_type storage);
+bool text_intensity_format(CommandLine *parms, ClusterTable<_precision>::storage_type &storage);
+bool run_chunked(CommandLine *parms, const vector<string> &raw_files, MonotonicArena &tile_arena, const string &runxml);
+bool run_tile(CommandLine *parms, const vector<vector<string> > &images, MonotonicArena &tile_arena);
+void output_clusters(CommandLine *parms, vector<Cluster<_precision> > &clusters, ClusterFilter_Purity2<_precision> &pf_filter, PrbSequenceWriter<_precision> &writer, Reporting<_precision> &rep, ostream *signals_file, ostream *corrected_intout_file, MonotonicArena &tile_arena);
+bool run_batch(CommandLine *parms);
+void save_checkpoint(CommandLine *parms, int stage, const vector<Cluster<_precision> > &clusters, Checkpoint<_precision> &snapshot);
+int resume_checkpoint(CommandLine *parms, Checkpoint<_precision> &snapshot, vector<Cluster<_precision> > &clusters, vector<string> &raw_files);
 
 int main (int argc, char **argv) {
   
   cerr << "Swift " << SVN_REV << endl;
-  Timetagger m_tt;
 
   if(!process_parameters (argc, argv)) return 0;
   CommandLine *parms = CommandLine::Instance();
  
   cerr << parms->dump_settings();
 
+  Memstats mem_main ("swift_main");   // this will time the whole run
+
+  if(parms->is_set("batch")) return run_batch(parms) ? 0 : 1;
+
+  // The RAW signals and called sequences for this tile are bump allocated from tile_arena while a tile
+  // scope is open, and freed together when it goes out of scope. Scopes are only opened around the stages
+  // which create per tile data, temporaries built by the other stages would otherwise accumulate in the arena.
+  MonotonicArena tile_arena(16*1024*1024);
+
+  bool ok = false;
+  try {
+    ok = run_tile(parms,vector<vector<string> >(),tile_arena);
+  } catch(exception &e) {
+    cerr << "Tile failed: " << e.what() << endl;
+  }
+  return ok ? 0 : 1;
+}
+
+/// Runs a tile. Images are those given (lists for a, c, g and t, in cycle order), if there are none they're
+/// read from the img-? list files. Nothing allocated from the tile arena is in use on return, so it can be
+/// reset and reused for another tile. False if its input (intensities or checkpoint) couldn't be read.
+bool run_tile(CommandLine *parms,
+              const vector<vector<string> > &images,
+              MonotonicArena &tile_arena) {
+
+  Timetagger m_tt;
+
   bool have_reference = true;
   string reference_filename;
   if(parms->is_set("ref")) {
@@ -82,6 +146,8 @@ int main (int argc, char **argv) {
   string raw_signals_filename  (parms->get_parm("sigs"));
   string intout_filename  (parms->get_parm("intout"));
   string corrected_intout_filename  (parms->get_parm("corrected_intout"));
+  ClusterTable<_precision>::storage_type intensity_storage;
+  bool   intensity_text             (text_intensity_format(parms,intensity_storage));
   string report_filename       (parms->get_parm("report"));
   string pf_fastq              (parms->get_parm("pf"));
   string nonpf_fastq           (parms->get_parm("non-pf"));
@@ -102,92 +168,585 @@ int main (int argc, char **argv) {
   // int params_purity_length                  (parms->get_parm_as<int>("purity_length"));
   _precision params_purity_threshold            (parms->get_parm_as<double>("purity_threshold"));
 
-  Memstats mem_main ("swift_main");   // this will time the whole run
   Memstats mem_misc;                  // this will be started and stopped repeatedly
 
   vector<Cluster<_precision> > clusters;
   string runxml;
+
+  size_t max_clusters  (parms->get_parm_as<size_t>("max_clusters"));
+  size_t chunk_clusters(parms->get_parm_as<size_t>("chunk_clusters"));
+  string chunk_spill   (parms->get_parm("chunk_spill"));
+  vector<string> raw_files;    // RAW intensities of a tile too large to hold, run in chunks from these
+  vector<string> temp_files;   // and those of them written by this run
   
   runxml += parms->dump_settings_xml();
 
-  if(!parms->is_set("intfile")) {
-    // Perform image analysis
-
-    // Image analysis
-    mem_misc.start ("new image_analysis");
-    ImageAnalysis<_precision> *m_image_analyser = new ImageAnalysis<_precision>(images_a_filename,
-                                                                                images_c_filename,
-                                                                                images_g_filename,
-                                                                                images_t_filename);
+  // A tile resumed from a checkpoint skips the stages before it. The snapshot carries what they estimated,
+  // and the image analysis part of the report, on to the next checkpoint.
+  Checkpoint<_precision> snapshot;
+  int resumed = checkpoint_none;
+
+  // Clusters are loaded into the tile arena. A stack scope, so it comes off if loading throws (batch_worker
+  // carries on with the next tile on this thread).
+  {
+    ArenaScope<arena_tile> tile_scope(tile_arena);
+
+    if(parms->is_set("resume-from")) {
+      resumed = resume_checkpoint(parms,snapshot,clusters,raw_files);
+      if(resumed == checkpoint_none) return false;
+    } else if(!parms->is_set("intfile")) {
+      // Perform image analysis
+
+      // Image analysis
+      mem_misc.start ("new image_analysis");
+      unique_ptr<ImageAnalysis<_precision> > m_image_analyser;
+      if(images.size() > 0) m_image_analyser.reset(new ImageAnalysis<_precision>(images[0],images[1],images[2],images[3]));
+      else                  m_image_analyser.reset(new ImageAnalysis<_precision>(images_a_filename,
+                                                                                 images_c_filename,
+                                                                                 images_g_filename,
+                                                                                 images_t_filename));
  
-    mem_misc.start ("analyser->generate");           // this will stop the previous timer
-    m_image_analyser->generate(clusters);
-
-    runxml += m_image_analyser->offsets_xml;
+      // Tiles over max_clusters (or every tile, if chunk_clusters is set) are spilled to files and run in chunks
+      m_image_analyser->set_spill(chunk_spill,chunk_clusters > 0);
 
-    mem_misc.start ("delete m_image_analyser");      // this will stop the previous timer
-    delete m_image_analyser;
-    mem_misc.stop();
+      mem_misc.start ("analyser->generate");           // this will stop the previous timer
+      m_image_analyser->generate(clusters);
 
-  } else {
-    // Load data from int file
-    ifstream intfile(parms->get_parm("intfile").c_str());
+      snapshot.set_text("analysis_xml",m_image_analyser->offsets_xml);
 
-    for(int n=0;!intfile.eof();) {
-      string str;
-      getline(intfile,str);
+      if(m_image_analyser->spilled()) {
+        raw_files  = m_image_analyser->spill_files();
+        temp_files = raw_files;
+      }
 
-      if(!intfile.eof()) {
-        Cluster<_precision> c;
-        c.read_gapipelinestr("RAW",str);
+      mem_misc.start ("delete m_image_analyser");      // this will stop the previous timer
+      m_image_analyser.reset();
+      mem_misc.stop();
 
-        clusters.push_back(c);
-        if(n==0) cout << c;
-        n++;
+    } else {
+      // Load data from int file, binary or GAPipeline text
+      string intfile_filename = parms->get_parm("intfile");
+      if(IntensityFile<_precision>::is_intensity_file(intfile_filename)) {
+        size_t count=0,cycles=0;
+        IntensityFile<_precision>::dimensions(intfile_filename,count,cycles);
+        if((chunk_clusters > 0) || (count > max_clusters)) {
+          raw_files.push_back(intfile_filename);
+        } else {
+          if(!IntensityFile<_precision>::read(intfile_filename,clusters,"RAW")) {
+            cerr << "Could not read intensity file: " << intfile_filename << endl;
+            return false;
+          }
+          if(clusters.size() > 0) cout << clusters[0];
+        }
+      } else {
+        // Parsed in parallel from a mapping of the file, into a table and then the clusters
+        GAPipelineParser intfile(intfile_filename);
+        if(!intfile.open()) {
+          cerr << "Could not read intensity file: " << intfile_filename << endl;
+          return false;
+        } else if((chunk_clusters > 0) || (intfile.size() > max_clusters)) {
+          // Too large to hold, converted a chunk at a time to a binary intensity file
+          size_t chunk_size = (chunk_clusters > 0) ? chunk_clusters : max_clusters;
+          vector<string> parts;
+          bool written = true;
+          for(size_t first=0;written && (first<intfile.size());first+=chunk_size) {
+            ClusterTable<_precision> table;
+            intfile.read(table,"RAW",first,chunk_size);
+            parts.push_back(chunk_spill + ".text." + stringify(parts.size()));
+            written = IntensityFile<_precision>::write(parts.back(),table,"RAW");
+            if(!written) cerr << "Could not write intensity file: " << parts.back() << endl;
+          }
+          intfile.close();
+
+          string converted = chunk_spill + ".int";
+          if(written && !IntensityFile<_precision>::concatenate(converted,parts)) {
+            cerr << "Could not write intensity file: " << converted << endl;
+            written = false;
+          }
+          for(size_t n=0;n<parts.size();n++) remove(parts[n].c_str());
+          if(!written) {
+            remove(converted.c_str());
+            return false;
+          }
+
+          raw_files.push_back(converted);
+          temp_files.push_back(converted);
+        } else {
+          ClusterTable<_precision> table;
+          intfile.read(table,"RAW");
+          intfile.close();
+          table.to_clusters(clusters,vector<string>(1,"RAW"));
+        }
+        if(clusters.size() > 0) cout << clusters[0];
       }
     } 
-  } 
+  }
+
+  runxml += snapshot.text("analysis_xml");
+
+  if(raw_files.size() > 0) {
+    if(parms->is_set("checkpoint")) cout << m_tt.str() << "Tiles run in chunks aren't checkpointed" << endl;
+    bool ok = run_chunked(parms,raw_files,tile_arena,runxml);
+    for(size_t n=0;n<temp_files.size();n++) remove(temp_files[n].c_str());
+    if(ok) cout << m_tt.str() << "Swift complete, report file: " << report_filename << endl;
+    return ok;
+  }
   
-  if(parms->is_set("intout")) {
-    cout << m_tt.str() << "Saving intensity data" << endl;
-    ofstream intout_file(intout_filename.c_str());
-    for(vector<Cluster<_precision> >::iterator i=clusters.begin();i != clusters.end();i++) {
-      intout_file << (*i).dump_gapipelinestr("RAW");
-      intout_file << endl;
+  if(parms->is_set("checkpoint") && (resumed < checkpoint_analysis)) save_checkpoint(parms,checkpoint_analysis,clusters,snapshot);
+
+  if(resumed < checkpoint_crosstalk) {
+    if(parms->is_set("intout")) {
+      cout << m_tt.str() << "Saving intensity data" << endl;
+      write_intensity_file(intout_filename,clusters,"RAW",intensity_text,intensity_storage);
+    }
+
+    if(discard_offedge) {
+      cout << m_tt.str() << " Discarding clusters offedge, either any cluster not full on the tile in the first cycle, or as specified at commandline" << endl;
+      cout << m_tt.str() << " Note, this may not work correctly when processing from intensity files" << endl;
+
+      // Through out anything with a 0 anywhere in the first cycle.
+      ClusterFilter_FirstOffEdge<_precision> first_offedge("RAW");
+      first_offedge.process(clusters);
+
+      ClusterFilter_OffEdge<_precision> any_offedge("RAW",0);
+      any_offedge.process(clusters);
+    }
+
+    remove_invalid_clusters(clusters);
+
+    cout << m_tt.str() << " Clusters after removal: " << clusters.size() << endl;
+
+
+    if(gnuplot) {
+      cout << m_tt.str() << "Plotting uncorrected values" << endl;
+      crosstalk_plot(clusters,"RAW",0,ReadIntensity<>::base_a,ReadIntensity<>::base_t,"Uncorrected");
+      crosstalk_plot(clusters,"RAW",0,ReadIntensity<>::base_a,ReadIntensity<>::base_g,"Uncorrected");
+      crosstalk_plot(clusters,"RAW",0,ReadIntensity<>::base_c,ReadIntensity<>::base_a,"Uncorrected");
+      crosstalk_plot(clusters,"RAW",0,ReadIntensity<>::base_g,ReadIntensity<>::base_t,"Uncorrected");
+      crosstalk_plot(clusters,"RAW",0,ReadIntensity<>::base_t,ReadIntensity<>::base_c,"Uncorrected");
+      crosstalk_plot(clusters,"RAW",0,ReadIntensity<>::base_g,ReadIntensity<>::base_c,"Uncorrected");
     }
-    intout_file.close();
+
+    cout << m_tt.str() << "Clustered found: " << clusters.size() << endl;
+
+    // Crosstalk correction
+    CrossTalkCorrection<_precision> m_crosstalk_correction(0,
+                                                           20,
+                                                           parms->get_parm_as<float>("crosstalk_slope_threshold"),
+                                                           parms->get_parm_as<float>("crosstalk_lowerpercentile"),
+                                                           parms->get_parm_as<float>("crosstalk_upperpercentile"),
+                                                           parms->get_parm_as<int>  ("crosstalk_bin_size_required"),
+                                                           parms->get_parm_as<int>  ("crosstalk_bin_threshold"),
+                                                           parms->get_parm_as<int>  ("crosstalk_erode_clusters_per_bin"),
+                                                           parms->get_parm_as<int>  ("crosstalk_erode_num_bins"),
+                                                           "RAW",
+                                                           "TALK1");
+    mem_misc.start ("crosstalk correction");
+    m_crosstalk_correction.process(clusters);
+    snapshot.set_values("crosstalk",m_crosstalk_correction.correction());
+    mem_misc.stop();
+
+    mem_misc.start ("Clear RAW clusters");
+    clear_cluster_signal(clusters,"RAW");
+    mem_misc.stop();
+
+    // Pure Crosstalk correction
+    PureCrossTalkCorrection<_precision> m_pcrosstalk_correction(0,
+                                                                20,
+                                                                parms->get_parm_as<float>("purecrosstalk_slope_threshold"),
+                                                                parms->get_parm_as<int>("purecrosstalk_erode_num_bins"),
+                                                                parms->get_parm_as<int>("purecrosstalk_purity_highest_how_many"),
+                                                                "TALK1",
+                                                                "CTALK");
+    mem_misc.start ("pure crosstalk correction");
+    m_pcrosstalk_correction.process(clusters);
+    snapshot.set_values("purecrosstalk",m_pcrosstalk_correction.correction());
+    mem_misc.stop();
+
+
+    mem_misc.start ("Clear TALK1 clusters");
+    clear_cluster_signal(clusters,"TALK1");
+    mem_misc.stop();
+
+    // Set negative values to 0, normalise signals and make them positive. One pass gathers the normalisation
+    // medians and the minimum, a second applies all three to each cluster.
+    mem_misc.start ("negativezero, normalisation, makepositive");
+    ClusterPipeline<_precision,PipelineNegativeZero<_precision>,PipelineNormalise<_precision>,PipelineMakePositive<_precision> > m_pipeline(clusters,"CTALK","POSITIVE");
+    m_pipeline.process(clusters);
+    mem_misc.stop();
+
+    if(gnuplot) {
+      ClusterFilter_NegativeZero<_precision> m_clusterfilter_negativezero("CTALK","CTALK");
+      m_clusterfilter_negativezero.process(clusters);
+
+      cout << m_tt.str() << "Plotting corrected values" << endl;
+      crosstalk_plot(clusters,"CTALK",0,ReadIntensity<>::base_a,ReadIntensity<>::base_t,"Corrected");
+      crosstalk_plot(clusters,"CTALK",0,ReadIntensity<>::base_a,ReadIntensity<>::base_g,"Corrected");
+      crosstalk_plot(clusters,"CTALK",0,ReadIntensity<>::base_c,ReadIntensity<>::base_a,"Corrected");
+      crosstalk_plot(clusters,"CTALK",0,ReadIntensity<>::base_g,ReadIntensity<>::base_t,"Corrected");
+      crosstalk_plot(clusters,"CTALK",0,ReadIntensity<>::base_t,ReadIntensity<>::base_c,"Corrected");
+      crosstalk_plot(clusters,"CTALK",0,ReadIntensity<>::base_g,ReadIntensity<>::base_c,"Corrected");
+
+      // Wait so the user can get a look at the crosstalk plots
+      cout << m_tt.str() << endl << "Press ENTER to continue..." << endl;
+
+      std::cin.clear();
+      std::cin.ignore(std::cin.rdbuf()->in_avail());
+      std::cin.get();
+    }
+
+    mem_misc.start ("clear CTALK");
+    clear_cluster_signal(clusters,"CTALK");
+    mem_misc.stop();
+
+    if(parms->is_set("checkpoint")) save_checkpoint(parms,checkpoint_crosstalk,clusters,snapshot);
   }
 
-  if(discard_offedge) {
-    cout << m_tt.str() << " Discarding clusters offedge, either any cluster not full on the tile in the first cycle, or as specified at commandline" << endl;
-    cout << m_tt.str() << " Note, this may not work correctly when processing from intensity files" << endl;
+  if(resumed < checkpoint_phasing) {
+    string sourceid = "POSITIVE";
+    string targetid = "PHASE";
 
-    // Through out anything with a 0 anywhere in the first cycle.
-    ClusterFilter_FirstOffEdge<_precision> first_offedge("RAW");
-    first_offedge.process(clusters);
+    if(parms->get_parm("phasing_solver") == "matrix") {
+      // One direct solve replaces the iterations
+      PhasingCorrection<_precision> m_phasing_correction(parms->get_parm_as<float>("phasing_threshold"),
+                                                         parms->get_parm_as<float>("phasing_window"),
+                                                         sourceid,
+                                                         "FINAL");
+      m_phasing_correction.process_matrix(clusters);
+      snapshot.set_values("phasing.1.forward",m_phasing_correction.estimates(true));
+      snapshot.set_values("phasing.1.reverse",m_phasing_correction.estimates(false));
+
+      mem_misc.start ("clear in phasing: " + sourceid);
+      clear_cluster_signal(clusters,sourceid);
+      mem_misc.stop();
+    } else {
+      int phasing_iterations = parms->get_parm_as<int>("phasing_iterations");
+      for(int n=0;n<phasing_iterations;n++) {
     
-    ClusterFilter_OffEdge<_precision> any_offedge("RAW",0);
-    any_offedge.process(clusters);
+        if(n==(phasing_iterations-1)) targetid= "FINAL";
+    
+        PhasingCorrection<_precision> m_phasing_correction(parms->get_parm_as<float>("phasing_threshold"),
+                                                           parms->get_parm_as<float>("phasing_window"),
+                                                           sourceid,
+                                                           targetid);
+        m_phasing_correction.process(clusters);
+        snapshot.set_values("phasing." + stringify(n+1) + ".forward",m_phasing_correction.estimates(true));
+        snapshot.set_values("phasing." + stringify(n+1) + ".reverse",m_phasing_correction.estimates(false));
+    
+        if(sourceid.compare(targetid) != 0) {
+          mem_misc.start ("clear in phasing: " + sourceid);
+          clear_cluster_signal(clusters,sourceid);
+          mem_misc.stop();
+        }
+    
+        sourceid=targetid;
+        targetid=sourceid;
+      }
+    }
+
+    if(parms->is_set("checkpoint")) save_checkpoint(parms,checkpoint_phasing,clusters,snapshot);
   }
+ 
+  // The signal chain is complete, free the buffer the stages were alternating with
+  mem_misc.start ("release spare signal buffers");
+  release_cluster_spare(clusters);
+  mem_misc.stop();
+
+  clear_cluster_validity(clusters,true);
 
+  // Remove optical duplicates
+  cout << m_tt.str() << "Clusters, pre-optical duplicates removed: " << clusters.size() << endl;
+  ClusterFilter_OpticalDuplicates<_precision> filter_duplicates("FINAL",params_optical_duplicates_distance,params_optical_duplicates_mismatches);
+  mem_misc.start ("filter_duplicates");
+  filter_duplicates.process(clusters);
+  mem_misc.start ("remove_invalid_clusters");
   remove_invalid_clusters(clusters);
+  mem_misc.stop();
+  cout << m_tt.str() << "Clusters, optical duplicates removed: " << clusters.size() << endl;
   
-  cout << m_tt.str() << " Clusters after removal: " << clusters.size() << endl;
+  ofstream signals_file;
+  if(parms->is_set("sigs")) {
+    cout << m_tt.str() << "Saving run data" << endl;
+    signals_file.open(raw_signals_filename.c_str());
+  }
+  
+  // Binary intensity files are written whole, text ones as the clusters are output
+  ofstream corrected_intout_file;
+  if(parms->is_set("corrected_intout")) {
+    cout << m_tt.str() << "Saving intensity data" << endl;
+    if(intensity_text) corrected_intout_file.open(corrected_intout_filename.c_str());
+                  else write_intensity_file(corrected_intout_filename,clusters,"FINAL",false,intensity_storage);
+  }
 
+  // Perform purity filtering
+  //ClusterFilter_PurityAverage<_precision> pf_filter(params_purity_threshold,params_purity_length,"FINAL");
+  ClusterFilter_Purity2<_precision> pf_filter(params_purity_length,params_purity_threshold,"FINAL");
+  // ClusterFilter_PurityHighest<_precision> pf_filter(clusters,12,90000,"FINAL");
+
+  int pair_break=-1;
+  if(parms->is_set("pair_break")) pair_break = parms->get_parm_as<int>("pair_break") - 1;   // 0-based index
+
+  PrbSequenceWriter<_precision> writer("FINAL",tiletag,pair_break);
+  open_sequence_files(parms,writer,have_reference);
+
+  Reporting<_precision> rep(have_reference,
+                            reference_filename,
+                            parms->is_set("pair_break"),
+                            (pair_break < 0) ? 0 : pair_break,
+                            parms->get_parm_as<size_t>("align_every"),
+                            tiletag
+                           );
+
+  // Calls are only kept in the clusters when Reporting aligns them
+  mem_misc.start ("purity filter, basecall, write sequence files and generate stats for reports");
+  output_clusters(parms,
+                  clusters,
+                  pf_filter,
+                  writer,
+                  rep,
+                  signals_file.is_open() ? &signals_file : 0,
+                  corrected_intout_file.is_open() ? &corrected_intout_file : 0,
+                  tile_arena);
+  writer.close();
+  rep.finish();
+  signals_file.close();
+  corrected_intout_file.close();
+
+  mem_misc.start ("write reports");
+
+
+  rep.write_report_file(report_filename,runxml);
+  rep.write_report_human(cerr);
+  mem_misc.stop();
+  cout << m_tt.str() << "Swift complete, report file: " << report_filename << endl;
+  return true;
+}
+
+/// A tile of a batch, and its images
+struct batch_tile {
+  int lane;
+  int tile;
+  vector<vector<string> > images;   ///< a, c, g, t lists in cycle order
+};
+
+/// Takes tiles from the batch until there are none left. Each worker keeps one tile arena, reused by every
+/// tile it runs, and gives its tiles their own output file names (the tile name is added to each). Tiles
+/// which fail are counted in failed.
+void batch_worker(CommandLine *parms,
+                  const vector<batch_tile> &tiles,
+                  atomic<size_t> &next,
+                  atomic<size_t> &failed,
+                  int tile_threads) {
+
+  #if defined(_OPENMP)
+    omp_set_num_threads(tile_threads);
+  #endif
+
+  string output_directory = parms->get_parm("batch_output");
+  string tag              = parms->get_parm("tag");
+  string report           = parms->is_set("report") ? parms->get_parm("report") : string("report.xml");
+  string chunk_spill      = parms->get_parm("chunk_spill");
+
+  const char *outputs[] = {"fastq","fast4","sigs","intout","corrected_intout","checkpoint","resume-from"};
+  vector<string> output_values;
+  for(size_t n=0;n<sizeof(outputs)/sizeof(outputs[0]);n++) output_values.push_back(parms->get_parm(outputs[n]));
+
+  MonotonicArena tile_arena(16*1024*1024);
+
+  for(size_t t=next++;t<tiles.size();t=next++) {
+    string name   = RunFolder::tile_name(tiles[t].lane,tiles[t].tile);
+    string prefix = output_directory + "/" + name + ".";
+
+    parms->clear_thread_parms();
+    parms->set_thread_parm("tag"        ,(tag.size() > 0) ? tag + "_" + name : name);
+    parms->set_thread_parm("report"     ,prefix + report);
+    parms->set_thread_parm("chunk_spill",prefix + chunk_spill);
+    parms->set_thread_parm("gnuplot"    ,"0");   // it waits for the user
+    for(size_t n=0;n<output_values.size();n++) {
+      if(output_values[n].size() > 0) parms->set_thread_parm(outputs[n],prefix + output_values[n]);
+    }
+
+    // A tile which fails (an unreadable image, say) doesn't stop the others
+    try {
+      if(!run_tile(parms,tiles[t].images,tile_arena)) {
+        cerr << "Tile " << name << " failed" << endl;
+        failed++;
+      }
+    } catch(exception &e) {
+      cerr << "Tile " << name << " failed: " << e.what() << endl;
+      failed++;
+    }
+    tile_arena.reset();
+  }
+
+  parms->clear_thread_parms();
+}
+
+/// Runs the tiles of a run folder (a pair of them for paired runs) in lanes batch_lanes and tiles batch_tiles.
+///
+/// Tiles run on a pool of threads, as many at once as there are cores, or as fit in batch_memory at
+/// batch_tile_memory each if that's fewer. Each gets an equal share of the cores for its own parallel
+/// stages, so the stages which aren't parallel overlap with other tiles. Tiles share the process: FFT
+/// plans are measured once per size, the parameters are parsed once, and worker arenas are reused.
+/// False if there were no tiles, or any of them failed (the rest are still run).
+bool run_batch(CommandLine *parms) {
+
+  Timetagger m_tt;
+
+  vector<string> folders;
+  string folder_list = parms->get_parm("batch");
+  for(size_t start=0;start <= folder_list.size();) {
+    size_t end = folder_list.find(',',start);
+    if(end == string::npos) end = folder_list.size();
+    if(end > start) folders.push_back(folder_list.substr(start,end-start));
+    start = end+1;
+  }
+
+  vector<int> lanes;
+  vector<int> tile_numbers;
+  if(!RunFolder::parse_range(parms->get_parm("batch_lanes"),lanes) ||
+     !RunFolder::parse_range(parms->get_parm("batch_tiles"),tile_numbers)) {
+    cerr << "Could not parse batch_lanes or batch_tiles, expected for example 1-8 or 1,3,5-7" << endl;
+    return false;
+  }
+
+  RunFolder run(folders);
+  vector<batch_tile> tiles;
+  for(size_t l=0;l<lanes.size();l++) {
+    if(!run.scan(lanes[l])) {
+      cerr << "No cycle directories for lane " << lanes[l] << " in every run folder, lane skipped" << endl;
+      continue;
+    }
+
+    for(size_t t=0;t<tile_numbers.size();t++) {
+      batch_tile b;
+      b.lane = lanes[l];
+      b.tile = tile_numbers[t];
+      if(run.tile_images(b.lane,b.tile,b.images)) tiles.push_back(b);
+      else cerr << "No complete set of images for tile " << RunFolder::tile_name(b.lane,b.tile) << ", tile skipped" << endl;
+    }
+  }
+
+  if(tiles.empty()) {
+    cerr << "No tiles to process" << endl;
+    return false;
+  }
+
+  size_t cores = parms->get_parm_as<size_t>("batch_threads");
+  if(cores == 0) cores = thread::hardware_concurrency();
+  if(cores == 0) cores = 1;
+
+  size_t concurrent = cores;
+  size_t memory      = parms->get_parm_as<size_t>("batch_memory");
+  size_t tile_memory = parms->get_parm_as<size_t>("batch_tile_memory");
+  if((memory > 0) && (tile_memory > 0) && (memory/tile_memory < concurrent)) concurrent = memory/tile_memory;
+  if(concurrent > tiles.size()) concurrent = tiles.size();
+  if(concurrent == 0) concurrent = 1;
+
+  int tile_threads = cores/concurrent;
+  if(tile_threads < 1) tile_threads = 1;
+
+  cout << m_tt.str() << "Batch of " << tiles.size() << " tiles, " << concurrent << " at a time with "
+       << tile_threads << " threads each" << endl;
+
+  atomic<size_t> next(0);
+  atomic<size_t> failed(0);
+  vector<thread> workers;
+  for(size_t n=0;n<concurrent;n++) workers.push_back(thread(batch_worker,parms,cref(tiles),ref(next),ref(failed),tile_threads));
+  for(size_t n=0;n<workers.size();n++) workers[n].join();
+
+  if(failed > 0) {
+    cerr << failed << " of " << tiles.size() << " tiles failed" << endl;
+    return false;
+  }
+  cout << m_tt.str() << "Batch complete" << endl;
+  return true;
+}
+
+/// Runs a tile too large to hold in memory, from the RAW intensities in raw_files (read one after another,
+/// each holding consecutive cycles of every cluster).
+///
+/// Crosstalk, normalisation and phasing are estimated on a sample spread evenly over the tile, then the tile
+/// is corrected, called and written a chunk at a time with those estimates. Chunks are stripes of the tile
+/// in y, each read with a margin of the optical duplicates window on either side so that duplicates are
+/// found as they would be over the whole tile; only the clusters of the stripe itself are kept. Reads are
+/// written stripe by stripe, rather than in the order of the intensities.
+///
+/// False if an intensity file can't be read (the tile is abandoned) or the binary intensity output can't be written.
+bool run_chunked(CommandLine *parms,
+                 const vector<string> &raw_files,
+                 MonotonicArena &tile_arena,
+                 const string &runxml) {
+
+  Timetagger m_tt;
+  Memstats mem_misc;
+
+  bool have_reference = parms->is_set("ref");
+  string reference_filename    (parms->get_parm("ref"));
+  string raw_signals_filename  (parms->get_parm("sigs"));
+  string intout_filename       (parms->get_parm("intout"));
+  string corrected_intout_filename (parms->get_parm("corrected_intout"));
+  ClusterTable<_precision>::storage_type intensity_storage;
+  bool   intensity_text        (text_intensity_format(parms,intensity_storage));
+  string report_filename       (parms->get_parm("report"));
+  string tiletag               (parms->get_parm("tag"));
+  bool   gnuplot               (parms->get_parm("gnuplot") == string("1"));
+  bool   discard_offedge       (parms->get_parm("discard_offedge") == string("1"));
+  int    params_optical_duplicates_distance   (parms->get_parm_as<int>("optical_duplicates_distance"));
+  int    params_optical_duplicates_mismatches (parms->get_parm_as<int>("optical_duplicates_mismatches"));
+  size_t params_purity_length                 (parms->get_parm_as<size_t>("purity_length"));
+  _precision params_purity_threshold          (parms->get_parm_as<double>("purity_threshold"));
+
+  size_t chunk_size  = parms->get_parm_as<size_t>("chunk_clusters");
+  if(chunk_size == 0) chunk_size = parms->get_parm_as<size_t>("max_clusters");
+  size_t sample_size = parms->get_parm_as<size_t>("chunk_sample");
+  if(sample_size == 0) sample_size = chunk_size;
+
+  vector<ClusterPosition<> > positions;
+  if(!IntensityFile<_precision>::read_positions(raw_files[0],positions)) {
+    cerr << "Could not read intensity file: " << raw_files[0] << endl;
+    return false;
+  }
+  size_t count = positions.size();
+  cout << m_tt.str() << "Processing " << count << " clusters in chunks of " << chunk_size << endl;
+
+  // 1. Sample, every stride-th cluster
+  size_t stride = (count+sample_size-1)/sample_size;
+  if(stride == 0) stride = 1;
+  vector<size_t> sample_indices;
+  for(size_t n=0;n<count;n+=stride) sample_indices.push_back(n);
+
+  vector<Cluster<_precision> > sample;
+  {
+    ArenaScope<arena_tile> tile_scope(tile_arena);
+    for(size_t f=0;f<raw_files.size();f++) {
+      if(!IntensityFile<_precision>::read(raw_files[f],sample_indices,sample,"RAW")) {
+        cerr << "Could not read intensity file: " << raw_files[f] << endl;
+        return false;
+      }
+    }
+  }
+
+  if(discard_offedge) {
+    ClusterFilter_FirstOffEdge<_precision> first_offedge("RAW");
+    first_offedge.process(sample);
+    ClusterFilter_OffEdge<_precision> any_offedge("RAW",0);
+    any_offedge.process(sample);
+  }
+  remove_invalid_clusters(sample);
+  cout << m_tt.str() << "Estimating corrections from a sample of " << sample.size() << " clusters" << endl;
 
   if(gnuplot) {
     cout << m_tt.str() << "Plotting uncorrected values" << endl;
-    crosstalk_plot(clusters,"RAW",0,ReadIntensity<>::base_a,ReadIntensity<>::base_t,"Uncorrected");
-    crosstalk_plot(clusters,"RAW",0,ReadIntensity<>::base_a,ReadIntensity<>::base_g,"Uncorrected");
-    crosstalk_plot(clusters,"RAW",0,ReadIntensity<>::base_c,ReadIntensity<>::base_a,"Uncorrected");
-    crosstalk_plot(clusters,"RAW",0,ReadIntensity<>::base_g,ReadIntensity<>::base_t,"Uncorrected");
-    crosstalk_plot(clusters,"RAW",0,ReadIntensity<>::base_t,ReadIntensity<>::base_c,"Uncorrected");
-    crosstalk_plot(clusters,"RAW",0,ReadIntensity<>::base_g,ReadIntensity<>::base_c,"Uncorrected");
+    crosstalk_plot(sample,"RAW",0,ReadIntensity<>::base_a,ReadIntensity<>::base_t,"Uncorrected");
+    crosstalk_plot(sample,"RAW",0,ReadIntensity<>::base_a,ReadIntensity<>::base_g,"Uncorrected");
+    crosstalk_plot(sample,"RAW",0,ReadIntensity<>::base_c,ReadIntensity<>::base_a,"Uncorrected");
+    crosstalk_plot(sample,"RAW",0,ReadIntensity<>::base_g,ReadIntensity<>::base_t,"Uncorrected");
+    crosstalk_plot(sample,"RAW",0,ReadIntensity<>::base_t,ReadIntensity<>::base_c,"Uncorrected");
+    crosstalk_plot(sample,"RAW",0,ReadIntensity<>::base_g,ReadIntensity<>::base_c,"Uncorrected");
   }
 
-  cout << m_tt.str() << "Clustered found: " << clusters.size() << endl;
-
-  // Crosstalk correction
+  // 2. Estimate each stage on the sample, as the tile would be run in memory
   CrossTalkCorrection<_precision> m_crosstalk_correction(0,
                                                          20,
                                                          parms->get_parm_as<float>("crosstalk_slope_threshold"),
@@ -200,14 +759,9 @@ int main (int argc, char **argv) {
                                                          "RAW",
                                                          "TALK1");
   mem_misc.start ("crosstalk correction");
-  m_crosstalk_correction.process(clusters);
-  mem_misc.stop();
-  
-  mem_misc.start ("Clear RAW clusters");
-  clear_cluster_signal(clusters,"RAW");
-  mem_misc.stop();
-  
-  // Pure Crosstalk correction
+  m_crosstalk_correction.process(sample);
+  clear_cluster_signal(sample,"RAW");
+
   PureCrossTalkCorrection<_precision> m_pcrosstalk_correction(0,
                                                               20,
                                                               parms->get_parm_as<float>("purecrosstalk_slope_threshold"),
@@ -216,292 +770,435 @@ int main (int argc, char **argv) {
                                                               "TALK1",
                                                               "CTALK");
   mem_misc.start ("pure crosstalk correction");
-  m_pcrosstalk_correction.process(clusters);
-  mem_misc.stop();
-  
+  m_pcrosstalk_correction.process(sample);
+  clear_cluster_signal(sample,"TALK1");
 
-  mem_misc.start ("Clear TALK1 clusters");
-  clear_cluster_signal(clusters,"TALK1");
-  mem_misc.stop();
-  
-  // Set negative values to 0
-  ClusterFilter_NegativeZero<_precision> m_clusterfilter_negativezero("CTALK","CTALK");
-  mem_misc.start ("negativezero");
-  m_clusterfilter_negativezero.process(clusters);
+  mem_misc.start ("negativezero, normalisation, makepositive");
+  ClusterPipeline<_precision,PipelineNegativeZero<_precision>,PipelineNormalise<_precision>,PipelineMakePositive<_precision> > m_pipeline(sample,"CTALK","POSITIVE");
+  m_pipeline.process(sample);
   mem_misc.stop();
 
-  // Normalise signals 
-  mem_misc.start ("normalisation");
-  ClusterFilter_Normalise<_precision> m_normalisation(clusters,"CTALK","NORMALISED");
-  mem_misc.start ("normalisation.process");
-  m_normalisation.process(clusters);
-
-  
   if(gnuplot) {
+    ClusterFilter_NegativeZero<_precision> m_clusterfilter_negativezero("CTALK","CTALK");
+    m_clusterfilter_negativezero.process(sample);
+
     cout << m_tt.str() << "Plotting corrected values" << endl;
-    crosstalk_plot(clusters,"CTALK",0,ReadIntensity<>::base_a,ReadIntensity<>::base_t,"Corrected");
-    crosstalk_plot(clusters,"CTALK",0,ReadIntensity<>::base_a,ReadIntensity<>::base_g,"Corrected");
-    crosstalk_plot(clusters,"CTALK",0,ReadIntensity<>::base_c,ReadIntensity<>::base_a,"Corrected");
-    crosstalk_plot(clusters,"CTALK",0,ReadIntensity<>::base_g,ReadIntensity<>::base_t,"Corrected");
-    crosstalk_plot(clusters,"CTALK",0,ReadIntensity<>::base_t,ReadIntensity<>::base_c,"Corrected");
-    crosstalk_plot(clusters,"CTALK",0,ReadIntensity<>::base_g,ReadIntensity<>::base_c,"Corrected");
-  
-    // Wait so the user can get a look at the crosstalk plots
+    crosstalk_plot(sample,"CTALK",0,ReadIntensity<>::base_a,ReadIntensity<>::base_t,"Corrected");
+    crosstalk_plot(sample,"CTALK",0,ReadIntensity<>::base_a,ReadIntensity<>::base_g,"Corrected");
+    crosstalk_plot(sample,"CTALK",0,ReadIntensity<>::base_c,ReadIntensity<>::base_a,"Corrected");
+    crosstalk_plot(sample,"CTALK",0,ReadIntensity<>::base_g,ReadIntensity<>::base_t,"Corrected");
+    crosstalk_plot(sample,"CTALK",0,ReadIntensity<>::base_t,ReadIntensity<>::base_c,"Corrected");
+    crosstalk_plot(sample,"CTALK",0,ReadIntensity<>::base_g,ReadIntensity<>::base_c,"Corrected");
+
     cout << m_tt.str() << endl << "Press ENTER to continue..." << endl;
 
     std::cin.clear();
     std::cin.ignore(std::cin.rdbuf()->in_avail());
     std::cin.get();
   }
-  
-  mem_misc.start ("clear CTALK");
-  clear_cluster_signal(clusters,"CTALK");
-  mem_misc.stop();
-
-  ClusterFilter_MakePositive<_precision> clusterfilter_makepositive(clusters,"NORMALISED","POSITIVE");
-  mem_misc.start ("makepositive");
-  clusterfilter_makepositive.process(clusters);
-  mem_misc.start ("clear NORMALISED");
-  clear_cluster_signal(clusters,"NORMALISED");
-  mem_misc.stop();
+  clear_cluster_signal(sample,"CTALK");
 
+  // One phasing correction per iteration, each estimated on the output of the one before
+  bool phasing_matrix = (parms->get_parm("phasing_solver") == "matrix");
+  vector<unique_ptr<PhasingCorrection<_precision> > > phasing;
   string sourceid = "POSITIVE";
   string targetid = "PHASE";
-
-  int phasing_iterations = parms->get_parm_as<int>("phasing_iterations");
+  int phasing_iterations = phasing_matrix ? 1 : parms->get_parm_as<int>("phasing_iterations");
   for(int n=0;n<phasing_iterations;n++) {
-    
     if(n==(phasing_iterations-1)) targetid= "FINAL";
-    
-    PhasingCorrection<_precision> m_phasing_correction(parms->get_parm_as<float>("phasing_threshold"),
-                                                       parms->get_parm_as<float>("phasing_window"),
-                                                       sourceid,
-                                                       targetid);
-    m_phasing_correction.process(clusters);
-    
-    if(sourceid.compare(targetid) != 0) {
-      mem_misc.start ("clear in phasing: " + sourceid);
-      clear_cluster_signal(clusters,sourceid);
-      mem_misc.stop();
-    }
-    
+
+    phasing.push_back(unique_ptr<PhasingCorrection<_precision> >(new PhasingCorrection<_precision>(parms->get_parm_as<float>("phasing_threshold"),
+                                                                                                    parms->get_parm_as<float>("phasing_window"),
+                                                                                                    sourceid,
+                                                                                                    targetid)));
+    if(phasing_matrix) phasing.back()->process_matrix(sample);
+    else               phasing.back()->process(sample);
+
+    if(sourceid.compare(targetid) != 0) clear_cluster_signal(sample,sourceid);
+
     sourceid=targetid;
     targetid=sourceid;
   }
- 
-  clear_cluster_validity(clusters,true);
 
-  // Remove optical duplicates
-  cout << m_tt.str() << "Clusters, pre-optical duplicates removed: " << clusters.size() << endl;
-  ClusterFilter_OpticalDuplicates<_precision> filter_duplicates("FINAL",params_optical_duplicates_distance,params_optical_duplicates_mismatches);
-  mem_misc.start ("filter_duplicates");
-  filter_duplicates.process(clusters);
-  mem_misc.start ("remove_invalid_clusters");
-  remove_invalid_clusters(clusters);
-  mem_misc.stop();
-  cout << m_tt.str() << "Clusters, optical duplicates removed: " << clusters.size() << endl;
-  
-  if(parms->is_set("sigs")) {
-    cout << m_tt.str() << "Saving run data" << endl;
-    ofstream signals_file(raw_signals_filename.c_str());
-    for(vector<Cluster<_precision> >::iterator i=clusters.begin();i != clusters.end();i++) {
-      signals_file << (*i);
-    }
-    signals_file.close();
-  }
-  
-  if(parms->is_set("corrected_intout")) {
-    cout << m_tt.str() << "Saving intensity data" << endl;
-    ofstream intout_file(corrected_intout_filename.c_str());
-    for(vector<Cluster<_precision> >::iterator i=clusters.begin();i != clusters.end();i++) {
-      intout_file << (*i).dump_gapipelinestr("FINAL");
-      intout_file << endl;
-    }
-    intout_file.close();
-  }
+  vector<Cluster<_precision> >().swap(sample);
+  tile_arena.reset();
 
-  // Perform purity filtering
-  //ClusterFilter_PurityAverage<_precision> pf_filter(params_purity_threshold,params_purity_length,"FINAL");
-  ClusterFilter_Purity2<_precision> pf_filter(params_purity_length,params_purity_threshold,"FINAL");
-  // ClusterFilter_PurityHighest<_precision> pf_filter(clusters,12,90000,"FINAL");
-  pf_filter.process(clusters);
+  // 3. Chunks, stripes of chunk_size clusters in y with a margin of the duplicates window
+  vector<size_t> by_y(count);
+  for(size_t n=0;n<count;n++) by_y[n] = n;
+  stable_sort(by_y.begin(),by_y.end(),position_y_less(positions));
 
-  mem_misc.start ("basecalling");
-  PrbBaseCaller<_precision> m_base_caller_phas("FINAL","FINAL");
-  m_base_caller_phas.process(clusters,false);
- 
-  mem_misc.stop();
+  vector<int> sorted_y(count);
+  for(size_t n=0;n<count;n++) sorted_y[n] = positions[by_y[n]].y;
 
+  ClusterFilter_OpticalDuplicates<_precision> filter_duplicates("FINAL",params_optical_duplicates_distance,params_optical_duplicates_mismatches);
+  ClusterFilter_Purity2<_precision> pf_filter(params_purity_length,params_purity_threshold,"FINAL");
 
-  write_sequence_files(parms,clusters);
-  
-  mem_misc.start ("generate stats for reports");   // constructor generates stats
-  
-  int pair_break=0;
+  int pair_break=-1;
   if(parms->is_set("pair_break")) pair_break = parms->get_parm_as<int>("pair_break") - 1;   // 0-based index
 
-  Reporting<_precision> rep(clusters,
-                            have_reference,
+  PrbSequenceWriter<_precision> writer("FINAL",tiletag,pair_break);
+  open_sequence_files(parms,writer,have_reference);
+
+  Reporting<_precision> rep(have_reference,
                             reference_filename,
                             parms->is_set("pair_break"),
-                            pair_break,
+                            (pair_break < 0) ? 0 : pair_break,
                             parms->get_parm_as<size_t>("align_every"),
                             tiletag
                            );
-  mem_misc.start ("write reports");
 
+  ofstream signals_file;
+  if(parms->is_set("sigs")) signals_file.open(raw_signals_filename.c_str());
+
+  // Text intensity files are appended to, binary ones are written in parts and joined at the end
+  ofstream intout_file;
+  ofstream corrected_intout_file;
+  if(parms->is_set("intout")           && intensity_text) intout_file.open(intout_filename.c_str());
+  if(parms->is_set("corrected_intout") && intensity_text) corrected_intout_file.open(corrected_intout_filename.c_str());
+  vector<string> intout_parts;
+  vector<string> corrected_intout_parts;
+
+  size_t total_kept=0;
+  for(size_t first=0;first<count;first+=chunk_size) {
+    size_t last = (first+chunk_size < count) ? first+chunk_size : count;
+
+    size_t lo = lower_bound(sorted_y.begin(),sorted_y.end(),sorted_y[first]  -params_optical_duplicates_distance) - sorted_y.begin();
+    size_t hi = upper_bound(sorted_y.begin(),sorted_y.end(),sorted_y[last-1]+params_optical_duplicates_distance) - sorted_y.begin();
+
+    // In intensity file order, so clusters sharing a position are seen in the order they would be over the tile
+    vector<pair<size_t,char> > members;
+    for(size_t n=lo;n<hi;n++) members.push_back(make_pair(by_y[n],static_cast<char>((n >= first) && (n < last))));
+    sort(members.begin(),members.end());
+
+    vector<size_t> indices(members.size());
+    vector<char>   core(members.size());
+    for(size_t n=0;n<members.size();n++) { indices[n] = members[n].first; core[n] = members[n].second; }
+
+    // Read into a table, so the stages up to crosstalk correction run a cycle at a time over the stripe
+    ClusterTable<_precision> stripe;
+    for(size_t f=0;f<raw_files.size();f++) {
+      if(!IntensityFile<_precision>::read(raw_files[f],indices,stripe,"RAW")) {
+        cerr << "Could not read intensity file: " << raw_files[f] << endl;
+        for(size_t n=0;n<intout_parts.size();n++) remove(intout_parts[n].c_str());
+        for(size_t n=0;n<corrected_intout_parts.size();n++) remove(corrected_intout_parts[n].c_str());
+        return false;
+      }
+    }
+
+    if(parms->is_set("intout")) {
+      ClusterTable<_precision> core_stripe(stripe);
+      for(size_t n=0;n<core.size();n++) core_stripe.set_valid(n,core[n] != 0);
+      core_stripe.remove_invalid();
+      if(intensity_text) {
+        vector<Cluster<_precision> > core_clusters;
+        core_stripe.to_clusters(core_clusters,vector<string>(1,"RAW"));
+        for(size_t n=0;n<core_clusters.size();n++) intout_file << core_clusters[n].dump_gapipelinestr("RAW") << endl;
+      } else {
+        intout_parts.push_back(intout_filename + ".part." + stringify(intout_parts.size()));
+        core_stripe.archive_signal("RAW",intensity_storage);
+        if(!IntensityFile<_precision>::write(intout_parts.back(),core_stripe,"RAW")) cerr << "Could not write intensity file: " << intout_parts.back() << endl;
+      }
+    }
+
+    if(discard_offedge) {
+      ClusterFilter_FirstOffEdge<_precision> first_offedge("RAW");
+      first_offedge.process(stripe);
+      ClusterFilter_OffEdge<_precision> any_offedge("RAW",0);
+      any_offedge.process(stripe);
+    }
+    stripe.remove_invalid(core);
+
+    m_crosstalk_correction.apply(stripe);
+    stripe.delete_signal("RAW");
+
+    // Without a correction there's no TALK1, as for clusters
+    vector<string> talk1;
+    if(stripe.has_signal("TALK1")) talk1.push_back("TALK1");
+
+    vector<Cluster<_precision> > chunk;
+    {
+      ArenaScope<arena_tile> tile_scope(tile_arena);
+      stripe.to_clusters(chunk,talk1);
+    }
+    stripe = ClusterTable<_precision>();
+
+    m_pcrosstalk_correction.apply(chunk);
+    clear_cluster_signal(chunk,"TALK1");
+    m_pipeline.process(chunk);
+    clear_cluster_signal(chunk,"CTALK");
+
+    sourceid = "POSITIVE";
+    targetid = "PHASE";
+    for(size_t n=0;n<phasing.size();n++) {
+      if(n==(phasing.size()-1)) targetid= "FINAL";
 
+      if(phasing_matrix) phasing[n]->apply_matrix(chunk);
+      else               phasing[n]->apply(chunk);
+
+      if(sourceid.compare(targetid) != 0) clear_cluster_signal(chunk,sourceid);
+
+      sourceid=targetid;
+      targetid=sourceid;
+    }
+    release_cluster_spare(chunk);
+
+    // Duplicates are found with the margin, then only the stripe is kept
+    clear_cluster_validity(chunk,true);
+    filter_duplicates.process(chunk);
+    for(size_t n=0;n<chunk.size();n++) if(!core[n]) chunk[n].valid = false;
+    remove_invalid_clusters(chunk,core);
+    total_kept += chunk.size();
+
+    // Binary intensity files are written in parts and joined at the end, text ones as the clusters are output
+    if(parms->is_set("corrected_intout") && !intensity_text) {
+      corrected_intout_parts.push_back(corrected_intout_filename + ".part." + stringify(corrected_intout_parts.size()));
+      write_intensity_file(corrected_intout_parts.back(),chunk,"FINAL",false,intensity_storage);
+    }
+
+    output_clusters(parms,
+                    chunk,
+                    pf_filter,
+                    writer,
+                    rep,
+                    signals_file.is_open() ? &signals_file : 0,
+                    corrected_intout_file.is_open() ? &corrected_intout_file : 0,
+                    tile_arena);
+
+    cout << m_tt.str() << "Chunk of clusters " << first << " to " << last << " in y, kept: " << chunk.size() << endl;
+
+    vector<Cluster<_precision> >().swap(chunk);
+    tile_arena.reset();
+  }
+  writer.close();
+  rep.finish();
+  cout << m_tt.str() << "Clusters, optical duplicates removed: " << total_kept << endl;
+
+  signals_file.close();
+  intout_file.close();
+  corrected_intout_file.close();
+
+  bool written = true;
+  if(intout_parts.size() > 0) {
+    if(!IntensityFile<_precision>::concatenate(intout_filename,intout_parts)) {
+      cerr << "Could not write intensity file: " << intout_filename << endl;
+      written = false;
+    }
+    for(size_t n=0;n<intout_parts.size();n++) remove(intout_parts[n].c_str());
+  }
+  if(corrected_intout_parts.size() > 0) {
+    if(!IntensityFile<_precision>::concatenate(corrected_intout_filename,corrected_intout_parts)) {
+      cerr << "Could not write intensity file: " << corrected_intout_filename << endl;
+      written = false;
+    }
+    for(size_t n=0;n<corrected_intout_parts.size();n++) remove(corrected_intout_parts[n].c_str());
+  }
+
+  mem_misc.start ("write reports");
   rep.write_report_file(report_filename,runxml);
   rep.write_report_human(cerr);
   mem_misc.stop();
-  cout << m_tt.str() << "Swift complete, report file: " << report_filename << endl;
+  return written;
 }
 
 
 
-void write_sequence_files(CommandLine *parms,
-                          vector<Cluster<_precision> > &clusters) {  
-  
-  Memstats mem_misc;                  // this will be started and stopped repeatedly
-  
-  string tiletag               (parms->get_parm("tag"));
-  
-  // Write FASTQs
-  if(parms->is_set("fastq")) { 
-    string fastq_prefix = parms->get_parm("fastq");
-
-    if(!parms->is_set("pair_break")) {
-
-      // Write FASTQs
-      mem_misc.start ("write fastq files");
-      FastqWriter pfFastq   (fastq_prefix + ".pf");
-      FastqWriter nonpfFastq(fastq_prefix + ".nonpf");
-
-      pfFastq.open();
-      nonpfFastq.open();
-      
-      // PF Filter
-      for(vector<Cluster<_precision> >::iterator i=clusters.begin();i != clusters.end();i++) {
-        if((*i).is_valid())    pfFastq.write((*i).sequence("FINAL",tiletag));
-        else                nonpfFastq.write((*i).sequence("FINAL",tiletag));
-      }
-      pfFastq.close();
-      nonpfFastq.close();
-      mem_misc.stop();
-      
-    } else {
-      
-      // Write FASTQs
-      mem_misc.start ("write fastq files");
-      
-      int pair_break = parms->get_parm_as<int>("pair_break") - 1;     // convert to 0-based index
-      
-      FastqWriter pfFastq1   (fastq_prefix + ".pf.end1");
-      FastqWriter pfFastq2   (fastq_prefix + ".pf.end2");
-
-      FastqWriter nonpfFastq1(fastq_prefix + ".nonpf.end1");
-      FastqWriter nonpfFastq2(fastq_prefix + ".nonpf.end2");
-
-      pfFastq1.open();
-      pfFastq2.open();
-      nonpfFastq1.open();
-      nonpfFastq2.open();
-      
-      // PF Filter
-      for(vector<Cluster<_precision> >::iterator i=clusters.begin();i != clusters.end();i++) {
-        
-        if((*i).is_valid()) {
-          pfFastq1.write((*i).sequence("FINAL",tiletag + ":end1").trim(0         ,pair_break-1));
-          pfFastq2.write((*i).sequence("FINAL",tiletag + ":end2").trim(pair_break,-1          ));
-        } else { 
-          nonpfFastq1.write((*i).sequence("FINAL",tiletag + ":end1").trim(0         ,pair_break-1));
-          nonpfFastq2.write((*i).sequence("FINAL",tiletag + ":end2").trim(pair_break,-1          ));
-        }
-      }
+/// The stages after the last estimate made over the whole tile. Clusters are saved, purity filtered, called
+/// and written, and added to the report in blocks of pipeline_block: blocks are filtered while those before
+/// them are being written, and the files and report see them in order. The clusters are kept, in order.
+void output_clusters(CommandLine *parms,
+                     vector<Cluster<_precision> > &clusters,
+                     ClusterFilter_Purity2<_precision> &pf_filter,
+                     PrbSequenceWriter<_precision> &writer,
+                     Reporting<_precision> &rep,
+                     ostream *signals_file,
+                     ostream *corrected_intout_file,
+                     MonotonicArena &tile_arena) {
 
-      pfFastq1.close();
-      pfFastq2.close();
-      
-      nonpfFastq1.close();
-      nonpfFastq2.close();
-      mem_misc.stop();
-    }
+  typedef vector<Cluster<_precision> > block_type;
+
+  size_t block_size = parms->get_parm_as<size_t>("pipeline_block");
+  if(block_size == 0) block_size = clusters.size();
+
+  vector<block_type> blocks;
+  for(size_t first=0;first<clusters.size();first+=block_size) {
+    size_t last = (first+block_size < clusters.size()) ? first+block_size : clusters.size();
+    blocks.push_back(block_type());
+    blocks.back().reserve(last-first);
+    for(size_t n=first;n<last;n++) blocks.back().push_back(std::move(clusters[n]));
+  }
+
+  #if defined(_OPENMP)
+  int threads = omp_get_max_threads();
+  #else
+  int threads = 1;
+  #endif
+  BlockPipeline<block_type> pipeline(threads);
+
+  if(signals_file != 0) {
+    pipeline.ordered([signals_file](block_type &b) {
+      for(block_type::iterator i=b.begin();i != b.end();i++) (*signals_file) << (*i);
+    });
   }
 
-  // Write FAST4s
-  if(parms->is_set("fast4")) { 
-    string fast4_prefix   = parms->get_parm("fast4");
-    bool   fast4_textmode = parms->is_set("textmode");
+  if(corrected_intout_file != 0) {
+    pipeline.ordered([corrected_intout_file](block_type &b) {
+      for(size_t n=0;n<b.size();n++) (*corrected_intout_file) << b[n].dump_gapipelinestr("FINAL") << endl;
+    });
+  }
 
-    if ( ! parms->is_set("pair_break")) {
+  pipeline.parallel([&pf_filter](block_type &b) { pf_filter.process(b); });
 
-      // Write FASTQs
-      mem_misc.start ("write fast4 files");
-      Fast4Writer<size_t,float> pfFast4   (fast4_prefix + ".pf");
-      Fast4Writer<size_t,float> nonpfFast4(fast4_prefix + ".nonpf");
+  // Only the writer allocates from the tile arena, it's the one stage using it at a time
+  pipeline.ordered([&writer,&tile_arena](block_type &b) {
+    ArenaScope<arena_tile> tile_scope(tile_arena);
+    writer.process(b);
+  });
 
-      if(fast4_textmode) {
-        pfFast4   .set_textmode();
-        nonpfFast4.set_textmode();
-      }
-      
-      pfFast4.open();
-      nonpfFast4.open();
-      
-      // PF Filter
-      for(vector<Cluster<_precision> >::iterator i=clusters.begin();i != clusters.end();i++) {
-        if((*i).is_valid())     pfFast4.write((*i).sequence("FINAL",tiletag));
-        else                 nonpfFast4.write((*i).sequence("FINAL",tiletag));
-      }
-      pfFast4.close();
-      nonpfFast4.close();
-      mem_misc.stop();
-      
-    } else {
-      
-      // Write FAST4s
-      mem_misc.start ("write fast4 files");
-      
-      int pair_break = parms->get_parm_as<int>("pair_break") - 1;     // convert to 0-based index
-      
-      Fast4Writer<size_t,float> pfFast41   (fast4_prefix + ".pf.end1");
-      Fast4Writer<size_t,float> pfFast42   (fast4_prefix + ".pf.end2");
-
-      Fast4Writer<size_t,float>  nonpfFast41(fast4_prefix + ".nonpf.end1");
-      Fast4Writer<size_t,float>  nonpfFast42(fast4_prefix + ".nonpf.end2");
-      
-      if(fast4_textmode) {
-        pfFast41   .set_textmode();
-        nonpfFast41.set_textmode();
-        pfFast42   .set_textmode();
-        nonpfFast42.set_textmode();
-      }
+  pipeline.ordered([&rep](block_type &b) { rep.add(b); });
 
-      pfFast41.open();
-      pfFast42.open();
-      nonpfFast41.open();
-      nonpfFast42.open();
-      
-      for(vector<Cluster<_precision> >::iterator i=clusters.begin();i != clusters.end();i++) {
-        
-        if((*i).is_valid()) {
-          pfFast41.write((*i).sequence("FINAL",tiletag + ":end1").trim(0         ,pair_break-1));
-          pfFast42.write((*i).sequence("FINAL",tiletag + ":end2").trim(pair_break,-1          ));
-        } else { 
-          nonpfFast41.write((*i).sequence("FINAL",tiletag + ":end1").trim(0         ,pair_break-1));
-          nonpfFast42.write((*i).sequence("FINAL",tiletag + ":end2").trim(pair_break,-1          ));
-        }
-      }
+  pipeline.run(blocks);
 
-      pfFast41.close();
-      pfFast42.close();
-      
-      nonpfFast41.close();
-      nonpfFast42.close();
-      mem_misc.stop();
+  size_t n=0;
+  for(size_t b=0;b<blocks.size();b++) {
+    for(size_t i=0;i<blocks[b].size();i++) clusters[n++] = std::move(blocks[b][i]);
+  }
+}
+
+/// Name of a checkpoint stage, as its file is suffixed with
+const char *checkpoint_name(int stage) {
+  static const char *names[] = {"","analysis","crosstalk","phasing"};
+  return names[stage];
+}
+
+/// The signal a stage's checkpoint holds
+const char *checkpoint_signal(int stage) {
+  static const char *signals[] = {"","RAW","POSITIVE","FINAL"};
+  return signals[stage];
+}
+
+/// Parameters the stages up to and including stage depend on. A snapshot records their values, so that a
+/// run resumed with different ones can say that the stages it skipped didn't use them.
+vector<string> checkpoint_parameters(int stage) {
+  static const char *analysis[] = {"img-a","img-c","img-g","img-t","intfile","threshold_window","threshold","watershed",
+                                   "correlation_threshold_window","correlation_threshold","correlation_subimages",
+                                   "correlation_subsubimages","correlation_cc_subimage_multiplier","correlation_reference_cycle",
+                                   "correlation_aggregate_cycle","correlation_median_channels","correlation_use_bases",
+                                   "background_subtraction_window","background_subtraction_enabled","segment_cycles","crop",
+                                   "crop_start_x","crop_end_x","crop_start_y","crop_end_y","remove_blended","calculate_noise",
+                                   "load_cycle"};
+  static const char *crosstalk[] = {"discard_offedge","crosstalk_slope_threshold","crosstalk_lowerpercentile",
+                                    "crosstalk_upperpercentile","crosstalk_bin_size_required","crosstalk_bin_threshold",
+                                    "crosstalk_erode_clusters_per_bin","crosstalk_erode_num_bins","purecrosstalk_slope_threshold",
+                                    "purecrosstalk_erode_num_bins","purecrosstalk_purity_highest_how_many"};
+  static const char *phasing[] = {"phasing_threshold","phasing_window","phasing_iterations","phasing_solver"};
+
+  vector<string> names;
+  if(stage >= checkpoint_analysis)  names.insert(names.end(),analysis ,analysis +(sizeof(analysis) /sizeof(analysis[0])));
+  if(stage >= checkpoint_crosstalk) names.insert(names.end(),crosstalk,crosstalk+(sizeof(crosstalk)/sizeof(crosstalk[0])));
+  if(stage >= checkpoint_phasing)   names.insert(names.end(),phasing  ,phasing  +(sizeof(phasing)  /sizeof(phasing[0])));
+  return names;
+}
+
+/// Writes the checkpoint after stage, to <checkpoint>.<stage name> and its intensities to that with .int added
+void save_checkpoint(CommandLine *parms,
+                     int stage,
+                     const vector<Cluster<_precision> > &clusters,
+                     Checkpoint<_precision> &snapshot) {
+
+  Timetagger m_tt;
+  string filename = parms->get_parm("checkpoint") + "." + checkpoint_name(stage);
+
+  snapshot.set_text("stage",checkpoint_name(stage));
+  snapshot.set_text("parameters",parms->dump_settings_xml());
+  vector<string> names = checkpoint_parameters(stage);
+  for(size_t n=0;n<names.size();n++) snapshot.set_text("parameter:" + names[n],parms->get_parm(names[n]));
+
+  if(snapshot.write(filename,clusters,checkpoint_signal(stage))) cout << m_tt.str() << "Checkpoint written: " << filename << endl;
+                                                           else cerr << "Could not write checkpoint: " << filename << endl;
+}
+
+/// Loads the checkpoint resume-from into clusters (or, for one after image analysis that's too large to
+/// hold, names its intensities in raw_files), returning its stage. checkpoint_none if it can't be read.
+int resume_checkpoint(CommandLine *parms,
+                      Checkpoint<_precision> &snapshot,
+                      vector<Cluster<_precision> > &clusters,
+                      vector<string> &raw_files) {
+
+  Timetagger m_tt;
+  string filename = parms->get_parm("resume-from");
+
+  int stage = checkpoint_none;
+  if(snapshot.read(filename)) {
+    for(int s=checkpoint_analysis;s<=checkpoint_phasing;s++) if(snapshot.text("stage") == checkpoint_name(s)) stage = s;
+  }
+  if(stage == checkpoint_none) {
+    cerr << "Could not read checkpoint: " << filename << endl;
+    return checkpoint_none;
+  }
+
+  vector<string> names = checkpoint_parameters(stage);
+  for(size_t n=0;n<names.size();n++) {
+    string saved = snapshot.text("parameter:" + names[n]);
+    if(saved != parms->get_parm(names[n])) {
+      cerr << "Warning: " << names[n] << " was \"" << saved << "\" for the stages the checkpoint skips, not \"" << parms->get_parm(names[n]) << "\"" << endl;
     }
   }
-  
+
+  string intensities = Checkpoint<_precision>::intensity_filename(filename);
+  size_t count=0,cycles=0;
+  IntensityFile<_precision>::dimensions(intensities,count,cycles);
+
+  if((stage == checkpoint_analysis) &&
+     ((parms->get_parm_as<size_t>("chunk_clusters") > 0) || (count > parms->get_parm_as<size_t>("max_clusters")))) {
+    raw_files.push_back(intensities);
+  } else if(!IntensityFile<_precision>::read(intensities,clusters,checkpoint_signal(stage))) {
+    cerr << "Could not read checkpoint intensities: " << intensities << endl;
+    return checkpoint_none;
+  }
+
+  cout << m_tt.str() << "Resuming after " << checkpoint_name(stage) << " from " << filename << ", " << count << " clusters" << endl;
+  return stage;
+}
+
+void open_sequence_files(CommandLine *parms,
+                         PrbSequenceWriter<_precision> &writer,
+                         bool keep_sequences) {
+
+  if(keep_sequences)                   writer.store_sequences("FINAL");
+  if(parms->is_set("compress_output")) writer.compress_output(parms->get_parm_as<int>("compress_threads"));
+  if(parms->is_set("fastq"))           writer.open_fastq(parms->get_parm("fastq"));
+  if(parms->is_set("fast4"))           writer.open_fast4(parms->get_parm("fast4"),parms->is_set("textmode"),parms->is_set("fast4_binary"));
+}
+
+void write_intensity_file(const string &filename,
+                          const vector<Cluster<_precision> > &clusters,
+                          const SignalId &signalid,
+                          bool text,
+                          ClusterTable<_precision>::storage_type storage) {
+
+  if(!text) {
+    if(!IntensityFile<_precision>::write(filename,clusters,signalid,storage)) cerr << "Could not write intensity file: " << filename << endl;
+    return;
+  }
+
+  ofstream intout_file(filename.c_str());
+  for(vector<Cluster<_precision> >::const_iterator i=clusters.begin();i != clusters.end();i++) {
+    intout_file << (*i).dump_gapipelinestr(signalid);
+    intout_file << endl;
+  }
+  intout_file.close();
+}
+
+/// True if intout and corrected_intout are GAPipeline text, otherwise storage is the precision their binary files are written at
+bool text_intensity_format(CommandLine *parms,ClusterTable<_precision>::storage_type &storage) {
+  string format = parms->get_parm("intensity_format");
+
+  storage = ClusterTable<_precision>::storage_native;
+  if(format == "half") storage = ClusterTable<_precision>::storage_fp16;
+  if(format == "bf16") storage = ClusterTable<_precision>::storage_bf16;
+
+  return (format != "binary") && (storage == ClusterTable<_precision>::storage_native);
 }
 
 bool process_parameters (int argc, char **argv) {
@@ -515,14 +1212,26 @@ bool process_parameters (int argc, char **argv) {
   parms->add_valid_parm("img-t"                                ,"T images filenames list");
   parms->add_valid_parm("ref"                                  ,"Reference sequence for alignment (optional)");
   parms->add_valid_parm("sigs"                                 ,"Signals file (optional)");
-  parms->add_valid_parm("intout"                               ,"GAPipeline style intensity file (optional)");
-  parms->add_valid_parm("corrected_intout"                     ,"GAPipeline style intensity file, corrected signal (optional)");
+  parms->add_valid_parm("intout"                               ,"Intensity file (optional)");
+  parms->add_valid_parm("corrected_intout"                     ,"Intensity file, corrected signal (optional)");
+  parms->add_valid_parm("intensity_format"                     ,"Format of intout and corrected_intout, text (GAPipeline style) or binary (memory mapped by intfile, opt in), half or bf16 (binary at 16 bits a value)",false,"text");
   parms->add_valid_parm("report"                               ,"Report file");
   parms->add_valid_parm("fastq"                                ,"fastq file prefix");
   parms->add_valid_parm("fast4"                                ,"fast4 file prefix");
   parms->add_valid_parm("textmode"                             ,"write fast4 ascii files in text mode, full probabilities not ascii encoded quality scores");
+  parms->add_valid_parm("fast4_binary"                         ,"write fast4 files as binary, fixed size records of quantised probabilities (see Fast4Binary.h)");
+  parms->add_valid_parm("compress_output"                      ,"write fastq/fast4 files as block compressed gzip (BGZF), .gz is added to the file names");
+  parms->add_valid_parm("compress_threads"                     ,"Threads compressing fastq/fast4 files, 0 for one per core", false, "0");
+  
+  parms->add_valid_parm("batch"                                ,"Run folder to process a batch of tiles from, instead of img-?/intfile. For a paired run two folders, comma separated, in read order");
+  parms->add_valid_parm("batch_lanes"                          ,"Lanes of the batch, for example 1-8 or 1,3,5-7",false,"1-8");
+  parms->add_valid_parm("batch_tiles"                          ,"Tiles of each lane of the batch, for example 1-100",false,"1-120");
+  parms->add_valid_parm("batch_output"                         ,"Directory for the files of a batch, each of report, fastq, fast4, sigs, intout and corrected_intout is written as <dir>/s_<lane>_<tile>.<value>",false,".");
+  parms->add_valid_parm("batch_threads"                        ,"Cores to use for a batch, shared between the tiles running at once, 0 for all of them",false,"0");
+  parms->add_valid_parm("batch_memory"                         ,"Memory (MB) a batch may use, limits the tiles running at once, 0 for no limit",false,"0");
+  parms->add_valid_parm("batch_tile_memory"                    ,"Memory (MB) to allow for each tile of a batch, max_clusters bounds the clusters a tile holds at once",false,"4096");
   
-  parms->add_valid_parm("intfile"                              ,"Load for Solexa style intensity file, instead of performing image analysis");
+  parms->add_valid_parm("intfile"                              ,"Load for Solexa style or binary intensity file, instead of performing image analysis");
   parms->add_valid_parm("tag"                                  ,"Tag to write at the top of the report, for example Run ID, lane and tile (optional)");
 
   parms->add_valid_parm("optical_duplicates_distance"          ,"Distance in which to search of optical duplicates", false, "0");
@@ -575,12 +1284,19 @@ bool process_parameters (int argc, char **argv) {
   parms->add_valid_parm("remove_blended"                       ,"Unused", false, "false");
 
   parms->add_valid_parm("pair_break"                           ,"Position of second end (first end length+1)",false,"");
-  parms->add_valid_parm("max_clusters"                         ,"Maximum number of clusters to generate, will fail if more than this are created",false,"1500000"); 
+  parms->add_valid_parm("max_clusters"                         ,"Maximum number of clusters to hold in memory, larger tiles are processed in chunks of this many",false,"1500000"); 
+  parms->add_valid_parm("chunk_clusters"                       ,"Process every tile in chunks of this many clusters, 0 only chunks tiles over max_clusters",false,"0");
+  parms->add_valid_parm("checkpoint"                           ,"Write checkpoints after image analysis, crosstalk and phasing to this prefix, each <prefix>.<stage> and <prefix>.<stage>.int",false);
+  parms->add_valid_parm("resume-from"                          ,"Resume a tile from a checkpoint written by --checkpoint, skipping the stages before it",false);
+  parms->add_valid_parm("pipeline_block"                       ,"Clusters per block as clusters are filtered, called and written, blocks being written overlap with those being filtered, 0 for one block",false,"4096");
+  parms->add_valid_parm("chunk_sample"                         ,"Clusters sampled across a chunked tile to estimate crosstalk, normalisation and phasing, 0 for the chunk size",false,"0");
+  parms->add_valid_parm("chunk_spill"                          ,"Prefix of the temporary files holding the intensities of a chunked tile",false,"swift_spill");
 
   parms->add_valid_parm("calculate_noise"                      ,"Calculate noise estimates",false,"false");
   parms->add_valid_parm("align_every"                          ,"Align every Nth read",false,"50");
   parms->add_valid_parm("load_cycle"                           ,"Load and process this many images at a time (not this puts a limit on reference cycle and aggregate",false,"10");
   parms->add_valid_parm("phasing_iterations"                   ,"Number of phasing iterations",false,"3");
+  parms->add_valid_parm("phasing_solver"                       ,"Phasing correction, iterative (phasing_iterations passes) or matrix (one banded solve per cluster)",false,"iterative");
   parms->add_valid_parm("gnuplot"                              ,"Plot crosstalk with gnuplot",false,"false");
 
   parms->add_valid_parm("discard_offedge"                      ,"Discards any cluster that has fallen off the edge of the imaging area, in any cycle",false,"false");
@@ -588,7 +1304,7 @@ bool process_parameters (int argc, char **argv) {
   if(argc < 2) {
     cout << parms->usage() << endl;
     cout << "Where <X Images> is a line delimited list of tile images, in cycle order." << endl;
-    cout << "Note: This binary processes a single tile at a time" << endl;
+    cout << "Note: This binary processes a single tile at a time, or with --batch the tiles of a run folder" << endl;
     return false;
   }
 